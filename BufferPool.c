@@ -0,0 +1,158 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#include "BufferPool.h"
+#include "Placement.h"
+#include "Error.h"
+
+// Static utility functions
+static int findSizeClass(size_t size);
+static void carveSlab(BufferPool* pool, int sizeClass);
+static LineBuffer* takeBuffer(BufferPool* pool, size_t size);
+
+/**
+ * @function CreateBufferPool
+ * @argument poolIdentity - Name associated with the pool
+ * @argument segment - Shared memory segment from which the pool and its slabs are allocated. NULL uses the heap.
+ * @description
+ * Initialize a BufferPool struct with empty free lists and return it. Slabs are allocated on demand.
+ * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+BufferPool* CreateBufferPool(char* poolIdentity, SharedSegment* segment){
+    // The free lists are cache line aligned so that releasing threads do not share a line
+    BufferPool* pool = AllocateAligned(segment, 64, sizeof(BufferPool));
+    if(pool == NULL) {
+        PrintMallocErrorAndExit(BUFFER_POOL_MODULE, poolIdentity, "CreateBufferPool");
+        return NULL;
+    }
+
+    pool->poolIdentity = poolIdentity;
+    pool->node = -1;
+    pool->segment = segment;
+    for(int index = 0; index < BUFFER_POOL_CLASSES; index++){
+        atomic_init(&pool->classes[index].sharedFree, NULL);
+        pool->classes[index].privateFree = NULL;
+    }
+    return pool;
+}
+
+/**
+ * @function SetBufferPoolNode
+ * @argument pool - BufferPool struct
+ * @argument node - NUMA node on which slabs are allocated. -1 leaves it to the kernel.
+ * @description
+ * Bind the slabs carved from now on to the node. Should be called before the allocating thread starts.
+ * */
+void SetBufferPoolNode(BufferPool* pool, int node){
+    pool->node = node;
+}
+
+/**
+ * @function AllocateLineBuffer
+ * @argument pool - BufferPool struct
+ * @argument length - Length of the string to be stored. One more byte is reserved for '\0'.
+ * @description
+ * Return the payload of a buffer from the smallest size class which can hold the string.
+ * Must only be called from the allocating thread of the pool.
+ * */
+char* AllocateLineBuffer(BufferPool* pool, size_t length){
+    return takeBuffer(pool, length + 1)->payload;
+}
+
+/**
+ * @function takeBuffer
+ * @argument pool - BufferPool struct
+ * @argument size - Number of bytes required in the payload
+ * @description
+ * Take a buffer of the smallest size class which can hold size bytes from the free lists, carving a slab if needed
+ * */
+static LineBuffer* takeBuffer(BufferPool* pool, size_t size){
+    int sizeClass = findSizeClass(size);
+    if(sizeClass < 0) {
+        PrintMallocErrorAndExit(BUFFER_POOL_MODULE, pool->poolIdentity, "AllocateLineBuffer-Size");
+        return NULL;
+    }
+    BufferClass* bufferClass = &pool->classes[sizeClass];
+
+    // If the private list is empty then take every buffer which has been released since the last refill
+    if(bufferClass->privateFree == NULL){
+        bufferClass->privateFree = atomic_exchange_explicit(&bufferClass->sharedFree, NULL, memory_order_acquire);
+    }
+    // If nothing has been released then carve a new slab
+    if(bufferClass->privateFree == NULL){
+        carveSlab(pool, sizeClass);
+    }
+
+    LineBuffer* buffer = bufferClass->privateFree;
+    bufferClass->privateFree = buffer->next;
+    return buffer;
+}
+
+/**
+ * @function ReleaseLineBuffer
+ * @argument string - Payload returned by AllocateLineBuffer
+ * @description
+ * Push the buffer on the shared free list of its pool. Can be called from any thread.
+ * */
+void ReleaseLineBuffer(char* string){
+    if(string == NULL) return;
+
+    // The header is stored right before the payload
+    LineBuffer* buffer = (LineBuffer*) (string - offsetof(LineBuffer, payload));
+    BufferClass* bufferClass = &buffer->pool->classes[buffer->sizeClass];
+
+    LineBuffer* head = atomic_load_explicit(&bufferClass->sharedFree, memory_order_relaxed);
+    do {
+        buffer->next = head;
+    } while(!atomic_compare_exchange_weak_explicit(&bufferClass->sharedFree, &head, buffer,
+                                                   memory_order_release, memory_order_relaxed));
+}
+
+/**
+ * @function findSizeClass
+ * @argument size - Number of bytes required in the payload
+ * @description
+ * Return the index of the smallest size class which can hold size bytes or -1 if size is too large.
+ * */
+static int findSizeClass(size_t size){
+    size_t classSize = BUFFER_POOL_MIN_SIZE;
+    for(int index = 0; index < BUFFER_POOL_CLASSES; index++){
+        if(size <= classSize) return index;
+        classSize = classSize << 1;
+    }
+    return -1;
+}
+
+/**
+ * @function carveSlab
+ * @argument pool - BufferPool struct
+ * @argument sizeClass - Size class for which the slab is carved
+ * @description
+ * Allocate a new slab and split it into buffers of the given class. The buffers are put on the private free list.
+ * */
+static void carveSlab(BufferPool* pool, int sizeClass){
+    size_t stride = sizeof(LineBuffer) + ((size_t) BUFFER_POOL_MIN_SIZE << sizeClass);
+    size_t count = BUFFER_POOL_SLAB_SIZE / stride;
+    if(count == 0) count = 1;
+
+    // The slab is page aligned so that binding it to a node does not move the pages of any other allocation.
+    // It is bound before the buffers are linked, i.e. before its pages are touched.
+    char* slab = AllocateAligned(pool->segment, BUFFER_POOL_SLAB_ALIGNMENT, stride * count);
+    if(slab == NULL) {
+        PrintMallocErrorAndExit(BUFFER_POOL_MODULE, pool->poolIdentity, "Slab");
+        return;
+    }
+    BindMemoryToNode(slab, stride * count, pool->node);
+
+    // Link the buffers of the slab in the private free list
+    BufferClass* bufferClass = &pool->classes[sizeClass];
+    for(size_t index = 0; index < count; index++){
+        LineBuffer* buffer = (LineBuffer*) (slab + index * stride);
+        buffer->pool = pool;
+        buffer->sizeClass = sizeClass;
+        buffer->next = bufferClass->privateFree;
+        bufferClass->privateFree = buffer;
+    }
+}
@@ -0,0 +1,83 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module implements a pool of recycled line buffers so that the per-line path does not call malloc/free.
+ * Buffers are carved out of large slabs and grouped in power of two size classes.
+ * Every buffer starts with a small header (LineBuffer) and the caller only sees the payload which follows it.
+ *
+ * The pool has a single allocating thread (the Reader). Any thread can release a buffer.
+ * Released buffers are pushed on a lock-free list per size class. The allocating thread keeps a private list and
+ * refills it by atomically taking the whole shared list, which avoids the ABA problem of a lock-free pop.
+ * Slabs are never returned to the system. The pool grows to the number of buffers in flight and then stops allocating.
+ * Slabs are page aligned and can be bound to the NUMA node of the stage which first reads the lines (SetBufferPoolNode).
+ * When the stages run as separate processes, the pool and its slabs are allocated in their shared memory segment, so
+ * a line is read into a buffer once and released by the Writer process straight into the pool of the Reader.
+ *
+ * The position, length, sequence number and flags of a line are not kept in the buffer. They travel with the line in
+ * its Record (Record module), whose buffer field is the payload to be released once the line has been written.
+ *
+ * @functions
+ * CreateBufferPool - Return an initialized BufferPool struct
+ * AllocateLineBuffer - Return a buffer which can hold a string of the given length and its '\0'
+ * ReleaseLineBuffer - Return a buffer to the pool it was allocated from
+ * SetBufferPoolNode - Allocate the slabs carved from now on on the given NUMA node
+ * */
+
+#ifndef ASSIGNMENT2_BUFFERPOOL_H
+#define ASSIGNMENT2_BUFFERPOOL_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include "SharedSegment.h"
+
+#define BUFFER_POOL_MODULE "BufferPool"
+// Smallest size class. Size classes are BUFFER_POOL_MIN_SIZE << index.
+#define BUFFER_POOL_MIN_SIZE 64
+// Number of size classes. The largest class holds 64 << 6 = 4096 bytes i.e. MAX_BUFFER_SIZE.
+#define BUFFER_POOL_CLASSES 7
+// Size of a slab from which the buffers of a class are carved
+#define BUFFER_POOL_SLAB_SIZE (64 * 1024)
+// Alignment of a slab. A page, so that a slab can be bound to a NUMA node on its own.
+#define BUFFER_POOL_SLAB_ALIGNMENT 4096
+
+struct BufferPool;
+
+// Header stored right before the payload of every buffer
+typedef struct LineBuffer {
+    // Next buffer in the free list
+    struct LineBuffer* next;
+    // Pool from which this buffer was allocated
+    struct BufferPool* pool;
+    // Size class of this buffer
+    int sizeClass;
+    // Keep the payload 32 byte aligned
+    _Alignas(32) char payload[];
+} LineBuffer;
+
+// Free lists of a single size class
+typedef struct {
+    // Buffers released by any thread. Lock-free stack.
+    _Alignas(64) _Atomic(LineBuffer*) sharedFree;
+    // Buffers owned by the allocating thread
+    LineBuffer* privateFree;
+} BufferClass;
+
+typedef struct BufferPool {
+    // Name of the pool used for error messages
+    char* poolIdentity;
+    // NUMA node on which new slabs are allocated. -1 leaves it to the kernel.
+    int node;
+    // Segment from which the pool and its slabs are allocated. NULL for the heap.
+    SharedSegment* segment;
+    // Free lists for each size class
+    BufferClass classes[BUFFER_POOL_CLASSES];
+} BufferPool;
+
+BufferPool* CreateBufferPool(char* poolIdentity, SharedSegment* segment);
+void SetBufferPoolNode(BufferPool* pool, int node);
+char* AllocateLineBuffer(BufferPool* pool, size_t length);
+void ReleaseLineBuffer(char* string);
+
+#endif
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/wait.h>
 #include "Error.h"
 
 /**
@@ -79,3 +80,56 @@ void PrintOutputPrintErrorAndExit(char* module, char* identityName, char* functi
     exit(EXIT_FAILURE);
 }
 
+
+/**
+ * @function PrintSystemCallErrorAndExit
+ * @argument module - Module which called this method. Example- 'LineReader'
+ * @argument identityName - Name of the identity which called this function. Example- 'Reader'
+ * @argument functionalIdentity - Name of the function which called this function. Example- 'read'
+ * @argument errorNo - The error number set by the system call
+ * @description Print the error message to stderr and exit with failure code. Used for read, write, mmap, etc errors.
+ * */
+void PrintSystemCallErrorAndExit(char* module, char* identityName, char* functionalIdentity, int errorNo){
+    fprintf(stderr, "System call failed in %s:%s:%s. Error : %s\nExiting!\n", module, identityName, functionalIdentity, strerror(errorNo));
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @function PrintStageErrorAndExit
+ * @argument module - Module which called this method. Example- 'Stage'
+ * @argument identityName - Stage which could not be resolved. Example- './rot13.so'
+ * @argument reason - Why the stage could not be resolved. Example- the message of dlerror
+ * @description Print the error message to stderr and exit with failure code. Used for unknown stages and plugin errors.
+ * */
+void PrintStageErrorAndExit(char* module, char* identityName, const char* reason){
+    fprintf(stderr, "Stage could not be loaded in %s:%s. Error : %s\nExiting!\n", module, identityName, reason);
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @function PrintProcessErrorAndExit
+ * @argument module - Module which called this method. Example- 'main'
+ * @argument identityName - Name of the process which failed. Example- 'Munch1'
+ * @argument status - Status of the process returned by waitpid
+ * @description Print the error message to stderr and exit with failure code. Used when a process of the pipeline fails.
+ * */
+void PrintProcessErrorAndExit(char* module, char* identityName, int status){
+    if(WIFSIGNALED(status)) {
+        fprintf(stderr, "Process failed in %s:%s. Killed by signal : %s\nExiting!\n", module, identityName, strsignal(WTERMSIG(status)));
+    } else {
+        fprintf(stderr, "Process failed in %s:%s. Exit code : %d\nExiting!\n", module, identityName, WEXITSTATUS(status));
+    }
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @function PrintTransportErrorAndExit
+ * @argument module - Module which called this method. Example- 'NetQueue'
+ * @argument identityName - Queue on which the error occurred. Example- 'Sender'
+ * @argument reason - What went wrong. Example- 'connection closed before the end of stream'
+ * @description Print the error message to stderr and exit with failure code. Used for errors of a network queue.
+ * */
+void PrintTransportErrorAndExit(char* module, char* identityName, const char* reason){
+    fprintf(stderr, "Transport failed in %s:%s. Error : %s\nExiting!\n", module, identityName, reason);
+    exit(EXIT_FAILURE);
+}
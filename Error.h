@@ -13,6 +13,10 @@
  * PrintSemWaitErrorAndExit - Used for cases when we receive an error in sem_wait
  * PrintSemPostErrorAndExit - Used for cases when we receive an error in sem_post
  * PrintOutputPrintErrorAndExit - Used for cases when we receive an error while printing to stdout or stderr
+ * PrintSystemCallErrorAndExit - Used for cases when a system call such as read or write fails. The error number is converted to its message.
+ * PrintStageErrorAndExit - Used for cases when a stage of the pipeline cannot be resolved or its plugin cannot be loaded
+ * PrintProcessErrorAndExit - Used for cases when a process of the pipeline exits with a failure code or is killed
+ * PrintTransportErrorAndExit - Used for cases when the peer of a network queue breaks the protocol or goes away
  *
  * */
 
@@ -25,5 +29,9 @@ void PrintSemInitErrorAndExit(char* module, char* identityName, char* functional
 void PrintSemWaitErrorAndExit(char* module, char* identityName, char* functionalIdentity);
 void PrintSemPostErrorAndExit(char* module, char* identityName, char* functionalIdentity);
 void PrintOutputPrintErrorAndExit(char* module, char* identityName, char* functionalIdentity);
+void PrintSystemCallErrorAndExit(char* module, char* identityName, char* functionalIdentity, int errorNo);
+void PrintStageErrorAndExit(char* module, char* identityName, const char* reason);
+void PrintProcessErrorAndExit(char* module, char* identityName, int status);
+void PrintTransportErrorAndExit(char* module, char* identityName, const char* reason);
 
 #endif
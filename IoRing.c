@@ -0,0 +1,243 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "IoRing.h"
+#include "Error.h"
+
+// Older C libraries do not define the io_uring system call numbers. They are the same on every architecture but alpha.
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+
+// Static utility functions
+static int mapRings(IoRing* ring, int fd, struct io_uring_params* params);
+static void queueEntry(IoRing* ring, const struct io_uring_sqe* entry);
+static int enterRing(IoRing* ring, unsigned minComplete);
+
+/**
+ * @function CreateIoRing
+ * @argument entries - Number of operations which can be queued at once. Rounded up to a power of two by the kernel.
+ * @description
+ * Set up an io_uring instance and map its rings. Returns NULL and leaves errno set if io_uring is not available,
+ * e.g. on kernels before 5.6 or when it is disabled by seccomp or sysctl.
+ * In case of any other error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+IoRing* CreateIoRing(unsigned entries){
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if(fd < 0) return NULL;
+
+    // Reading stdin and writing stdout need the current file position, which was added along with IORING_OP_READ
+    if(!(params.features & IORING_FEAT_RW_CUR_POS)){
+        close(fd);
+        errno = ENOTSUP;
+        return NULL;
+    }
+
+    IoRing* ring = malloc(sizeof(IoRing));
+    if(ring == NULL) {
+        PrintMallocErrorAndExit(IO_RING_MODULE, "Ring", "CreateIoRing");
+        return NULL;
+    }
+    if(!mapRings(ring, fd, &params)){
+        int mapError = errno;
+        close(fd);
+        free(ring);
+        errno = mapError;
+        return NULL;
+    }
+    ring->fd = fd;
+    ring->toSubmit = 0;
+    return ring;
+}
+
+/**
+ * @function RegisterIoRingBuffers
+ * @argument ring - IoRing struct
+ * @argument buffers - Buffers to be registered. Buffer i is then targeted by a read with bufferIndex i.
+ * @argument count - Number of buffers
+ * @description
+ * Pin the buffers once so that the kernel does not map them for every read. Returns 0 on success and -1 otherwise,
+ * e.g. when they exceed RLIMIT_MEMLOCK. Reads then have to be prepared with bufferIndex -1.
+ * */
+int RegisterIoRingBuffers(IoRing* ring, const struct iovec* buffers, unsigned count){
+    long retVal = syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, buffers, count);
+    return retVal < 0 ? -1 : 0;
+}
+
+/**
+ * @function PrepareIoRingRead
+ * @argument ring - IoRing struct
+ * @argument fd - File descriptor to read from
+ * @argument buffer - Buffer to read into. Must stay valid until the read completes.
+ * @argument offset - Offset in the file or IO_RING_CURRENT_POSITION
+ * @argument bufferIndex - Index of the buffer if it was registered, -1 otherwise
+ * @argument userData - Value returned by WaitIoRingCompletion for this read
+ * @description Queue a read. It is started by the next SubmitIoRing.
+ * */
+void PrepareIoRingRead(IoRing* ring, int fd, struct iovec* buffer, long long offset, int bufferIndex, unsigned long long userData){
+    struct io_uring_sqe entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.fd = fd;
+    entry.off = (unsigned long long) offset;
+    entry.user_data = userData;
+    if(bufferIndex >= 0){
+        entry.opcode = IORING_OP_READ_FIXED;
+        entry.addr = (unsigned long long) (unsigned long) buffer->iov_base;
+        entry.len = (unsigned) buffer->iov_len;
+        entry.buf_index = (unsigned short) bufferIndex;
+    } else {
+        entry.opcode = IORING_OP_READV;
+        entry.addr = (unsigned long long) (unsigned long) buffer;
+        entry.len = 1;
+    }
+    queueEntry(ring, &entry);
+}
+
+/**
+ * @function PrepareIoRingWritev
+ * @argument ring - IoRing struct
+ * @argument fd - File descriptor to write to
+ * @argument iov - Buffers to write. The array and the buffers must stay valid until the write completes.
+ * @argument count - Number of buffers
+ * @argument userData - Value returned by WaitIoRingCompletion for this write
+ * @description Queue a writev at the current file position. It is started by the next SubmitIoRing.
+ * */
+void PrepareIoRingWritev(IoRing* ring, int fd, const struct iovec* iov, unsigned count, unsigned long long userData){
+    struct io_uring_sqe entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.opcode = IORING_OP_WRITEV;
+    entry.fd = fd;
+    entry.off = (unsigned long long) IO_RING_CURRENT_POSITION;
+    entry.addr = (unsigned long long) (unsigned long) iov;
+    entry.len = count;
+    entry.user_data = userData;
+    queueEntry(ring, &entry);
+}
+
+/**
+ * @function SubmitIoRing
+ * @argument ring - IoRing struct
+ * @description Hand every queued operation to the kernel without waiting for any of them to complete
+ * */
+void SubmitIoRing(IoRing* ring){
+    while(ring->toSubmit > 0){
+        enterRing(ring, 0);
+    }
+}
+
+/**
+ * @function WaitIoRingCompletion
+ * @argument ring - IoRing struct
+ * @argument userData - Set to the value the completed operation was prepared with
+ * @description
+ * Return the result of the next completed operation- the number of bytes transferred or a negative error number.
+ * Queued operations are submitted first. Sleeps in io_uring_enter if no operation has completed yet.
+ * */
+int WaitIoRingCompletion(IoRing* ring, unsigned long long* userData){
+    while(1){
+        unsigned head = *ring->cqHead;
+        // Pairs with the release store of the kernel when it adds a completion
+        if(head != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)){
+            struct io_uring_cqe* completion = &ring->cqes[head & ring->cqMask];
+            int result = completion->res;
+            *userData = completion->user_data;
+            // Hand the entry back to the kernel only after it has been read
+            __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+            return result;
+        }
+        enterRing(ring, 1);
+    }
+}
+
+/**
+ * @function mapRings
+ * @argument ring - IoRing struct whose ring pointers are set
+ * @argument fd - File descriptor returned by io_uring_setup
+ * @argument params - Offsets and sizes filled in by io_uring_setup
+ * @description Map the submission ring, the completion ring and the submission entries. Returns 0 if a mapping failed.
+ * */
+static int mapRings(IoRing* ring, int fd, struct io_uring_params* params){
+    size_t sqSize = params->sq_off.array + params->sq_entries * sizeof(unsigned);
+    size_t cqSize = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+    // Since 5.4 both rings live in a single mapping
+    int single = (params->features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if(single && cqSize > sqSize) sqSize = cqSize;
+
+    char* sq = mmap(NULL, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if(sq == MAP_FAILED) return 0;
+    char* cq = sq;
+    if(!single){
+        cq = mmap(NULL, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if(cq == MAP_FAILED) return 0;
+    }
+    void* sqes = mmap(NULL, params->sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if(sqes == MAP_FAILED) return 0;
+
+    ring->sqHead = (unsigned*) (sq + params->sq_off.head);
+    ring->sqTail = (unsigned*) (sq + params->sq_off.tail);
+    ring->sqMask = *(unsigned*) (sq + params->sq_off.ring_mask);
+    ring->sqArray = (unsigned*) (sq + params->sq_off.array);
+    ring->sqes = sqes;
+    ring->cqHead = (unsigned*) (cq + params->cq_off.head);
+    ring->cqTail = (unsigned*) (cq + params->cq_off.tail);
+    ring->cqMask = *(unsigned*) (cq + params->cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*) (cq + params->cq_off.cqes);
+    return 1;
+}
+
+/**
+ * @function queueEntry
+ * @argument ring - IoRing struct
+ * @argument entry - Operation to be queued
+ * @description
+ * Copy the operation into the next free submission entry and publish it. If the submission ring is full then the
+ * queued operations are submitted first.
+ * */
+static void queueEntry(IoRing* ring, const struct io_uring_sqe* entry){
+    unsigned tail = *ring->sqTail;
+    while(tail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) > ring->sqMask){
+        SubmitIoRing(ring);
+    }
+    unsigned index = tail & ring->sqMask;
+    ring->sqes[index] = *entry;
+    ring->sqArray[index] = index;
+    // The kernel must see the entry before it sees the new tail
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    ring->toSubmit = ring->toSubmit + 1;
+}
+
+/**
+ * @function enterRing
+ * @argument ring - IoRing struct
+ * @argument minComplete - Number of completions to wait for. 0 only submits.
+ * @description
+ * Submit the queued operations and optionally wait for completions. Returns the number of operations submitted.
+ * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+static int enterRing(IoRing* ring, unsigned minComplete){
+    unsigned flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    long submitted = syscall(__NR_io_uring_enter, ring->fd, ring->toSubmit, minComplete, flags, NULL, 0);
+    if(submitted < 0){
+        if(errno == EINTR) return 0;
+        PrintSystemCallErrorAndExit(IO_RING_MODULE, "Ring", "io_uring_enter", errno);
+    }
+    ring->toSubmit = ring->toSubmit - (unsigned) submitted;
+    return (int) submitted;
+}
@@ -0,0 +1,62 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module is a minimal io_uring binding used for asynchronous reads and writes. It calls io_uring_setup,
+ * io_uring_enter and io_uring_register through syscall(2) and maps the submission and completion rings itself,
+ * so liburing is not needed.
+ * An operation is prepared in the submission ring, tagged with a user value, and handed to the kernel by SubmitIoRing.
+ * WaitIoRingCompletion returns the result of one completed operation along with its user value. Operations on a
+ * seekable file may complete in any order.
+ * A ring is used by a single thread, so no locking is done. CreateIoRing returns NULL if the kernel does not support
+ * io_uring (or reading and writing at the current file position), so the caller can fall back to read(2)/writev(2).
+ *
+ * @functions
+ * CreateIoRing - Set up a ring with the given number of entries. Returns NULL if io_uring is not available.
+ * RegisterIoRingBuffers - Register buffers which reads can then target by index without mapping them per operation
+ * PrepareIoRingRead - Queue a read of one buffer, registered or not
+ * PrepareIoRingWritev - Queue a writev at the current file position
+ * SubmitIoRing - Hand the queued operations to the kernel
+ * WaitIoRingCompletion - Wait for the next completed operation and return its result
+ * */
+
+#ifndef ASSIGNMENT2_IORING_H
+#define ASSIGNMENT2_IORING_H
+
+#include <stddef.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#define IO_RING_MODULE "IoRing"
+// Offset which makes a read or write use (and advance) the current file position
+#define IO_RING_CURRENT_POSITION -1LL
+
+typedef struct {
+    // File descriptor returned by io_uring_setup
+    int fd;
+
+    // Submission ring. Head is advanced by the kernel, tail by us.
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned sqMask;
+    unsigned* sqArray;
+    struct io_uring_sqe* sqes;
+    // Number of entries queued since the last io_uring_enter
+    unsigned toSubmit;
+
+    // Completion ring. Tail is advanced by the kernel, head by us.
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    struct io_uring_cqe* cqes;
+} IoRing;
+
+IoRing* CreateIoRing(unsigned entries);
+int RegisterIoRingBuffers(IoRing* ring, const struct iovec* buffers, unsigned count);
+void PrepareIoRingRead(IoRing* ring, int fd, struct iovec* buffer, long long offset, int bufferIndex, unsigned long long userData);
+void PrepareIoRingWritev(IoRing* ring, int fd, const struct iovec* iov, unsigned count, unsigned long long userData);
+void SubmitIoRing(IoRing* ring);
+int WaitIoRingCompletion(IoRing* ring, unsigned long long* userData);
+
+#endif
@@ -0,0 +1,397 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "LineReader.h"
+#include "Error.h"
+
+// Static utility functions
+static int fillBlock(LineReader* lineReader);
+static int fillRingBlock(LineReader* lineReader);
+static void submitRingRead(LineReader* lineReader, int slot, long long offset);
+static void readNextBlock(LineReader* lineReader, int slot);
+static void waitForRingRead(LineReader* lineReader, int slot);
+static int mapInputFile(LineReader* lineReader);
+
+/**
+ * @function CreateLineReader
+ * @argument fd - File descriptor from which the input is read. Example- 0 for stdin
+ * @argument maxLength - Lines with maxLength or more characters are skipped
+ * @argument mapInput - If set and fd is a regular file then the file is mapped instead of being read in blocks
+ * @description
+ * Initialize a LineReader struct along with its block buffer and return it.
+ * If the input cannot be mapped then the reader silently falls back to read(2).
+ * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+LineReader* CreateLineReader(int fd, int maxLength, int mapInput){
+    LineReader* lineReader = malloc(sizeof(LineReader));
+    if(lineReader == NULL) {
+        PrintMallocErrorAndExit(LINE_READER_MODULE, "Input", "CreateLineReader");
+        return NULL;
+    }
+
+    lineReader->fd = fd;
+    lineReader->maxLength = maxLength;
+    lineReader->segmented = 0;
+    lineReader->ring = NULL;
+    if(mapInput && mapInputFile(lineReader)) return lineReader;
+
+    lineReader->mapped = 0;
+    lineReader->block = malloc(LINE_READER_BLOCK_SIZE);
+    if(lineReader->block == NULL) {
+        free(lineReader);
+        PrintMallocErrorAndExit(LINE_READER_MODULE, "Input", "Block");
+        return NULL;
+    }
+
+    lineReader->blockSize = LINE_READER_BLOCK_SIZE;
+    lineReader->start = 0;
+    lineReader->end = 0;
+    lineReader->eof = 0;
+    return lineReader;
+}
+
+/**
+ * @function CreateAsyncLineReader
+ * @argument fd - File descriptor from which the input is read. Example- 0 for stdin
+ * @argument maxLength - Lines with maxLength or more characters are skipped
+ * @description
+ * Initialize a LineReader struct which reads its blocks with io_uring and start the first reads.
+ * The blocks are registered with the kernel if the memory lock limit allows it. If io_uring is not available, a note is
+ * printed on stderr and NULL is returned so that the caller can use CreateLineReader instead.
+ * */
+LineReader* CreateAsyncLineReader(int fd, int maxLength){
+    IoRing* ring = CreateIoRing(2 * LINE_READER_RING_BLOCKS);
+    if(ring == NULL){
+        fprintf(stderr, "io_uring is not available (%s). Reading the input with read(2).\n", strerror(errno));
+        return NULL;
+    }
+
+    LineReader* lineReader = malloc(sizeof(LineReader));
+    char* blocks = NULL;
+    if(lineReader == NULL || posix_memalign((void**) &blocks, 4096, LINE_READER_RING_BLOCKS * LINE_READER_BLOCK_SIZE) != 0) {
+        PrintMallocErrorAndExit(LINE_READER_MODULE, "Input", "CreateAsyncLineReader");
+        return NULL;
+    }
+    for(int slot = 0; slot < LINE_READER_RING_BLOCKS; slot++){
+        lineReader->ringBlocks[slot].iov_base = blocks + (size_t) slot * LINE_READER_BLOCK_SIZE;
+        lineReader->ringBlocks[slot].iov_len = LINE_READER_BLOCK_SIZE;
+    }
+
+    lineReader->fd = fd;
+    lineReader->maxLength = maxLength;
+    lineReader->segmented = 0;
+    lineReader->mapped = 0;
+    lineReader->block = blocks;
+    lineReader->blockSize = LINE_READER_BLOCK_SIZE;
+    lineReader->start = 0;
+    lineReader->end = 0;
+    lineReader->eof = 0;
+    lineReader->ring = ring;
+    lineReader->ringCurrent = -1;
+    lineReader->ringFixed = RegisterIoRingBuffers(ring, lineReader->ringBlocks, LINE_READER_RING_BLOCKS) == 0;
+
+    // Reads from a pipe use the file position, so only one is in flight at a time to keep the blocks in order
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    lineReader->readOffset = offset < 0 ? IO_RING_CURRENT_POSITION : (long long) offset;
+    lineReader->ringSlots = offset < 0 ? 2 : LINE_READER_RING_BLOCKS;
+
+    // Every block but the last has a read in flight. The last one is read into once the first block arrives.
+    for(int slot = 0; slot < lineReader->ringSlots - 1; slot++){
+        readNextBlock(lineReader, slot);
+    }
+    SubmitIoRing(ring);
+    return lineReader;
+}
+
+/**
+ * @function ReadLine
+ * @argument lineReader - LineReader struct
+ * @argument buffer - The buffer in which the line is stored. Must have space for maxLength characters.
+ * @argument response - pointer to an integer array which will hold the response
+ * @description
+ * This method reads the next line from the block buffer, refilling the block using read(2) when it runs out.
+ * If the total length of the line becomes equal to maxLength, then we ignore that line. If long lines are segmented,
+ * its first maxLength - 1 characters are returned as a LINE_SEGMENT instead and the next call continues the line.
+ *
+ * The response is returned by this method using the response array taken as param.
+ * The first index corresponds to status (LINE_* constants) and the second index corresponds to length of the string.
+ * When buffer contains some value then we append '\0' at the end.
+ * */
+void ReadLine(LineReader* lineReader, char* buffer, int* response){
+    int len = 0, overflow = 0, retVal;
+
+    while(1){
+        // If the block has been consumed completely then read the next block
+        if(lineReader->start == lineReader->end && fillBlock(lineReader) == 0){
+            // EOF has been reached. Set the response depending upon what has been read until now.
+            if(overflow){
+                response[0] = LINE_EOF_AFTER_OVERFLOW;
+                response[1] = 0;
+            } else if(len == 0){
+                response[0] = LINE_EOF;
+            } else {
+                buffer[len] = '\0';
+                response[0] = LINE_EOF_WITH_DATA;
+                response[1] = len;
+            }
+            break;
+        }
+
+        // Find the end of the line in the unconsumed part of the block. A segmented line is only searched up to the end
+        // of the segment so that a long line is scanned once and not once per segment.
+        char* chunk = lineReader->block + lineReader->start;
+        size_t available = lineReader->end - lineReader->start;
+        if(lineReader->segmented && available > (size_t) (lineReader->maxLength - len)) available = (size_t) (lineReader->maxLength - len);
+        char* newline = memchr(chunk, '\n', available);
+        size_t chunkLength = newline != NULL ? (size_t) (newline - chunk) : available;
+
+        // A long line is cut into a segment which fills the buffer. The rest of the line stays in the block.
+        if(lineReader->segmented && (size_t) len + chunkLength >= (size_t) lineReader->maxLength){
+            size_t segmentLength = (size_t) (lineReader->maxLength - 1 - len);
+            memcpy(buffer + len, chunk, segmentLength);
+            lineReader->start = lineReader->start + segmentLength;
+            len = lineReader->maxLength - 1;
+            buffer[len] = '\0';
+            response[0] = LINE_SEGMENT;
+            response[1] = len;
+            break;
+        }
+
+        // Copy the chunk unless the line has already reached (or now reaches) the max length
+        if(!overflow){
+            if((size_t) len + chunkLength >= (size_t) lineReader->maxLength){
+                overflow = 1;
+            } else {
+                memcpy(buffer + len, chunk, chunkLength);
+                len = len + (int) chunkLength;
+            }
+        }
+        lineReader->start = lineReader->start + chunkLength;
+
+        // If the newline was found then consume it and complete this line
+        if(newline != NULL){
+            lineReader->start = lineReader->start + 1;
+            if(overflow){
+                response[0] = LINE_OVERFLOW;
+                response[1] = 0;
+            } else {
+                buffer[len] = '\0';
+                response[0] = LINE_OK;
+                response[1] = len;
+            }
+            break;
+        }
+    }
+
+    // In case of buffer overflow, print a warning on stderr
+    if(overflow){
+        retVal = fprintf(stderr, "Current line's length exceeded the max size of buffer. Skipping it.\n");
+        if(retVal < 0) PrintOutputPrintErrorAndExit(LINE_READER_MODULE, "Input", "STDERR-Buffer-Exceeded");
+    }
+}
+
+/**
+ * @function ReadLineView
+ * @argument lineReader - LineReader struct
+ * @argument buffer - Buffer used when the line has to be assembled. Must have space for maxLength characters.
+ * @argument line - Set to the first character of the line
+ * @argument response - pointer to an integer array which will hold the response
+ * @description
+ * If the whole line (including its newline) is in the unconsumed part of the block then line points into the block and
+ * nothing is copied. The line is not terminated by '\0' in that case and is only valid until the next call, unless the
+ * input is mapped. Otherwise the line is read into buffer by ReadLine and line points to buffer.
+ * A segment of a long line which lies inside the block is returned in place in the same way.
+ * The response array has the same meaning as for ReadLine.
+ * */
+void ReadLineView(LineReader* lineReader, char* buffer, char** line, int* response){
+    if(lineReader->start < lineReader->end){
+        char* chunk = lineReader->block + lineReader->start;
+        size_t available = lineReader->end - lineReader->start;
+        // A line which is returned in place is shorter than maxLength, so there is no need to search further
+        size_t scan = available < (size_t) lineReader->maxLength ? available : (size_t) lineReader->maxLength;
+        char* newline = memchr(chunk, '\n', scan);
+        if(newline != NULL && newline - chunk < lineReader->maxLength){
+            lineReader->start = lineReader->start + (size_t) (newline - chunk) + 1;
+            *line = chunk;
+            response[0] = LINE_OK;
+            response[1] = (int) (newline - chunk);
+            return;
+        }
+        // The line has maxLength or more characters, of which the first maxLength - 1 are a segment
+        if(lineReader->segmented && available >= (size_t) lineReader->maxLength){
+            lineReader->start = lineReader->start + (size_t) (lineReader->maxLength - 1);
+            *line = chunk;
+            response[0] = LINE_SEGMENT;
+            response[1] = lineReader->maxLength - 1;
+            return;
+        }
+    }
+
+    // The line spans two blocks, is too long or is the last line of the input
+    ReadLine(lineReader, buffer, response);
+    *line = buffer;
+}
+
+/**
+ * @function SetLongLineSegments
+ * @argument lineReader - LineReader struct
+ * @argument segmented - If set then lines of maxLength or more characters are returned in segments of maxLength - 1
+ * characters (LINE_SEGMENT) instead of being skipped
+ * @description Choose whether long lines are skipped, as by the original reader, or streamed in segments
+ * */
+void SetLongLineSegments(LineReader* lineReader, int segmented){
+    lineReader->segmented = segmented;
+}
+
+/**
+ * @function mapInputFile
+ * @argument lineReader - LineReader struct
+ * @description
+ * Map the input file as a single block if it is a non-empty regular file. Returns 1 if it was mapped and 0 otherwise.
+ * The mapping is private and writable so that the munch stages can convert the lines in place. Only the pages in which
+ * a byte actually changes are copied by the kernel. Reading starts at the current offset of fd.
+ * */
+static int mapInputFile(LineReader* lineReader){
+    struct stat status;
+    if(fstat(lineReader->fd, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size <= 0) return 0;
+
+    off_t offset = lseek(lineReader->fd, 0, SEEK_CUR);
+    if(offset < 0 || offset >= status.st_size) return 0;
+
+    size_t size = (size_t) status.st_size;
+    char* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, lineReader->fd, 0);
+    if(mapping == MAP_FAILED) return 0;
+    // The file is read once from start to end. Failure of the hint is harmless.
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    lineReader->mapped = 1;
+    lineReader->block = mapping;
+    lineReader->blockSize = size;
+    lineReader->start = (size_t) offset;
+    lineReader->end = size;
+    // There is nothing left to read once the mapping has been consumed
+    lineReader->eof = 1;
+    return 1;
+}
+
+/**
+ * @function fillBlock
+ * @argument lineReader - LineReader struct
+ * @description
+ * Read the next block from the file descriptor. Returns the number of bytes read, 0 on EOF.
+ * In case of a read error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+static int fillBlock(LineReader* lineReader){
+    if(lineReader->eof) return 0;
+    if(lineReader->ring != NULL) return fillRingBlock(lineReader);
+
+    ssize_t bytesRead;
+    do {
+        bytesRead = read(lineReader->fd, lineReader->block, lineReader->blockSize);
+    } while(bytesRead < 0 && errno == EINTR);
+
+    if(bytesRead < 0) PrintSystemCallErrorAndExit(LINE_READER_MODULE, "Input", "read", errno);
+    if(bytesRead == 0) lineReader->eof = 1;
+
+    lineReader->start = 0;
+    lineReader->end = (size_t) bytesRead;
+    return (int) bytesRead;
+}
+
+/**
+ * @function fillRingBlock
+ * @argument lineReader - LineReader struct which reads with io_uring
+ * @description
+ * Make the next block of the ring the current block once its read has completed and start a read into the block which
+ * was split until now. Returns the number of bytes in the new block, 0 on EOF.
+ * A short read of a seekable input leaves a gap before the reads which are in flight, so they are read again from the
+ * end of the short read.
+ * In case of a read error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+static int fillRingBlock(LineReader* lineReader){
+    int slot = (lineReader->ringCurrent + 1) % lineReader->ringSlots;
+    int bytesRead;
+    while(1){
+        waitForRingRead(lineReader, slot);
+        bytesRead = lineReader->ringResults[slot];
+        if(bytesRead != -EINTR && bytesRead != -EAGAIN) break;
+        submitRingRead(lineReader, slot, lineReader->ringOffsets[slot]);
+        SubmitIoRing(lineReader->ring);
+    }
+    if(bytesRead < 0) PrintSystemCallErrorAndExit(LINE_READER_MODULE, "Input", "io_uring read", -bytesRead);
+    if(bytesRead == 0){
+        lineReader->eof = 1;
+        lineReader->start = 0;
+        lineReader->end = 0;
+        return 0;
+    }
+
+    if(lineReader->readOffset != IO_RING_CURRENT_POSITION && (size_t) bytesRead < LINE_READER_BLOCK_SIZE){
+        // Read the blocks after this one again, in order, starting right after the short read
+        lineReader->readOffset = lineReader->ringOffsets[slot] + bytesRead;
+        for(int later = 1; later < lineReader->ringSlots - 1; later++){
+            int laterSlot = (slot + later) % lineReader->ringSlots;
+            waitForRingRead(lineReader, laterSlot);
+            readNextBlock(lineReader, laterSlot);
+        }
+    }
+
+    // The previous block has been split completely. The first time, the last block has not been read into yet.
+    int spare = lineReader->ringCurrent >= 0 ? lineReader->ringCurrent : lineReader->ringSlots - 1;
+    lineReader->ringCurrent = slot;
+    lineReader->block = lineReader->ringBlocks[slot].iov_base;
+    lineReader->start = 0;
+    lineReader->end = (size_t) bytesRead;
+    readNextBlock(lineReader, spare);
+    SubmitIoRing(lineReader->ring);
+    return bytesRead;
+}
+
+/**
+ * @function submitRingRead
+ * @argument lineReader - LineReader struct which reads with io_uring
+ * @argument slot - Block which is read into
+ * @argument offset - Offset to read from, IO_RING_CURRENT_POSITION for a pipe
+ * @description Queue a read of a whole block
+ * */
+static void submitRingRead(LineReader* lineReader, int slot, long long offset){
+    lineReader->ringOffsets[slot] = offset;
+    lineReader->ringDone[slot] = 0;
+    PrepareIoRingRead(lineReader->ring, lineReader->fd, &lineReader->ringBlocks[slot], offset,
+                      lineReader->ringFixed ? slot : -1, (unsigned long long) slot);
+}
+
+/**
+ * @function readNextBlock
+ * @argument lineReader - LineReader struct which reads with io_uring
+ * @argument slot - Block which is read into
+ * @description Queue a read of the block of the input which follows the last one queued
+ * */
+static void readNextBlock(LineReader* lineReader, int slot){
+    submitRingRead(lineReader, slot, lineReader->readOffset);
+    if(lineReader->readOffset != IO_RING_CURRENT_POSITION) lineReader->readOffset = lineReader->readOffset + LINE_READER_BLOCK_SIZE;
+}
+
+/**
+ * @function waitForRingRead
+ * @argument lineReader - LineReader struct which reads with io_uring
+ * @argument slot - Block whose read is waited for
+ * @description Wait until the read into the block has completed. Completions of other blocks are recorded on the way.
+ * */
+static void waitForRingRead(LineReader* lineReader, int slot){
+    unsigned long long completed;
+    while(!lineReader->ringDone[slot]){
+        int result = WaitIoRingCompletion(lineReader->ring, &completed);
+        lineReader->ringResults[completed] = result;
+        lineReader->ringDone[completed] = 1;
+    }
+}
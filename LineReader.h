@@ -0,0 +1,99 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module splits the input into lines using large block reads instead of reading one character at a time.
+ * Blocks are read from a file descriptor using read(2) into a buffer which is reused for the whole input.
+ * Lines are located using memchr. ReadLineView returns a line which lies completely inside the block without copying it
+ * and only assembles a line in the caller's buffer when it spans two blocks.
+ * When the input is a regular file it can be mapped instead (MAP_PRIVATE, MADV_SEQUENTIAL). The mapping then acts as a
+ * single block covering the whole file, so the returned lines stay valid and writable until the program exits.
+ * With CreateAsyncLineReader the blocks are read with io_uring instead. Several blocks of a ring are registered with
+ * the kernel and every block except the one being split has a read in flight, so the latency of the reads overlaps
+ * with finding the lines. On a seekable input each read has its own offset; a pipe has only one read in flight at a
+ * time so that the blocks arrive in order.
+ * The semantics of the original fgetc based reader are preserved- lines of maxLength or more characters are skipped
+ * and a final line without a trailing newline is still returned.
+ * With SetLongLineSegments such a line is returned as a sequence of segments of maxLength - 1 characters instead
+ * (LINE_SEGMENT), followed by its remainder as a normal line. Nothing is dropped and no buffer grows with the line.
+ *
+ * @functions
+ * CreateLineReader - Return an initialized LineReader struct for the given file descriptor
+ * CreateAsyncLineReader - Same as CreateLineReader but the blocks are read with io_uring. NULL if it is not available.
+ * ReadLine - Read the next line into the given buffer and report the status using the response array
+ * ReadLineView - Same as ReadLine but the line is returned in place when possible instead of being copied
+ * SetLongLineSegments - Return lines of maxLength or more characters in segments instead of skipping them
+ * */
+
+#ifndef ASSIGNMENT2_LINEREADER_H
+#define ASSIGNMENT2_LINEREADER_H
+
+#include <stddef.h>
+#include <sys/uio.h>
+#include "IoRing.h"
+
+#define LINE_READER_MODULE "LineReader"
+// Size of each block read from the file descriptor
+#define LINE_READER_BLOCK_SIZE (256 * 1024)
+// Number of blocks of an asynchronous reader. All but one have a read in flight.
+#define LINE_READER_RING_BLOCKS 4
+
+// Status values returned in response[0] by ReadLine
+// Normal execution. response[1] holds the length.
+#define LINE_OK 0
+// Line was skipped as its length was maxLength or more
+#define LINE_OVERFLOW -1
+// EOF has been reached with empty buffer
+#define LINE_EOF -2
+// EOF has been reached with some value in buffer. response[1] holds the length.
+#define LINE_EOF_WITH_DATA -3
+// EOF was reached after line length exceeded max length. The line was skipped.
+#define LINE_EOF_AFTER_OVERFLOW -4
+// A segment of a line of maxLength or more characters. response[1] holds the length. The line continues in the next call.
+#define LINE_SEGMENT 1
+
+typedef struct {
+    // File descriptor from which the blocks are read
+    int fd;
+    // Set if the input is mapped. The block is then the mapping of the whole file.
+    int mapped;
+    // Block buffer which is reused for every read
+    char* block;
+    // Total size of the block buffer
+    size_t blockSize;
+    // Index of first character in block which has not been consumed yet
+    size_t start;
+    // Index one past the last valid character in block
+    size_t end;
+    // Set once read returns 0
+    int eof;
+    // Lines with length >= maxLength are skipped, or split into segments if segmented is set
+    int maxLength;
+    int segmented;
+
+    // Ring used for asynchronous reads. NULL if the blocks are read with read(2).
+    IoRing* ring;
+    // Blocks of the ring. The block being split is block ringCurrent, the others are being read into.
+    struct iovec ringBlocks[LINE_READER_RING_BLOCKS];
+    // Offset each block is read from and the result of the read once it has completed
+    long long ringOffsets[LINE_READER_RING_BLOCKS];
+    int ringResults[LINE_READER_RING_BLOCKS];
+    int ringDone[LINE_READER_RING_BLOCKS];
+    // Number of blocks in use. Two for a pipe, so that only one read is in flight.
+    int ringSlots;
+    // Block being split. -1 before the first block has arrived.
+    int ringCurrent;
+    // Set if the blocks are registered with the kernel
+    int ringFixed;
+    // Offset of the next read, IO_RING_CURRENT_POSITION if the input is not seekable
+    long long readOffset;
+} LineReader;
+
+LineReader* CreateLineReader(int fd, int maxLength, int mapInput);
+LineReader* CreateAsyncLineReader(int fd, int maxLength);
+void ReadLine(LineReader* lineReader, char* buffer, int* response);
+void ReadLineView(LineReader* lineReader, char* buffer, char** line, int* response);
+void SetLongLineSegments(LineReader* lineReader, int segmented);
+
+#endif
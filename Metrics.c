@@ -0,0 +1,408 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "Metrics.h"
+#include "statistics.h"
+#include "Error.h"
+
+// How long a client of the Unix socket may take to send its request before the snapshot is sent as plain text
+#define REQUEST_TIMEOUT_MS 100
+
+// Static utility functions
+static void* runMetrics(void* ptr);
+static void takeSnapshot(Metrics* metrics);
+static void renderSnapshot(Metrics* metrics, FILE* out);
+static void printFamily(FILE* out, char* name, char* type, char* help);
+static void printSample(FILE* out, char* name, char* label, char* value, char* format, double sample);
+static void printLabelValue(FILE* out, char* value);
+static void writeSnapshotFile(Metrics* metrics);
+static void openListener(Metrics* metrics);
+static void serveClient(Metrics* metrics);
+
+/**
+ * @function CreateMetrics
+ * @argument target - 'unix:PATH' to serve the snapshots on a Unix socket, otherwise the file they are written to
+ * @argument intervalMs - Time between two snapshots in milliseconds
+ * @argument queueCount - Number of queues of the pipeline
+ * @argument queues - Queues of the pipeline
+ * @argument counterCount - Number of stages which count the records they processed
+ * @argument counterNames - Name of each of these stages. Example- 'Munch1'
+ * @argument segment - Shared memory segment of the pipeline when the stages are separate processes, NULL otherwise.
+ * The processed counters are allocated in it so that the metrics thread of the parent process sees them.
+ * @description
+ * Initialize a Metrics struct and return it. The thread is started by StartMetrics.
+ * */
+Metrics* CreateMetrics(char* target, int intervalMs, int queueCount, Queue** queues, int counterCount,
+                       char** counterNames, SharedSegment* segment){
+    Metrics* metrics = malloc(sizeof(Metrics));
+    if(metrics == NULL) {
+        PrintMallocErrorAndExit(METRICS_MODULE, target, "CreateMetrics");
+        return NULL;
+    }
+    metrics->serveOnSocket = strncmp(target, METRICS_UNIX_PREFIX, strlen(METRICS_UNIX_PREFIX)) == 0;
+    metrics->path = metrics->serveOnSocket ? target + strlen(METRICS_UNIX_PREFIX) : target;
+    metrics->listener = -1;
+    metrics->intervalMs = intervalMs;
+    metrics->queueCount = queueCount;
+    metrics->queues = queues;
+    metrics->counterCount = counterCount;
+    metrics->counterNames = counterNames;
+    metrics->counters = AllocateAligned(segment, 64, sizeof(MetricsCounter) * (size_t) counterCount);
+    metrics->previousDequeues = calloc((size_t) queueCount, sizeof(unsigned long));
+    if(metrics->counters == NULL || metrics->previousDequeues == NULL) {
+        PrintMallocErrorAndExit(METRICS_MODULE, target, "Counters");
+        return NULL;
+    }
+    for(int counter = 0; counter < counterCount; counter++){
+        atomic_init(&metrics->counters[counter].value, 0);
+    }
+    metrics->startTime = GetMonotonicTime();
+    metrics->previousTime = metrics->startTime;
+    metrics->text = NULL;
+    metrics->textLength = 0;
+    atomic_init(&metrics->stop, 0);
+    return metrics;
+}
+
+/**
+ * @function GetMetricsCounter
+ * @argument metrics - Metrics struct. May be NULL.
+ * @argument index - Index of the stage in the names given to CreateMetrics
+ * @description Return the processed counter of the stage, or NULL if no metrics are exported
+ * */
+MetricsCounter* GetMetricsCounter(Metrics* metrics, int index){
+    if(metrics == NULL) return NULL;
+    return &metrics->counters[index];
+}
+
+/**
+ * @function StartMetrics
+ * @argument metrics - Metrics struct
+ * @description
+ * Open the Unix socket, if the snapshots are served, and start the metrics thread. With --processes this is called
+ * once the processes are forked, so that none of them inherits the thread or the socket.
+ * */
+void StartMetrics(Metrics* metrics){
+    if(metrics->serveOnSocket) openListener(metrics);
+    if(pipe(metrics->wakeup) != 0) PrintSystemCallErrorAndExit(METRICS_MODULE, metrics->path, "pipe", errno);
+    int ret = pthread_create(&metrics->thread, NULL, runMetrics, (void*) metrics);
+    if(ret != 0) PrintSystemCallErrorAndExit(METRICS_MODULE, metrics->path, "pthread_create", ret);
+}
+
+/**
+ * @function StopMetrics
+ * @argument metrics - Metrics struct
+ * @description
+ * Stop the metrics thread once the pipeline is done and export a last snapshot, so that a file holds the final values.
+ * The Unix socket is removed.
+ * */
+void StopMetrics(Metrics* metrics){
+    atomic_store(&metrics->stop, 1);
+    char wake = 1;
+    if(write(metrics->wakeup[1], &wake, 1) != 1) PrintSystemCallErrorAndExit(METRICS_MODULE, metrics->path, "write", errno);
+    pthread_join(metrics->thread, NULL);
+    close(metrics->wakeup[0]);
+    close(metrics->wakeup[1]);
+
+    takeSnapshot(metrics);
+    if(metrics->listener >= 0){
+        close(metrics->listener);
+        unlink(metrics->path);
+    }
+}
+
+/**
+ * @function AddToMetricsCounter
+ * @argument counter - Processed counter of a stage. Nothing is done if it is NULL.
+ * @argument count - Number of records processed
+ * @description Add to a counter which the workers of a stage share. Called once per batch.
+ * */
+void AddToMetricsCounter(MetricsCounter* counter, unsigned long count){
+    if(counter != NULL) atomic_fetch_add_explicit(&counter->value, count, memory_order_relaxed);
+}
+
+/**
+ * @function SetMetricsCounter
+ * @argument counter - Processed counter of a stage. Nothing is done if it is NULL.
+ * @argument value - Number of records processed so far
+ * @description Store the count of a stage which is run by a single thread. A plain store, no read-modify-write.
+ * */
+void SetMetricsCounter(MetricsCounter* counter, unsigned long value){
+    if(counter != NULL) atomic_store_explicit(&counter->value, value, memory_order_relaxed);
+}
+
+/**
+ * @function runMetrics
+ * @argument ptr - Metrics struct
+ * @description
+ * Body of the metrics thread. Takes a snapshot every interval and, between two snapshots, answers the clients of the
+ * Unix socket with the last one. Returns once StopMetrics writes to the wakeup pipe.
+ * */
+static void* runMetrics(void* ptr){
+    Metrics* metrics = (Metrics*) ptr;
+    unsigned long long interval = (unsigned long long) metrics->intervalMs * 1000000ULL;
+    unsigned long long next = GetMonotonicTime();
+
+    while(!atomic_load(&metrics->stop)){
+        unsigned long long now = GetMonotonicTime();
+        if(now >= next){
+            takeSnapshot(metrics);
+            next = now + interval;
+        }
+
+        struct pollfd events[2];
+        events[0].fd = metrics->wakeup[0];
+        events[0].events = POLLIN;
+        events[1].fd = metrics->listener;
+        events[1].events = POLLIN;
+        int timeout = (int) ((next - now + 999999ULL) / 1000000ULL);
+        int ready = poll(events, metrics->listener >= 0 ? 2 : 1, timeout);
+        if(ready < 0 && errno != EINTR) PrintSystemCallErrorAndExit(METRICS_MODULE, metrics->path, "poll", errno);
+        if(ready > 0 && metrics->listener >= 0 && (events[1].revents & POLLIN)) serveClient(metrics);
+    }
+    return NULL;
+}
+
+/**
+ * @function takeSnapshot
+ * @argument metrics - Metrics struct
+ * @description Render a snapshot in the Prometheus text format. It replaces the one served, or is written to the file.
+ * */
+static void takeSnapshot(Metrics* metrics){
+    char* text = NULL;
+    size_t length = 0;
+    FILE* out = open_memstream(&text, &length);
+    if(out == NULL) PrintMallocErrorAndExit(METRICS_MODULE, metrics->path, "Snapshot");
+    renderSnapshot(metrics, out);
+    if(fclose(out) != 0) PrintMallocErrorAndExit(METRICS_MODULE, metrics->path, "Snapshot");
+
+    free(metrics->text);
+    metrics->text = text;
+    metrics->textLength = length;
+    if(!metrics->serveOnSocket) writeSnapshotFile(metrics);
+}
+
+/**
+ * @function renderSnapshot
+ * @argument metrics - Metrics struct
+ * @argument out - Stream the snapshot is printed to
+ * @description
+ * Snapshot the stats of every queue and the processed counters and print them, grouped by metric. The rates are
+ * computed against the previous snapshot.
+ * */
+static void renderSnapshot(Metrics* metrics, FILE* out){
+    StatsSnapshot* snapshots = malloc(sizeof(StatsSnapshot) * (size_t) metrics->queueCount);
+    if(snapshots == NULL) PrintMallocErrorAndExit(METRICS_MODULE, metrics->path, "Snapshot");
+    unsigned long long now = GetMonotonicTime();
+    for(int queue = 0; queue < metrics->queueCount; queue++){
+        SnapshotStatistics(metrics->queues[queue]->stats, &snapshots[queue]);
+    }
+    double elapsed = (now - metrics->previousTime) / 1e9;
+
+    printFamily(out, "prodcom_uptime_seconds", "gauge", "Time since the pipeline was started");
+    printSample(out, "prodcom_uptime_seconds", NULL, NULL, "%.3f", (now - metrics->startTime) / 1e9);
+
+    printFamily(out, "prodcom_queue_enqueued_total", "counter", "Records enqueued in the queue");
+    for(int queue = 0; queue < metrics->queueCount; queue++){
+        printSample(out, "prodcom_queue_enqueued_total", "queue", metrics->queues[queue]->queueIdentity, "%.0f", (double) snapshots[queue].enqueueCount);
+    }
+    printFamily(out, "prodcom_queue_dequeued_total", "counter", "Records dequeued from the queue");
+    for(int queue = 0; queue < metrics->queueCount; queue++){
+        printSample(out, "prodcom_queue_dequeued_total", "queue", metrics->queues[queue]->queueIdentity, "%.0f", (double) snapshots[queue].dequeueCount);
+    }
+    printFamily(out, "prodcom_queue_dequeue_rate", "gauge", "Records dequeued per second since the previous snapshot");
+    for(int queue = 0; queue < metrics->queueCount; queue++){
+        double rate = elapsed > 0 ? (snapshots[queue].dequeueCount - metrics->previousDequeues[queue]) / elapsed : 0;
+        printSample(out, "prodcom_queue_dequeue_rate", "queue", metrics->queues[queue]->queueIdentity, "%.1f", rate);
+        metrics->previousDequeues[queue] = snapshots[queue].dequeueCount;
+    }
+    printFamily(out, "prodcom_queue_depth", "gauge", "Records in the queue");
+    for(int queue = 0; queue < metrics->queueCount; queue++){
+        // The two counts are loaded one after the other, so the difference can briefly be off by a batch
+        long depth = (long) (snapshots[queue].enqueueCount - snapshots[queue].dequeueCount);
+        printSample(out, "prodcom_queue_depth", "queue", metrics->queues[queue]->queueIdentity, "%.0f", depth < 0 ? 0.0 : (double) depth);
+    }
+    printFamily(out, "prodcom_queue_capacity", "gauge", "Records the queue can hold");
+    for(int queue = 0; queue < metrics->queueCount; queue++){
+        printSample(out, "prodcom_queue_capacity", "queue", metrics->queues[queue]->queueIdentity, "%.0f", (double) snapshots[queue].capacity);
+    }
+    printFamily(out, "prodcom_queue_peak_capacity", "gauge", "Largest capacity the queue has had");
+    for(int queue = 0; queue < metrics->queueCount; queue++){
+        printSample(out, "prodcom_queue_peak_capacity", "queue", metrics->queues[queue]->queueIdentity, "%.0f", (double) snapshots[queue].peakCapacity);
+    }
+    printFamily(out, "prodcom_queue_enqueue_seconds_total", "counter", "Time spent in enqueue operations");
+    for(int queue = 0; queue < metrics->queueCount; queue++){
+        printSample(out, "prodcom_queue_enqueue_seconds_total", "queue", metrics->queues[queue]->queueIdentity, "%.6f", snapshots[queue].enqueueTime / 1e9);
+    }
+    printFamily(out, "prodcom_queue_dequeue_seconds_total", "counter", "Time spent in dequeue operations");
+    for(int queue = 0; queue < metrics->queueCount; queue++){
+        printSample(out, "prodcom_queue_dequeue_seconds_total", "queue", metrics->queues[queue]->queueIdentity, "%.6f", snapshots[queue].dequeueTime / 1e9);
+    }
+    printFamily(out, "prodcom_queue_blocked_full_seconds_total", "counter", "Time producers were blocked on a full queue");
+    for(int queue = 0; queue < metrics->queueCount; queue++){
+        printSample(out, "prodcom_queue_blocked_full_seconds_total", "queue", metrics->queues[queue]->queueIdentity, "%.6f", snapshots[queue].blockedOnFullTime / 1e9);
+    }
+    printFamily(out, "prodcom_queue_blocked_empty_seconds_total", "counter", "Time consumers were blocked on an empty queue");
+    for(int queue = 0; queue < metrics->queueCount; queue++){
+        printSample(out, "prodcom_queue_blocked_empty_seconds_total", "queue", metrics->queues[queue]->queueIdentity, "%.6f", snapshots[queue].blockedOnEmptyTime / 1e9);
+    }
+    printFamily(out, "prodcom_queue_occupancy_samples_total", "counter",
+                "Operations which left the queue at the given percent of its capacity, in steps of 10");
+    for(int queue = 0; queue < metrics->queueCount; queue++){
+        for(int bucket = 0; bucket < STATS_OCCUPANCY_BUCKETS; bucket++){
+            fprintf(out, "prodcom_queue_occupancy_samples_total{queue=\"");
+            printLabelValue(out, metrics->queues[queue]->queueIdentity);
+            fprintf(out, "\",percent=\"%d\"} %lu\n", bucket * (100 / (STATS_OCCUPANCY_BUCKETS - 1)), snapshots[queue].occupancy[bucket]);
+        }
+    }
+    printFamily(out, "prodcom_stage_processed_total", "counter", "Records processed by the stage. Lines written by the Writer.");
+    for(int counter = 0; counter < metrics->counterCount; counter++){
+        unsigned long processed = atomic_load_explicit(&metrics->counters[counter].value, memory_order_relaxed);
+        printSample(out, "prodcom_stage_processed_total", "stage", metrics->counterNames[counter], "%.0f", (double) processed);
+    }
+
+    metrics->previousTime = now;
+    free(snapshots);
+}
+
+/**
+ * @function printFamily
+ * @argument out - Stream the snapshot is printed to
+ * @argument name - Name of the metric
+ * @argument type - counter or gauge
+ * @argument help - Description of the metric
+ * @description Print the HELP and TYPE lines which precede the samples of a metric
+ * */
+static void printFamily(FILE* out, char* name, char* type, char* help){
+    fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/**
+ * @function printSample
+ * @argument out - Stream the snapshot is printed to
+ * @argument name - Name of the metric
+ * @argument label - Name of the label. NULL for a sample without labels.
+ * @argument value - Value of the label
+ * @argument format - printf format of the sample
+ * @argument sample - Value of the sample
+ * @description Print a line of the form name{label="value"} sample
+ * */
+static void printSample(FILE* out, char* name, char* label, char* value, char* format, double sample){
+    fprintf(out, "%s", name);
+    if(label != NULL){
+        fprintf(out, "{%s=\"", label);
+        printLabelValue(out, value);
+        fprintf(out, "\"}");
+    }
+    fputc(' ', out);
+    fprintf(out, format, sample);
+    fputc('\n', out);
+}
+
+/**
+ * @function printLabelValue
+ * @argument out - Stream the snapshot is printed to
+ * @argument value - Value of a label. Example- the name of a queue, which may contain the path of a plugin.
+ * @description Print the value with its backslashes, quotes and newlines escaped
+ * */
+static void printLabelValue(FILE* out, char* value){
+    for(char* character = value; *character != '\0'; character++){
+        if(*character == '\n') {
+            fputs("\\n", out);
+            continue;
+        }
+        if(*character == '\\' || *character == '"') fputc('\\', out);
+        fputc(*character, out);
+    }
+}
+
+/**
+ * @function writeSnapshotFile
+ * @argument metrics - Metrics struct
+ * @description Write the last snapshot to PATH.tmp and rename it to PATH, which replaces the previous one atomically
+ * */
+static void writeSnapshotFile(Metrics* metrics){
+    size_t length = strlen(metrics->path) + 5;
+    char* temporary = malloc(length);
+    if(temporary == NULL) PrintMallocErrorAndExit(METRICS_MODULE, metrics->path, "Path");
+    snprintf(temporary, length, "%s.tmp", metrics->path);
+
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) PrintSystemCallErrorAndExit(METRICS_MODULE, temporary, "open", errno);
+    size_t written = 0;
+    while(written < metrics->textLength){
+        ssize_t count = write(fd, metrics->text + written, metrics->textLength - written);
+        if(count < 0){
+            if(errno == EINTR) continue;
+            PrintSystemCallErrorAndExit(METRICS_MODULE, temporary, "write", errno);
+        }
+        written = written + (size_t) count;
+    }
+    close(fd);
+    if(rename(temporary, metrics->path) != 0) PrintSystemCallErrorAndExit(METRICS_MODULE, metrics->path, "rename", errno);
+    free(temporary);
+}
+
+/**
+ * @function openListener
+ * @argument metrics - Metrics struct
+ * @description Listen on the Unix socket at the path. A socket left behind by an earlier run is removed first.
+ * */
+static void openListener(Metrics* metrics){
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(*metrics->path == '\0' || strlen(metrics->path) >= sizeof(address.sun_path)) {
+        PrintSystemCallErrorAndExit(METRICS_MODULE, metrics->path, "bind", ENAMETOOLONG);
+    }
+    strcpy(address.sun_path, metrics->path);
+
+    metrics->listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if(metrics->listener < 0) PrintSystemCallErrorAndExit(METRICS_MODULE, metrics->path, "socket", errno);
+    unlink(metrics->path);
+    if(bind(metrics->listener, (struct sockaddr*) &address, sizeof(address)) != 0) {
+        PrintSystemCallErrorAndExit(METRICS_MODULE, metrics->path, "bind", errno);
+    }
+    if(listen(metrics->listener, 8) != 0) PrintSystemCallErrorAndExit(METRICS_MODULE, metrics->path, "listen", errno);
+}
+
+/**
+ * @function serveClient
+ * @argument metrics - Metrics struct
+ * @description
+ * Accept a client of the Unix socket and send it the last snapshot. If it sends an HTTP request within
+ * REQUEST_TIMEOUT_MS, the snapshot is preceded by an HTTP header. A client which goes away is simply dropped.
+ * */
+static void serveClient(Metrics* metrics){
+    int client = accept(metrics->listener, NULL, NULL);
+    if(client < 0) return;
+
+    char request[512];
+    ssize_t received = 0;
+    struct pollfd event = {client, POLLIN, 0};
+    if(poll(&event, 1, REQUEST_TIMEOUT_MS) > 0) received = recv(client, request, sizeof(request), MSG_DONTWAIT);
+    if(received >= 4 && memcmp(request, "GET ", 4) == 0){
+        char header[160];
+        int length = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                                      "Content-Length: %zu\r\n\r\n", metrics->textLength);
+        send(client, header, (size_t) length, MSG_NOSIGNAL);
+    }
+    size_t sent = 0;
+    while(sent < metrics->textLength){
+        ssize_t count = send(client, metrics->text + sent, metrics->textLength - sent, MSG_NOSIGNAL);
+        if(count <= 0) break;
+        sent = sent + (size_t) count;
+    }
+    close(client);
+}
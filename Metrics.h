@@ -0,0 +1,84 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module exports the state of a running pipeline in the Prometheus text format. A metrics thread takes a snapshot
+ * of the stats of every queue (Statistics module) and of the processed count of every stage every interval. It
+ * then either writes the snapshot to a file, or serves it on a Unix socket to every client which connects.
+ * A file is written under a temporary name and renamed, so a reader (Example- the textfile collector of node_exporter)
+ * never sees half of it. A client of the Unix socket which sends an HTTP request gets an HTTP response, so
+ * 'curl --unix-socket PATH http://localhost/metrics' works as well as 'socat - UNIX-CONNECT:PATH'.
+ *
+ * Nothing is locked on the hot path. The stats are sharded relaxed atomics which the snapshot only loads. The processed
+ * counts are MetricsCounters, one per cache line, which a stage adds its batch to and which the Writer (or Sender)
+ * stores its count in once per batch. With --processes the counters are allocated in the shared segment and the
+ * metrics thread runs in the parent process, which maps the queues as well.
+ *
+ * Exported per queue- enqueued and dequeued records, records per second over the last interval, depth, capacity and
+ * peak capacity, time spent in enqueue and dequeue and blocked on a full or an empty queue, and the occupancy samples
+ * per tenth of the capacity. Per stage- records processed, including the lines counted by the Writer.
+ *
+ * @functions
+ * CreateMetrics - Create the exporter for the queues of a pipeline and a processed counter per stage
+ * GetMetricsCounter - Return the processed counter of a stage, or NULL if no metrics are exported
+ * StartMetrics - Start the metrics thread
+ * StopMetrics - Export a last snapshot and stop the metrics thread
+ * AddToMetricsCounter - Add to a counter which several threads update
+ * SetMetricsCounter - Store the value of a counter which a single thread updates
+ * */
+
+#ifndef ASSIGNMENT2_METRICS_H
+#define ASSIGNMENT2_METRICS_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "Queue.h"
+#include "SharedSegment.h"
+
+#define METRICS_MODULE "Metrics"
+// Prefix of a target which is a Unix socket
+#define METRICS_UNIX_PREFIX "unix:"
+// Default interval between two snapshots in milliseconds
+#define METRICS_DEFAULT_INTERVAL_MS 1000
+
+// Processed count of a stage. Each one has its own cache line, so stages do not slow each other down.
+typedef struct {
+    _Alignas(64) atomic_ulong value;
+} MetricsCounter;
+
+typedef struct {
+    // File written with every snapshot, or path of the Unix socket on which it is served
+    char* path;
+    int serveOnSocket;
+    int listener;
+    int intervalMs;
+    // Queues of the pipeline
+    int queueCount;
+    Queue** queues;
+    // Processed counter and name of every stage. Example- 'Munch1' or 'Writer'
+    int counterCount;
+    MetricsCounter* counters;
+    char** counterNames;
+    // Dequeue counts and time of the previous snapshot, from which the rates are computed
+    unsigned long* previousDequeues;
+    unsigned long long previousTime;
+    unsigned long long startTime;
+    // Last snapshot in the Prometheus text format
+    char* text;
+    size_t textLength;
+    // Set by StopMetrics. Also wakes the thread through the pipe.
+    atomic_int stop;
+    int wakeup[2];
+    pthread_t thread;
+} Metrics;
+
+Metrics* CreateMetrics(char* target, int intervalMs, int queueCount, Queue** queues, int counterCount,
+                       char** counterNames, SharedSegment* segment);
+MetricsCounter* GetMetricsCounter(Metrics* metrics, int index);
+void StartMetrics(Metrics* metrics);
+void StopMetrics(Metrics* metrics);
+void AddToMetricsCounter(MetricsCounter* counter, unsigned long count);
+void SetMetricsCounter(MetricsCounter* counter, unsigned long value);
+
+#endif
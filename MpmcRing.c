@@ -0,0 +1,175 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#include "MpmcRing.h"
+#include "WaitPoint.h"
+#include "Error.h"
+
+/**
+ * @function CreateMpmcRing
+ * @argument capacity - Number of entries the ring can hold
+ * @argument ringIdentity - Name associated with the ring. Used for error messages.
+ * @argument segment - Shared memory segment in which the ring is allocated. NULL allocates it from the heap.
+ * @description
+ * Allocate a cache line aligned ring. The slot array is rounded up to the next power of two and slot i starts with
+ * sequence number i, i.e. free for the producer of position i.
+ * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+MpmcRing* CreateMpmcRing(size_t capacity, char* ringIdentity, SharedSegment* segment){
+    // The struct needs cache line alignment so that head and tail do not share a line
+    MpmcRing* ring = AllocateAligned(segment, CACHE_LINE_SIZE, sizeof(MpmcRing));
+    if(ring == NULL) {
+        PrintMallocErrorAndExit(MPMC_RING_MODULE, ringIdentity, "Ring Structure");
+        return NULL;
+    }
+
+    // Round the physical size up to a power of two
+    size_t physicalSize = 1;
+    while(physicalSize < capacity) physicalSize = physicalSize << 1;
+
+    ring->slots = AllocateAligned(segment, CACHE_LINE_SIZE, sizeof(MpmcSlot) * physicalSize);
+    if(ring->slots == NULL) {
+        PrintMallocErrorAndExit(MPMC_RING_MODULE, ringIdentity, "Ring Slots");
+        return NULL;
+    }
+    for(size_t index = 0; index < physicalSize; index++){
+        atomic_init(&ring->slots[index].sequence, index);
+    }
+
+    ring->mask = physicalSize - 1;
+    atomic_init(&ring->capacity, capacity);
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return ring;
+}
+
+/**
+ * @function MpmcRingTryPushBatch
+ * @argument ring - MpmcRing struct
+ * @argument records - Array of records to be pushed
+ * @argument count - Number of records in the array
+ * @description
+ * Claim the free positions at tail (at most count) with a single compare-and-swap on tail and then publish the records
+ * in their slots. Only positions whose slot the consumer of the previous lap has already released are claimed, so the
+ * producer never waits for a consumer. Returns the number of records pushed, 0 without waiting if the ring is full or
+ * the slot at tail is still being read. Can be called from any number of threads.
+ * */
+size_t MpmcRingTryPushBatch(MpmcRing* ring, Record* records, size_t count){
+    if(count == 0) return 0;
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t claimed;
+    while(1){
+        // head only grows, so a stale value can only make the ring look fuller than it is
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        size_t capacity = atomic_load_explicit(&ring->capacity, memory_order_relaxed);
+        // Consumers have already moved past the tail we read, so it is stale
+        if((ptrdiff_t) (tail - head) < 0){
+            tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+            continue;
+        }
+        if(tail - head >= capacity) return 0;
+        size_t limit = capacity - (tail - head);
+        if(limit > count) limit = count;
+
+        // Count the slots from tail on which are free for this lap
+        size_t sequence = 0;
+        for(claimed = 0; claimed < limit; claimed++){
+            sequence = atomic_load_explicit(&ring->slots[(tail + claimed) & ring->mask].sequence, memory_order_acquire);
+            if(sequence != tail + claimed) break;
+        }
+        if(claimed == 0){
+            // The consumer of the previous lap has not released the slot yet, so the ring is full for now
+            if((ptrdiff_t) (sequence - tail) < 0) return 0;
+            // Another producer has filled the slot, so the tail we read is stale
+            tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+            continue;
+        }
+        // On failure tail is reloaded and the free slots are counted again
+        if(atomic_compare_exchange_weak_explicit(&ring->tail, &tail, tail + claimed,
+                                                 memory_order_relaxed, memory_order_relaxed)) break;
+        CpuRelax();
+    }
+
+    for(size_t index = 0; index < claimed; index++){
+        size_t position = tail + index;
+        MpmcSlot* slot = &ring->slots[position & ring->mask];
+        slot->record = records[index];
+        atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+    }
+    return claimed;
+}
+
+/**
+ * @function MpmcRingTryPopBatch
+ * @argument ring - MpmcRing struct
+ * @argument records - Array into which the popped records are stored
+ * @argument maxCount - Maximum number of records which can be stored in the array
+ * @description
+ * Claim the published positions at head (at most maxCount) with a single compare-and-swap on head and then take the
+ * records from their slots. A position which a producer has claimed but not written yet ends the batch, so the
+ * consumer never waits for a producer. Returns the number of records popped, 0 without waiting if the ring is empty
+ * or the record at head is still being written. Can be called from any number of threads.
+ * */
+size_t MpmcRingTryPopBatch(MpmcRing* ring, Record* records, size_t maxCount){
+    if(maxCount == 0) return 0;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t claimed;
+    while(1){
+        // Count the slots from head on which hold the record of their position
+        size_t sequence = 0;
+        for(claimed = 0; claimed < maxCount; claimed++){
+            sequence = atomic_load_explicit(&ring->slots[(head + claimed) & ring->mask].sequence, memory_order_acquire);
+            if(sequence != head + claimed + 1) break;
+        }
+        if(claimed == 0){
+            // No producer has written the slot yet, so the ring is empty for now
+            if((ptrdiff_t) (sequence - (head + 1)) < 0) return 0;
+            // Another consumer has taken the slot, so the head we read is stale
+            head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+            continue;
+        }
+        // The records themselves are ordered by the sequence numbers of the slots, so the indices can be relaxed
+        if(atomic_compare_exchange_weak_explicit(&ring->head, &head, head + claimed,
+                                                 memory_order_relaxed, memory_order_relaxed)) break;
+        CpuRelax();
+    }
+
+    for(size_t index = 0; index < claimed; index++){
+        size_t position = head + index;
+        MpmcSlot* slot = &ring->slots[position & ring->mask];
+        records[index] = slot->record;
+        // Hand the slot to the producer of the next lap
+        atomic_store_explicit(&slot->sequence, position + ring->mask + 1, memory_order_release);
+    }
+    return claimed;
+}
+
+/**
+ * @function MpmcRingSize
+ * @argument ring - MpmcRing struct
+ * @description
+ * Return the number of positions claimed by producers and not yet by consumers. As other threads keep running, the
+ * value is only a sample.
+ * */
+size_t MpmcRingSize(MpmcRing* ring){
+    // Read head first so that the tail read afterwards is never behind it
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return tail - head;
+}
+
+/**
+ * @function MpmcRingSetCapacity
+ * @argument ring - MpmcRing struct
+ * @argument capacity - New number of entries the ring may hold. Clamped to the physical size of the ring.
+ * @description
+ * Change the capacity of the ring. Can be called from any thread. If the ring holds more entries than the new capacity
+ * then producers find it full until the consumers drain it below.
+ * */
+void MpmcRingSetCapacity(MpmcRing* ring, size_t capacity){
+    if(capacity > ring->mask + 1) capacity = ring->mask + 1;
+    if(capacity == 0) capacity = 1;
+    atomic_store_explicit(&ring->capacity, capacity, memory_order_relaxed);
+}
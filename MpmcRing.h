@@ -0,0 +1,73 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module implements a bounded multi-producer/multi-consumer ring which is used as a backend by the Queue module.
+ * It follows the sequence-numbered slot array of Dmitry Vyukov. Every slot carries a sequence number which says whose
+ * turn it is- a slot with sequence == position is free for the producer of that position and a slot with
+ * sequence == position + 1 holds the record for the consumer of that position. The consumer hands the slot to the
+ * producer one lap later by setting it to position + physical size.
+ *
+ * Producers claim positions by advancing tail with a compare-and-swap and consumers do the same with head. A batch of
+ * records claims a whole range of positions with a single compare-and-swap, after which each slot of the range is filled
+ * (or emptied) without touching the shared indices again. So producers only contend with each other on tail and
+ * consumers on head, once per batch, and neither side takes a lock.
+ *
+ * As in Vyukov's queue, a thread checks the sequence numbers of the slots before it claims them and only claims the
+ * run of slots which are ready for it, so no thread ever waits on the slot of another. A producer which has claimed a
+ * position and is preempted before it publishes the slot makes the ring look empty at that position (a consumer which
+ * is preempted makes it look full) until it runs again. The other side then returns a short count or 0 and the Queue
+ * module parks it on its WaitPoint instead of letting it spin.
+ *
+ * Like SpscRing, the physical ring is a power of two and the number of entries producers may use (capacity) can be
+ * lowered below it at runtime. The capacity is checked against head, which only grows, so it is never exceeded.
+ *
+ * @functions
+ * CreateMpmcRing - Return an initialized ring which can hold 'capacity' entries
+ * MpmcRingTryPushBatch - Push as many entries from an array as fit in the ring. Returns 0 if the ring is full.
+ * MpmcRingTryPopBatch - Pop up to a given number of entries. Returns 0 if the ring is empty.
+ * MpmcRingSize - Number of entries in the ring. Approximate while other threads are running.
+ * MpmcRingSetCapacity - Change the number of entries the ring may hold, up to its physical size
+ * */
+
+#ifndef ASSIGNMENT2_MPMCRING_H
+#define ASSIGNMENT2_MPMCRING_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include "SpscRing.h"
+#include "Record.h"
+#include "SharedSegment.h"
+
+#define MPMC_RING_MODULE "MpmcRing"
+
+// A slot of the ring. The sequence number says whether the producer or the consumer of a position may use it.
+typedef struct {
+    atomic_size_t sequence;
+    Record record;
+} MpmcSlot;
+
+// The struct of the ring. Fields are grouped by the threads which write them.
+typedef struct {
+    // Producers side. tail is the next position to be claimed by a producer.
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t tail;
+
+    // Consumers side. head is the next position to be claimed by a consumer.
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t head;
+
+    // Number of entries the ring may hold. Read by every producer and changed by the capacity controller of the queue.
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t capacity;
+    // mask is the physical size - 1. Physical size is a power of two >= capacity.
+    size_t mask;
+    // Array of slots which store the records
+    MpmcSlot* slots;
+} MpmcRing;
+
+MpmcRing* CreateMpmcRing(size_t capacity, char* ringIdentity, SharedSegment* segment);
+size_t MpmcRingTryPushBatch(MpmcRing* ring, Record* records, size_t count);
+size_t MpmcRingTryPopBatch(MpmcRing* ring, Record* records, size_t maxCount);
+size_t MpmcRingSize(MpmcRing* ring);
+void MpmcRingSetCapacity(MpmcRing* ring, size_t capacity);
+
+#endif
@@ -0,0 +1,547 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "NetQueue.h"
+#include "Error.h"
+
+// Prefix of the address of a Unix socket
+#define UNIX_PREFIX "unix:"
+// Time between two attempts to connect to a consumer which does not listen yet
+#define CONNECT_RETRY_MS 50
+// Largest payload of a frame- NET_QUEUE_MAX_BATCH records of the longest line with their headers
+#define MAX_FRAME_BYTES (NET_QUEUE_MAX_BATCH * (8 + NET_QUEUE_MAX_LENGTH))
+
+// Static utility functions
+static NetQueue* createNetQueue(char* queueIdentity);
+static int listenOn(char* address, char* queueIdentity);
+static int connectTo(char* address, char* queueIdentity);
+static int setUnixAddress(struct sockaddr_un* unixAddress, char* address, char* queueIdentity);
+static struct addrinfo* resolveAddress(char* address, int passive, char* queueIdentity);
+static void configureSocket(int socketFd, int family);
+static void sendFrame(NetQueue* q, Record* records, int count);
+static void receiveFrame(NetQueue* q);
+static void receiveCredits(NetQueue* q, int wait);
+static void sendCredits(NetQueue* q, unsigned long credits);
+static void writeVectors(NetQueue* q, struct iovec* vectors, int count);
+static int readFully(NetQueue* q, void* buffer, size_t size);
+static unsigned int readValue(const char* position);
+
+/**
+ * @function ListenNetQueue
+ * @argument address - Address to listen on. Example- 'unix:/tmp/prodcom.sock' or ':9000'
+ * @argument capacity - Number of records the producer may send before the first of them is dequeued
+ * @argument bufferPool - Pool into which the received lines are copied
+ * @argument queueIdentity - Name associated with the queue. Used for error messages.
+ * @description
+ * Listen on the address, accept a single producer, check that it speaks this protocol and grant it 'capacity'
+ * credits. Returns the consumer side of the queue.
+ * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+NetQueue* ListenNetQueue(char* address, int capacity, BufferPool* bufferPool, char* queueIdentity){
+    NetQueue* q = createNetQueue(queueIdentity);
+    q->bufferPool = bufferPool;
+    q->frame = malloc(MAX_FRAME_BYTES);
+    if(q->frame == NULL) PrintMallocErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "Frame");
+
+    int listener = listenOn(address, queueIdentity);
+    do {
+        q->socket = accept(listener, NULL, NULL);
+    } while(q->socket < 0 && errno == EINTR);
+    if(q->socket < 0) PrintSystemCallErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "accept", errno);
+    close(listener);
+    // Only one producer is accepted, so the path is not needed anymore
+    if(strncmp(address, UNIX_PREFIX, strlen(UNIX_PREFIX)) == 0) {
+        unlink(address + strlen(UNIX_PREFIX));
+    } else {
+        configureSocket(q->socket, AF_INET);
+    }
+
+    char hello[8];
+    if(!readFully(q, hello, sizeof(hello))) {
+        PrintTransportErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "connection closed before the handshake");
+    }
+    if(readValue(hello) != NET_QUEUE_MAGIC || readValue(hello + 4) != NET_QUEUE_VERSION) {
+        PrintTransportErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "peer is not a prodcom producer of this version");
+    }
+    sendCredits(q, (unsigned long) capacity);
+    return q;
+}
+
+/**
+ * @function ConnectNetQueue
+ * @argument address - Address of the consumer. Example- 'unix:/tmp/prodcom.sock' or 'localhost:9000'
+ * @argument queueIdentity - Name associated with the queue. Used for error messages.
+ * @description
+ * Connect to the consumer, retrying while it does not listen yet, and send the handshake. Returns the producer side
+ * of the queue. It has no credits until the first ones are received.
+ * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+NetQueue* ConnectNetQueue(char* address, char* queueIdentity){
+    NetQueue* q = createNetQueue(queueIdentity);
+
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while((q->socket = connectTo(address, queueIdentity)) < 0){
+        // The consumer may simply not have started yet
+        if(errno != ECONNREFUSED && errno != ENOENT) PrintSystemCallErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "connect", errno);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long elapsed = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+        if(elapsed >= NET_QUEUE_CONNECT_TIMEOUT_MS) PrintSystemCallErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "connect", errno);
+        struct timespec pause = {0, CONNECT_RETRY_MS * 1000000L};
+        nanosleep(&pause, NULL);
+    }
+
+    unsigned int hello[2] = {htonl(NET_QUEUE_MAGIC), htonl(NET_QUEUE_VERSION)};
+    struct iovec vector = {hello, sizeof(hello)};
+    writeVectors(q, &vector, 1);
+    return q;
+}
+
+/**
+ * @function NetEnqueueStrings
+ * @argument q - Producer side of the queue
+ * @argument records - Records to be sent. The last one may be the end of stream.
+ * @argument count - Number of records
+ * @description
+ * Send the records in frames of at most NET_QUEUE_MAX_BATCH records, each bounded by the credits available. Waits for
+ * credits while there are none left. The pooled buffer of each record is released once the record has been sent.
+ * */
+void NetEnqueueStrings(NetQueue* q, Record* records, int count){
+    int sent = 0;
+    while(sent < count){
+        // Take the credits returned so far and wait for one if none is left
+        receiveCredits(q, q->credits == 0);
+        int batch = count - sent;
+        if(batch > NET_QUEUE_MAX_BATCH) batch = NET_QUEUE_MAX_BATCH;
+        if((unsigned long) batch > q->credits) batch = (int) q->credits;
+
+        sendFrame(q, records + sent, batch);
+        q->credits = q->credits - (unsigned long) batch;
+        // The characters are in the socket now, so the buffers can be reused by the Reader
+        for(int index = sent; index < sent + batch; index++){
+            if(records[index].buffer != NULL) ReleaseLineBuffer(records[index].buffer);
+        }
+        sent = sent + batch;
+    }
+}
+
+/**
+ * @function NetDequeueStrings
+ * @argument q - Consumer side of the queue
+ * @argument records - Array which receives the records
+ * @argument maxCount - Maximum number of records to be returned
+ * @description
+ * Return the records left in the current frame, up to maxCount. If none is left, wait for the next frame first.
+ * Each line is copied into a pooled buffer followed by its newline. The credits of the returned records are sent
+ * back to the producer, except for the end of stream after which nothing is sent anymore.
+ * */
+int NetDequeueStrings(NetQueue* q, Record* records, int maxCount){
+    if(q->frameRecords == 0) receiveFrame(q);
+
+    int count = 0;
+    unsigned long credits = 0;
+    while(count < maxCount && q->frameRecords > 0){
+        if(q->framePosition + 8 > q->frameBytes) {
+            PrintTransportErrorAndExit(NET_QUEUE_MODULE, q->queueIdentity, "record header beyond the end of the frame");
+        }
+        unsigned int length = readValue(q->frame + q->framePosition);
+        unsigned int flags = readValue(q->frame + q->framePosition + 4);
+        q->framePosition = q->framePosition + 8;
+        if(length > NET_QUEUE_MAX_LENGTH || q->framePosition + length > q->frameBytes) {
+            PrintTransportErrorAndExit(NET_QUEUE_MODULE, q->queueIdentity, "record longer than the frame or a buffer");
+        }
+
+        Record record = {NULL, 0, RECORD_END_OF_STREAM, 0, NULL};
+        if(!(flags & RECORD_END_OF_STREAM)){
+            char* buffer = AllocateLineBuffer(q->bufferPool, length);
+            memcpy(buffer, q->frame + q->framePosition, length);
+            buffer[length] = '\n';
+            record.data = buffer;
+            record.length = length;
+            record.flags = flags & RECORD_CONTINUED;
+            record.buffer = buffer;
+            credits = credits + 1;
+        }
+        records[count++] = record;
+        q->framePosition = q->framePosition + length;
+        q->frameRecords = q->frameRecords - 1;
+    }
+    q->recordCount = q->recordCount + (unsigned long) count;
+
+    if(credits > 0) sendCredits(q, credits);
+    return count;
+}
+
+/**
+ * @function CloseNetQueue
+ * @argument q - Either side of the queue
+ * @description
+ * Close the connection once the end of stream has been sent or received. The producer first shuts down its direction
+ * and reads the credits still in flight until the consumer has closed its side.
+ * */
+void CloseNetQueue(NetQueue* q){
+    if(q->bufferPool == NULL){
+        if(shutdown(q->socket, SHUT_WR) != 0) PrintSystemCallErrorAndExit(NET_QUEUE_MODULE, q->queueIdentity, "shutdown", errno);
+        char credits[64];
+        ssize_t received;
+        do {
+            received = recv(q->socket, credits, sizeof(credits), 0);
+        } while(received > 0 || (received < 0 && errno == EINTR));
+    }
+    close(q->socket);
+    q->socket = -1;
+}
+
+/**
+ * @function PrintNetQueueStats
+ * @argument q - Either side of the queue
+ * @description Print the number of frames, records and bytes moved and how often the producer waited for credits
+ * */
+void PrintNetQueueStats(NetQueue* q){
+    fprintf(stderr, "Statistics of %s link -\n", q->queueIdentity);
+    fprintf(stderr, "Frames is %lu\n", q->frameCount);
+    fprintf(stderr, "Records is %lu\n", q->recordCount);
+    fprintf(stderr, "Bytes is %llu\n", q->byteCount);
+    if(q->bufferPool == NULL) fprintf(stderr, "Waits for credits is %lu\n", q->creditWaits);
+    fprintf(stderr, "\n");
+}
+
+/**
+ * @function createNetQueue
+ * @argument queueIdentity - Name associated with the queue
+ * @description Allocate a NetQueue struct which is not connected yet
+ * */
+static NetQueue* createNetQueue(char* queueIdentity){
+    NetQueue* q = malloc(sizeof(NetQueue));
+    if(q == NULL) {
+        PrintMallocErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "CreateNetQueue");
+        return NULL;
+    }
+    memset(q, 0, sizeof(NetQueue));
+    q->queueIdentity = queueIdentity;
+    q->socket = -1;
+    return q;
+}
+
+/**
+ * @function listenOn
+ * @argument address - Address to listen on
+ * @argument queueIdentity - Name of the queue used for error messages
+ * @description
+ * Return a socket listening on the address. A stale Unix socket of an earlier run is removed first.
+ * */
+static int listenOn(char* address, char* queueIdentity){
+    int listener;
+    if(strncmp(address, UNIX_PREFIX, strlen(UNIX_PREFIX)) == 0){
+        struct sockaddr_un unixAddress;
+        socklen_t length = (socklen_t) setUnixAddress(&unixAddress, address, queueIdentity);
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(listener < 0) PrintSystemCallErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "socket", errno);
+        unlink(unixAddress.sun_path);
+        if(bind(listener, (struct sockaddr*) &unixAddress, length) != 0) {
+            PrintSystemCallErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "bind", errno);
+        }
+    } else {
+        struct addrinfo* addresses = resolveAddress(address, 1, queueIdentity);
+        listener = socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+        if(listener < 0) PrintSystemCallErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "socket", errno);
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if(bind(listener, addresses->ai_addr, addresses->ai_addrlen) != 0) {
+            PrintSystemCallErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "bind", errno);
+        }
+        freeaddrinfo(addresses);
+    }
+    if(listen(listener, 1) != 0) PrintSystemCallErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "listen", errno);
+    return listener;
+}
+
+/**
+ * @function connectTo
+ * @argument address - Address of the consumer
+ * @argument queueIdentity - Name of the queue used for error messages
+ * @description
+ * Make one attempt to connect to the consumer, trying every address the host resolves to. Returns the connected
+ * socket or -1 with errno set by the last connect.
+ * */
+static int connectTo(char* address, char* queueIdentity){
+    if(strncmp(address, UNIX_PREFIX, strlen(UNIX_PREFIX)) == 0){
+        struct sockaddr_un unixAddress;
+        socklen_t length = (socklen_t) setUnixAddress(&unixAddress, address, queueIdentity);
+        int socketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(socketFd < 0) PrintSystemCallErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "socket", errno);
+        if(connect(socketFd, (struct sockaddr*) &unixAddress, length) == 0) return socketFd;
+        int error = errno;
+        close(socketFd);
+        errno = error;
+        return -1;
+    }
+
+    struct addrinfo* addresses = resolveAddress(address, 0, queueIdentity);
+    int error = ECONNREFUSED;
+    for(struct addrinfo* current = addresses; current != NULL; current = current->ai_next){
+        int socketFd = socket(current->ai_family, current->ai_socktype, current->ai_protocol);
+        if(socketFd < 0) PrintSystemCallErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "socket", errno);
+        if(connect(socketFd, current->ai_addr, current->ai_addrlen) == 0){
+            freeaddrinfo(addresses);
+            configureSocket(socketFd, current->ai_family);
+            return socketFd;
+        }
+        error = errno;
+        close(socketFd);
+    }
+    freeaddrinfo(addresses);
+    errno = error;
+    return -1;
+}
+
+/**
+ * @function setUnixAddress
+ * @argument unixAddress - Address which is filled
+ * @argument address - Address of the form 'unix:PATH'
+ * @argument queueIdentity - Name of the queue used for error messages
+ * @description Fill the address of the Unix socket at PATH and return its length
+ * */
+static int setUnixAddress(struct sockaddr_un* unixAddress, char* address, char* queueIdentity){
+    char* path = address + strlen(UNIX_PREFIX);
+    memset(unixAddress, 0, sizeof(struct sockaddr_un));
+    unixAddress->sun_family = AF_UNIX;
+    if(*path == '\0' || strlen(path) >= sizeof(unixAddress->sun_path)) {
+        PrintTransportErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "path of the Unix socket is empty or too long");
+    }
+    strcpy(unixAddress->sun_path, path);
+    return (int) sizeof(struct sockaddr_un);
+}
+
+/**
+ * @function resolveAddress
+ * @argument address - Address of the form 'HOST:PORT' or '[IPV6]:PORT'
+ * @argument passive - If set then an empty host is any address, otherwise it is the local host
+ * @argument queueIdentity - Name of the queue used for error messages
+ * @description Resolve the address into the TCP addresses to listen on or to connect to. Free them with freeaddrinfo.
+ * */
+static struct addrinfo* resolveAddress(char* address, int passive, char* queueIdentity){
+    char* separator = strrchr(address, ':');
+    if(separator == NULL || separator[1] == '\0') {
+        PrintTransportErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "address is neither unix:PATH nor HOST:PORT");
+    }
+    char host[256];
+    size_t hostLength = (size_t) (separator - address);
+    char* hostStart = address;
+    // The colons of an IPv6 address are enclosed in brackets
+    if(hostLength >= 2 && address[0] == '[' && address[hostLength - 1] == ']'){
+        hostStart = address + 1;
+        hostLength = hostLength - 2;
+    }
+    if(hostLength >= sizeof(host)) PrintTransportErrorAndExit(NET_QUEUE_MODULE, queueIdentity, "host name too long");
+    memcpy(host, hostStart, hostLength);
+    host[hostLength] = '\0';
+
+    struct addrinfo hints, *addresses;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if(passive) hints.ai_flags = AI_PASSIVE;
+    int result = getaddrinfo(hostLength > 0 ? host : NULL, separator + 1, &hints, &addresses);
+    if(result != 0) PrintTransportErrorAndExit(NET_QUEUE_MODULE, queueIdentity, gai_strerror(result));
+    return addresses;
+}
+
+/**
+ * @function configureSocket
+ * @argument socketFd - Connected TCP socket
+ * @argument family - Address family of the socket
+ * @description
+ * Disable Nagle's algorithm. Frames and credits are already batched, so waiting to coalesce them only adds latency.
+ * */
+static void configureSocket(int socketFd, int family){
+    if(family != AF_INET && family != AF_INET6) return;
+    int noDelay = 1;
+    setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+}
+
+/**
+ * @function sendFrame
+ * @argument q - Producer side of the queue
+ * @argument records - Records of the frame
+ * @argument count - Number of records. At most NET_QUEUE_MAX_BATCH.
+ * @description
+ * Send the frame with a single writev. The headers are built on the stack and the characters are sent straight from
+ * the buffers of the records.
+ * */
+static void sendFrame(NetQueue* q, Record* records, int count){
+    unsigned int headers[2 + 2 * NET_QUEUE_MAX_BATCH];
+    struct iovec vectors[1 + 2 * NET_QUEUE_MAX_BATCH];
+    int vectorCount = 1;
+    size_t payload = 0;
+
+    for(int index = 0; index < count; index++){
+        unsigned int* header = headers + 2 + 2 * index;
+        header[0] = htonl(records[index].length);
+        header[1] = htonl(records[index].flags & (RECORD_CONTINUED | RECORD_END_OF_STREAM));
+        vectors[vectorCount].iov_base = header;
+        vectors[vectorCount].iov_len = 8;
+        vectorCount++;
+        if(records[index].length > 0){
+            vectors[vectorCount].iov_base = records[index].data;
+            vectors[vectorCount].iov_len = records[index].length;
+            vectorCount++;
+        }
+        payload = payload + 8 + records[index].length;
+    }
+    headers[0] = htonl((unsigned int) count);
+    headers[1] = htonl((unsigned int) payload);
+    vectors[0].iov_base = headers;
+    vectors[0].iov_len = 8;
+    writeVectors(q, vectors, vectorCount);
+
+    q->frameCount = q->frameCount + 1;
+    q->recordCount = q->recordCount + (unsigned long) count;
+    q->byteCount = q->byteCount + 8 + payload;
+}
+
+/**
+ * @function receiveFrame
+ * @argument q - Consumer side of the queue
+ * @description Wait for the next frame and read it completely into the frame buffer
+ * */
+static void receiveFrame(NetQueue* q){
+    char header[8];
+    if(!readFully(q, header, sizeof(header))) {
+        PrintTransportErrorAndExit(NET_QUEUE_MODULE, q->queueIdentity, "connection closed before the end of stream");
+    }
+    unsigned int records = readValue(header);
+    unsigned int bytes = readValue(header + 4);
+    if(records == 0 || records > NET_QUEUE_MAX_BATCH || bytes > MAX_FRAME_BYTES) {
+        PrintTransportErrorAndExit(NET_QUEUE_MODULE, q->queueIdentity, "invalid frame header");
+    }
+    if(!readFully(q, q->frame, bytes)) {
+        PrintTransportErrorAndExit(NET_QUEUE_MODULE, q->queueIdentity, "connection closed in the middle of a frame");
+    }
+    q->framePosition = 0;
+    q->frameRecords = records;
+    q->frameBytes = bytes;
+    q->frameCount = q->frameCount + 1;
+    q->byteCount = q->byteCount + 8 + bytes;
+}
+
+/**
+ * @function receiveCredits
+ * @argument q - Producer side of the queue
+ * @argument wait - If set then wait until at least one credit value has arrived
+ * @description
+ * Add every credit value which has arrived to the credits of the producer without waiting for more. A value may arrive
+ * in pieces, which are kept until it is complete.
+ * */
+static void receiveCredits(NetQueue* q, int wait){
+    if(wait) q->creditWaits = q->creditWaits + 1;
+    while(1){
+        ssize_t received = recv(q->socket, q->creditBytes + q->creditFill, sizeof(q->creditBytes) - q->creditFill,
+                                wait ? 0 : MSG_DONTWAIT);
+        if(received > 0){
+            q->creditFill = q->creditFill + (int) received;
+            if(q->creditFill == sizeof(q->creditBytes)){
+                q->credits = q->credits + readValue((char*) q->creditBytes);
+                q->creditFill = 0;
+                wait = 0;
+            }
+            continue;
+        }
+        if(received == 0) PrintTransportErrorAndExit(NET_QUEUE_MODULE, q->queueIdentity, "connection closed by the consumer");
+        if(errno == EINTR) continue;
+        if(errno == EAGAIN || errno == EWOULDBLOCK) return;
+        PrintSystemCallErrorAndExit(NET_QUEUE_MODULE, q->queueIdentity, "recv", errno);
+    }
+}
+
+/**
+ * @function sendCredits
+ * @argument q - Consumer side of the queue
+ * @argument credits - Number of records the producer may send in addition
+ * @description Send a credit value to the producer
+ * */
+static void sendCredits(NetQueue* q, unsigned long credits){
+    unsigned int value = htonl((unsigned int) credits);
+    struct iovec vector = {&value, sizeof(value)};
+    writeVectors(q, &vector, 1);
+}
+
+/**
+ * @function writeVectors
+ * @argument q - Either side of the queue
+ * @argument vectors - Buffers to be sent. They are modified if the socket takes only a part of them.
+ * @argument count - Number of buffers
+ * @description
+ * Send all the buffers, calling sendmsg again after a partial write. A peer which has gone away is reported as an
+ * error instead of raising SIGPIPE.
+ * */
+static void writeVectors(NetQueue* q, struct iovec* vectors, int count){
+    while(count > 0){
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = vectors;
+        message.msg_iovlen = (size_t) count;
+        ssize_t sent = sendmsg(q->socket, &message, MSG_NOSIGNAL);
+        if(sent < 0){
+            if(errno == EINTR) continue;
+            PrintSystemCallErrorAndExit(NET_QUEUE_MODULE, q->queueIdentity, "sendmsg", errno);
+        }
+        // Skip the buffers which were sent completely and advance into the one sent in part
+        while(count > 0 && (size_t) sent >= vectors->iov_len){
+            sent = sent - (ssize_t) vectors->iov_len;
+            vectors++;
+            count--;
+        }
+        if(count > 0){
+            vectors->iov_base = (char*) vectors->iov_base + sent;
+            vectors->iov_len = vectors->iov_len - (size_t) sent;
+        }
+    }
+}
+
+/**
+ * @function readFully
+ * @argument q - Either side of the queue
+ * @argument buffer - Buffer which receives the bytes
+ * @argument size - Number of bytes to be read
+ * @description Read exactly size bytes. Returns 0 if the connection is closed before, 1 otherwise.
+ * */
+static int readFully(NetQueue* q, void* buffer, size_t size){
+    size_t done = 0;
+    while(done < size){
+        ssize_t received = recv(q->socket, (char*) buffer + done, size - done, 0);
+        if(received == 0) return 0;
+        if(received < 0){
+            if(errno == EINTR) continue;
+            PrintSystemCallErrorAndExit(NET_QUEUE_MODULE, q->queueIdentity, "recv", errno);
+        }
+        done = done + (size_t) received;
+    }
+    return 1;
+}
+
+/**
+ * @function readValue
+ * @argument position - Start of a 32 bit value in network byte order. Need not be aligned.
+ * @description Return the value in host byte order
+ * */
+static unsigned int readValue(const char* position){
+    unsigned int value;
+    memcpy(&value, position, sizeof(value));
+    return ntohl(value);
+}
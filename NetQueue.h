@@ -0,0 +1,94 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module implements a queue whose producer and consumer are in two prodcom processes, possibly on two hosts,
+ * connected by a TCP or a Unix stream socket. Like a Queue it carries Records and has a capacity- the producer blocks
+ * once 'capacity' records have been enqueued which the consumer has not dequeued yet. The end of stream is a record
+ * flagged with RECORD_END_OF_STREAM, as in any other queue.
+ *
+ * The capacity is enforced with credits. The consumer side grants the whole capacity when the connection is accepted
+ * and returns one credit for every record it dequeues. The producer spends one credit per record and waits for more
+ * when it has none left. Hence backpressure crosses the link- if the stages behind the consumer fall behind, it stops
+ * dequeuing and the producer stops after at most 'capacity' records, exactly like on a full local queue.
+ *
+ * Protocol (every integer is 32 bits in network byte order)-
+ *   producer -> consumer   NET_QUEUE_MAGIC, NET_QUEUE_VERSION once, then frames
+ *   frame                  record count, payload bytes, then per record- length, flags, the characters of the line
+ *   consumer -> producer   credits. The first value is the capacity, every later value the number of records dequeued.
+ * A frame carries up to NET_QUEUE_MAX_BATCH records and is written with a single writev straight from the buffers of
+ * the records. Their sequence numbers are not sent- each side numbers the lines on its own when it has to reorder them.
+ * The consumer copies each line into a pooled buffer (BufferPool module) followed by its newline, unless it is a
+ * continued segment, so the stages after it handle the line like one read from stdin.
+ *
+ * An address is either 'unix:PATH' for a Unix socket or 'HOST:PORT' for TCP. HOST may be empty (any address when
+ * listening, the local host when connecting) and an IPv6 address is written in brackets, Example- '[::1]:9000'.
+ * A producer which connects before the consumer listens retries for NET_QUEUE_CONNECT_TIMEOUT_MS.
+ *
+ * After the end of stream the producer shuts down its direction and waits until the consumer closes the connection,
+ * so that the credits still in flight never make the connection reset before the consumer has read everything.
+ *
+ * @functions
+ * ListenNetQueue - Wait for a producer on an address and return the consumer side of the queue
+ * ConnectNetQueue - Connect to a consumer on an address and return the producer side of the queue
+ * NetEnqueueStrings - Send an array of records. Waits while no credits are left.
+ * NetDequeueStrings - Receive the available records (at least one) up to a maximum and return their credits
+ * CloseNetQueue - Close either side once the end of stream has passed
+ * PrintNetQueueStats - Print the number of frames, records and bytes moved and the waits for credits
+ * */
+
+#ifndef ASSIGNMENT2_NETQUEUE_H
+#define ASSIGNMENT2_NETQUEUE_H
+
+#include "Record.h"
+#include "BufferPool.h"
+
+#define NET_QUEUE_MODULE "NetQueue"
+// First value sent by the producer- 'PCNQ'
+#define NET_QUEUE_MAGIC 0x50434E51u
+// Version of the protocol. Both sides must use the same one.
+#define NET_QUEUE_VERSION 1u
+// Maximum number of records in a frame
+#define NET_QUEUE_MAX_BATCH 64
+// Lines are shorter than the largest buffer of the pool, which also holds their newline
+#define NET_QUEUE_MAX_LENGTH ((BUFFER_POOL_MIN_SIZE << (BUFFER_POOL_CLASSES - 1)) - 1)
+// How long a producer keeps trying to connect to a consumer which does not listen yet
+#define NET_QUEUE_CONNECT_TIMEOUT_MS 10000
+
+typedef struct {
+    // Name of the queue used for messages. Example- 'Sender'
+    char* queueIdentity;
+    // Connected socket
+    int socket;
+
+    // Producer side. Records which may still be sent before the consumer returns credits.
+    unsigned long credits;
+    // Bytes of a credit value which has only partly arrived
+    unsigned char creditBytes[4];
+    int creditFill;
+
+    // Consumer side. Pool into which the lines are copied.
+    BufferPool* bufferPool;
+    // Frame being consumed. Records are taken from it by NetDequeueStrings.
+    char* frame;
+    // Start of the next record in the frame and the number of records left in it
+    size_t framePosition;
+    size_t frameRecords;
+    size_t frameBytes;
+
+    // Counters printed by PrintNetQueueStats
+    unsigned long frameCount;
+    unsigned long recordCount;
+    unsigned long long byteCount;
+    unsigned long creditWaits;
+} NetQueue;
+
+NetQueue* ListenNetQueue(char* address, int capacity, BufferPool* bufferPool, char* queueIdentity);
+NetQueue* ConnectNetQueue(char* address, char* queueIdentity);
+void NetEnqueueStrings(NetQueue* q, Record* records, int count);
+int NetDequeueStrings(NetQueue* q, Record* records, int maxCount);
+void CloseNetQueue(NetQueue* q);
+void PrintNetQueueStats(NetQueue* q);
+
+#endif
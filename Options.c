@@ -0,0 +1,322 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <limits.h>
+#include <string.h>
+#include "Options.h"
+
+// Static utility functions
+static void printUsageAndExit(char* programName, int exitCode);
+static int parsePositive(char* programName, char* value);
+static int parseNonNegative(char* programName, char* value);
+
+// Values returned by getopt_long for the options which only have a long form
+enum {
+    OPTION_MUNCH1_WORKERS = 256,
+    OPTION_MUNCH2_WORKERS,
+    OPTION_REORDER_WINDOW,
+    OPTION_NO_MMAP,
+    OPTION_QUEUE_SIZE,
+    OPTION_QUEUE_MIN,
+    OPTION_QUEUE_MAX,
+    OPTION_PLACEMENT,
+    OPTION_WAIT_SPIN,
+    OPTION_WAIT_YIELD,
+    OPTION_STAGES,
+    OPTION_IO,
+    OPTION_LONG_LINES,
+    OPTION_SHARED_QUEUE,
+    OPTION_PROCESSES,
+    OPTION_SHM_SIZE,
+    OPTION_LISTEN,
+    OPTION_CONNECT,
+    OPTION_METRICS,
+    OPTION_METRICS_INTERVAL,
+    OPTION_TRACE,
+    OPTION_TRACE_SAMPLE
+};
+
+/**
+ * @function ParseOptions
+ * @argument argc - Number of command line arguments
+ * @argument argv - Command line arguments
+ * @description
+ * Parse the command line options and return them. Options which are not given keep their default value.
+ * In case of an invalid option, the usage is printed on stderr and the program exits with failure code.
+ * */
+Options ParseOptions(int argc, char** argv){
+    Options options;
+    options.fused = 0;
+    options.munch1Workers = 1;
+    options.munch2Workers = 1;
+    options.reorderWindow = DEFAULT_REORDER_WINDOW;
+    options.mapInput = 1;
+    options.queueSize = MAX_QUEUE_SIZE;
+    options.queueMin = 0;
+    options.queueMax = 0;
+    options.placement = PLACEMENT_NONE;
+    options.waitSpin = WAIT_DEFAULT_SPIN_LIMIT;
+    options.waitYield = WAIT_DEFAULT_YIELD_LIMIT;
+    options.stages = NULL;
+    options.ioUring = 0;
+    options.streamLongLines = 0;
+    options.sharedQueueType = QUEUE_MPMC;
+    options.processes = 0;
+    options.sharedMemoryMB = SHARED_SEGMENT_DEFAULT_MB;
+    options.listenAddress = NULL;
+    options.connectAddress = NULL;
+    options.metricsTarget = NULL;
+    options.metricsIntervalMs = METRICS_DEFAULT_INTERVAL_MS;
+    options.traceFile = NULL;
+    options.traceSample = TRACE_DEFAULT_SAMPLE;
+
+    static struct option longOptions[] = {
+        {"fused", no_argument, NULL, 'f'},
+        {"workers", required_argument, NULL, 'w'},
+        {"munch1-workers", required_argument, NULL, OPTION_MUNCH1_WORKERS},
+        {"munch2-workers", required_argument, NULL, OPTION_MUNCH2_WORKERS},
+        {"reorder-window", required_argument, NULL, OPTION_REORDER_WINDOW},
+        {"no-mmap", no_argument, NULL, OPTION_NO_MMAP},
+        {"queue-size", required_argument, NULL, OPTION_QUEUE_SIZE},
+        {"queue-min", required_argument, NULL, OPTION_QUEUE_MIN},
+        {"queue-max", required_argument, NULL, OPTION_QUEUE_MAX},
+        {"placement", required_argument, NULL, OPTION_PLACEMENT},
+        {"wait-spin", required_argument, NULL, OPTION_WAIT_SPIN},
+        {"wait-yield", required_argument, NULL, OPTION_WAIT_YIELD},
+        {"stages", required_argument, NULL, OPTION_STAGES},
+        {"io", required_argument, NULL, OPTION_IO},
+        {"long-lines", required_argument, NULL, OPTION_LONG_LINES},
+        {"shared-queue", required_argument, NULL, OPTION_SHARED_QUEUE},
+        {"processes", no_argument, NULL, OPTION_PROCESSES},
+        {"shm-size", required_argument, NULL, OPTION_SHM_SIZE},
+        {"listen", required_argument, NULL, OPTION_LISTEN},
+        {"connect", required_argument, NULL, OPTION_CONNECT},
+        {"metrics", required_argument, NULL, OPTION_METRICS},
+        {"metrics-interval", required_argument, NULL, OPTION_METRICS_INTERVAL},
+        {"trace", required_argument, NULL, OPTION_TRACE},
+        {"trace-sample", required_argument, NULL, OPTION_TRACE_SAMPLE},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int option, queueSizeGiven = 0;
+    while((option = getopt_long(argc, argv, "fw:h", longOptions, NULL)) != -1){
+        switch(option){
+            case 'f':
+                options.fused = 1;
+                break;
+            case 'w':
+                options.munch1Workers = parsePositive(argv[0], optarg);
+                options.munch2Workers = options.munch1Workers;
+                break;
+            case OPTION_MUNCH1_WORKERS:
+                options.munch1Workers = parsePositive(argv[0], optarg);
+                break;
+            case OPTION_MUNCH2_WORKERS:
+                options.munch2Workers = parsePositive(argv[0], optarg);
+                break;
+            case OPTION_REORDER_WINDOW:
+                options.reorderWindow = parsePositive(argv[0], optarg);
+                break;
+            case OPTION_NO_MMAP:
+                options.mapInput = 0;
+                break;
+            case OPTION_QUEUE_SIZE:
+                options.queueSize = parsePositive(argv[0], optarg);
+                queueSizeGiven = 1;
+                break;
+            case OPTION_QUEUE_MIN:
+                options.queueMin = parsePositive(argv[0], optarg);
+                break;
+            case OPTION_QUEUE_MAX:
+                options.queueMax = parsePositive(argv[0], optarg);
+                break;
+            case OPTION_PLACEMENT:
+                if(strcmp(optarg, "none") == 0){
+                    options.placement = PLACEMENT_NONE;
+                } else if(strcmp(optarg, "compact") == 0){
+                    options.placement = PLACEMENT_COMPACT;
+                } else {
+                    fprintf(stderr, "%s: '%s' is not a placement\n", argv[0], optarg);
+                    printUsageAndExit(argv[0], EXIT_FAILURE);
+                }
+                break;
+            case OPTION_WAIT_SPIN:
+                options.waitSpin = parseNonNegative(argv[0], optarg);
+                break;
+            case OPTION_WAIT_YIELD:
+                options.waitYield = parseNonNegative(argv[0], optarg);
+                break;
+            case OPTION_STAGES:
+                options.stages = optarg;
+                break;
+            case OPTION_IO:
+                if(strcmp(optarg, "sync") == 0){
+                    options.ioUring = 0;
+                } else if(strcmp(optarg, "uring") == 0){
+                    options.ioUring = 1;
+                } else {
+                    fprintf(stderr, "%s: '%s' is not an I/O mode\n", argv[0], optarg);
+                    printUsageAndExit(argv[0], EXIT_FAILURE);
+                }
+                break;
+            case OPTION_LONG_LINES:
+                if(strcmp(optarg, "skip") == 0){
+                    options.streamLongLines = 0;
+                } else if(strcmp(optarg, "stream") == 0){
+                    options.streamLongLines = 1;
+                } else {
+                    fprintf(stderr, "%s: '%s' is not a long line mode\n", argv[0], optarg);
+                    printUsageAndExit(argv[0], EXIT_FAILURE);
+                }
+                break;
+            case OPTION_SHARED_QUEUE:
+                if(strcmp(optarg, "mpmc") == 0){
+                    options.sharedQueueType = QUEUE_MPMC;
+                } else if(strcmp(optarg, "locked") == 0){
+                    options.sharedQueueType = QUEUE_LOCKED;
+                } else {
+                    fprintf(stderr, "%s: '%s' is not a shared queue backend\n", argv[0], optarg);
+                    printUsageAndExit(argv[0], EXIT_FAILURE);
+                }
+                break;
+            case OPTION_PROCESSES:
+                options.processes = 1;
+                break;
+            case OPTION_SHM_SIZE:
+                options.sharedMemoryMB = parsePositive(argv[0], optarg);
+                break;
+            case OPTION_LISTEN:
+                options.listenAddress = optarg;
+                break;
+            case OPTION_CONNECT:
+                options.connectAddress = optarg;
+                break;
+            case OPTION_METRICS:
+                options.metricsTarget = optarg;
+                break;
+            case OPTION_METRICS_INTERVAL:
+                options.metricsIntervalMs = parsePositive(argv[0], optarg);
+                break;
+            case OPTION_TRACE:
+                options.traceFile = optarg;
+                break;
+            case OPTION_TRACE_SAMPLE:
+                options.traceSample = parsePositive(argv[0], optarg);
+                break;
+            case 'h':
+                printUsageAndExit(argv[0], EXIT_SUCCESS);
+                break;
+            default:
+                printUsageAndExit(argv[0], EXIT_FAILURE);
+        }
+    }
+
+    // prodcom does not take any positional argument. Input is always read from stdin.
+    if(optind < argc) printUsageAndExit(argv[0], EXIT_FAILURE);
+
+    // Queues adapt between MAX_QUEUE_SIZE and DEFAULT_MAX_QUEUE_SIZE by default. --queue-size alone fixes the size.
+    // A bound which is not given defaults to the initial size if --queue-size was given, otherwise to the default.
+    int queueMinGiven = options.queueMin != 0, queueMaxGiven = options.queueMax != 0;
+    if(!queueMinGiven) options.queueMin = queueSizeGiven ? options.queueSize : MAX_QUEUE_SIZE;
+    if(!queueMaxGiven) options.queueMax = queueSizeGiven ? options.queueSize : DEFAULT_MAX_QUEUE_SIZE;
+    // A bound given alone moves the default of the other one with it. Only two given bounds can conflict.
+    if(queueMaxGiven && !queueMinGiven && options.queueMin > options.queueMax) options.queueMin = options.queueMax;
+    if(queueMinGiven && !queueMaxGiven && options.queueMax < options.queueMin) options.queueMax = options.queueMin;
+    if(options.queueMin > options.queueMax){
+        fprintf(stderr, "%s: --queue-min must not be larger than --queue-max\n", argv[0]);
+        printUsageAndExit(argv[0], EXIT_FAILURE);
+    }
+    if(options.queueSize < options.queueMin) options.queueSize = options.queueMin;
+    if(options.queueSize > options.queueMax) options.queueSize = options.queueMax;
+
+    // --fused only selects the default pipeline, so it would be silently ignored next to --stages
+    if(options.fused && options.stages != NULL){
+        fprintf(stderr, "%s: --fused cannot be combined with --stages, use --stages fused instead\n", argv[0]);
+        printUsageAndExit(argv[0], EXIT_FAILURE);
+    }
+    // Without --stages the pipeline is the one selected by --fused
+    if(options.stages == NULL) options.stages = options.fused ? DEFAULT_FUSED_STAGES : DEFAULT_STAGES;
+
+    return options;
+}
+
+/**
+ * @function printUsageAndExit
+ * @argument programName - Name with which the program was started
+ * @argument exitCode - Code with which the program exits
+ * @description Print the usage on stderr and exit with the given code
+ * */
+static void printUsageAndExit(char* programName, int exitCode){
+    fprintf(stderr, "Usage: %s [options] < input\n", programName);
+    fprintf(stderr, "  -f, --fused               Run a single munch stage which applies both transforms in one pass\n");
+    fprintf(stderr, "  -w, --workers N           Run every munch stage with N worker threads\n");
+    fprintf(stderr, "      --munch1-workers N    Run Munch1 (or the first stage) with N worker threads\n");
+    fprintf(stderr, "      --munch2-workers N    Run Munch2 (or every later stage) with N worker threads\n");
+    fprintf(stderr, "      --stages SPEC         Comma separated stages, each name[:workers] (default %s)\n", DEFAULT_STAGES);
+    fprintf(stderr, "                            Built-in- munch1, munch2, fused. A path or a name ending in .so is\n");
+    fprintf(stderr, "                            loaded as a plugin, Example- --stages munch1,munch2:2,./rot13.so\n");
+    fprintf(stderr, "      --reorder-window N    Max lines in flight when output is reordered (default %d)\n", DEFAULT_REORDER_WINDOW);
+    fprintf(stderr, "      --queue-size N        Initial number of strings each queue can hold (default %d)\n", MAX_QUEUE_SIZE);
+    fprintf(stderr, "      --queue-min N         Smallest size an adaptive queue shrinks to (default %d)\n", MAX_QUEUE_SIZE);
+    fprintf(stderr, "      --queue-max N         Largest size an adaptive queue grows to (default %d)\n", DEFAULT_MAX_QUEUE_SIZE);
+    fprintf(stderr, "                            The size is fixed if only --queue-size is given or both bounds are equal\n");
+    fprintf(stderr, "      --placement POLICY    none (default) or compact- pin adjacent stages to cores sharing a cache\n");
+    fprintf(stderr, "                            and keep each queue on the NUMA node of its consumer\n");
+    fprintf(stderr, "      --wait-spin N         Times a thread waiting on a queue spins before it yields (default %d)\n", WAIT_DEFAULT_SPIN_LIMIT);
+    fprintf(stderr, "      --wait-yield N        Times it then yields the cpu before it parks on a futex (default %d)\n", WAIT_DEFAULT_YIELD_LIMIT);
+    fprintf(stderr, "      --no-mmap             Read stdin with read(2) even when it is a regular file\n");
+    fprintf(stderr, "      --shared-queue TYPE   Backend of queues with several producers or consumers (-w N)-\n");
+    fprintf(stderr, "                            mpmc (default), a lock-free ring, or locked, the semaphore queue\n");
+    fprintf(stderr, "      --long-lines MODE     skip (default)- drop lines which do not fit in a buffer with a warning,\n");
+    fprintf(stderr, "                            or stream- pass them through in buffer sized segments\n");
+    fprintf(stderr, "      --io MODE             sync (default)- read(2) or mmap and writev(2), or uring- keep several\n");
+    fprintf(stderr, "                            reads and a write in flight with io_uring. Falls back to sync if the\n");
+    fprintf(stderr, "                            kernel does not support it\n");
+    fprintf(stderr, "      --processes           Run the Reader, every stage and the Writer as separate processes which\n");
+    fprintf(stderr, "                            pass the lines through queues in shared memory\n");
+    fprintf(stderr, "      --shm-size MB         Size of the shared memory used by --processes (default %d)\n", SHARED_SEGMENT_DEFAULT_MB);
+    fprintf(stderr, "      --listen ADDR         Receive the lines from a prodcom started with --connect instead of stdin\n");
+    fprintf(stderr, "                            ADDR is unix:PATH or HOST:PORT. Up to --queue-max lines are in flight\n");
+    fprintf(stderr, "      --connect ADDR        Send the lines to a prodcom started with --listen instead of stdout\n");
+    fprintf(stderr, "      --metrics TARGET      Export Prometheus metrics while running- written atomically to the file\n");
+    fprintf(stderr, "                            TARGET, or served on a Unix socket if TARGET is unix:PATH\n");
+    fprintf(stderr, "      --metrics-interval MS Time between two snapshots of the metrics (default %d)\n", METRICS_DEFAULT_INTERVAL_MS);
+    fprintf(stderr, "      --trace FILE          Trace sampled lines through every queue and stage and write the trace\n");
+    fprintf(stderr, "                            to FILE as Chrome trace-event JSON, which Perfetto opens\n");
+    fprintf(stderr, "      --trace-sample N      Trace 1 in N lines (default %d)\n", TRACE_DEFAULT_SAMPLE);
+    fprintf(stderr, "  -h, --help                Print this message\n");
+    exit(exitCode);
+}
+
+/**
+ * @function parsePositive
+ * @argument programName - Name with which the program was started
+ * @argument value - Value of the option
+ * @description Convert the value to a positive integer. Prints the usage and exits if it is not one.
+ * */
+static int parsePositive(char* programName, char* value){
+    char* end;
+    long number = strtol(value, &end, 10);
+    if(*value == '\0' || *end != '\0' || number <= 0 || number > INT_MAX){
+        fprintf(stderr, "%s: '%s' is not a positive number\n", programName, value);
+        printUsageAndExit(programName, EXIT_FAILURE);
+    }
+    return (int) number;
+}
+
+/**
+ * @function parseNonNegative
+ * @argument programName - Name with which the program was started
+ * @argument value - Value of the option
+ * @description Convert the value to an integer which is 0 or more. Prints the usage and exits if it is not one.
+ * */
+static int parseNonNegative(char* programName, char* value){
+    if(value[0] == '0' && value[1] == '\0') return 0;
+    return parsePositive(programName, value);
+}
@@ -0,0 +1,84 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module parses the command line options of prodcom.
+ * All the options are optional. Without any option the program runs the Reader => Munch1 => Munch2 => Writer pipeline.
+ * --stages replaces the stages between the Reader and the Writer, Example- 'munch1,munch2,./rot13.so'.
+ * --listen and --connect split a pipeline between two prodcom processes, see NetQueue module.
+ *
+ * @functions
+ * ParseOptions - Parse argc/argv into an Options struct. Prints the usage and exits in case of an invalid option.
+ * */
+
+#ifndef ASSIGNMENT2_OPTIONS_H
+#define ASSIGNMENT2_OPTIONS_H
+
+#include "Placement.h"
+#include "WaitPoint.h"
+#include "Queue.h"
+#include "SharedSegment.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+#define OPTIONS_MODULE "Options"
+// Default number of lines in flight when a munch stage has several workers
+#define DEFAULT_REORDER_WINDOW 1024
+// Default size of each queue. Also the size an adaptive queue starts with and shrinks back to.
+#define MAX_QUEUE_SIZE 10
+// Default size an adaptive queue may grow to
+#define DEFAULT_MAX_QUEUE_SIZE 1024
+// Stages run without --stages, in the default and in the fused mode
+#define DEFAULT_STAGES "munch1,munch2"
+#define DEFAULT_FUSED_STAGES "fused"
+
+typedef struct {
+    // If set then Munch1 and Munch2 are replaced by a single stage which applies both transforms in one pass
+    int fused;
+    // Number of worker threads running the first stage, Munch1 (or FusedMunch in the fused mode) by default
+    int munch1Workers;
+    // Number of worker threads running every later stage, Munch2 by default
+    int munch2Workers;
+    // Maximum number of lines in flight when the output has to be reordered
+    int reorderWindow;
+    // If set and stdin is a regular file then it is mapped instead of being read
+    int mapInput;
+    // Number of strings each queue holds initially
+    int queueSize;
+    // Bounds of the size of each queue. The size adapts to the backpressure between them. Equal for fixed size queues.
+    int queueMin;
+    int queueMax;
+    // Policy used to pin the threads of the pipeline to cpus
+    PlacementPolicy placement;
+    // Number of times a thread waiting on a full or empty queue spins and yields before it parks
+    int waitSpin;
+    int waitYield;
+    // Comma separated stages run between the Reader and the Writer. See Stage module.
+    char* stages;
+    // If set then stdin is read and stdout is written with io_uring, if the kernel supports it
+    int ioUring;
+    // If set then lines which are too long for a buffer are passed through in segments instead of being skipped
+    int streamLongLines;
+    // Backend of the queues which have more than one producer or consumer thread, QUEUE_MPMC or QUEUE_LOCKED
+    QueueType sharedQueueType;
+    // If set then the Reader, every stage and the Writer run in separate processes sharing the queues in shared memory
+    int processes;
+    // Size in MB of the shared memory segment used by the processes
+    int sharedMemoryMB;
+    // If set then the lines are received from another prodcom process on this address instead of being read from stdin
+    char* listenAddress;
+    // If set then the lines are sent to another prodcom process on this address instead of being written to stdout
+    char* connectAddress;
+    // If set then metrics are exported to this file, or served on this Unix socket if it starts with 'unix:'
+    char* metricsTarget;
+    // Time between two snapshots of the metrics in milliseconds
+    int metricsIntervalMs;
+    // If set then 1 in traceSample lines are traced and the trace is written to this file as Chrome trace-event JSON
+    char* traceFile;
+    int traceSample;
+} Options;
+
+Options ParseOptions(int argc, char** argv);
+
+#endif
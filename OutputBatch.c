@@ -0,0 +1,236 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include "OutputBatch.h"
+#include "BufferPool.h"
+#include "Error.h"
+
+// Static utility functions
+static void skipWritten(struct iovec** iov, int* remaining, size_t written);
+static void submitBatch(OutputBatch* batch);
+static void waitForInflightBatch(OutputBatch* batch);
+static void releaseBuffers(char** buffers, int count);
+
+/**
+ * @function CreateOutputBatch
+ * @argument fd - File descriptor to which the lines are written. Example- 1 for stdout
+ * @description
+ * Initialize an empty OutputBatch struct and return it.
+ * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+OutputBatch* CreateOutputBatch(int fd){
+    OutputBatch* batch = malloc(sizeof(OutputBatch));
+    if(batch == NULL) {
+        PrintMallocErrorAndExit(OUTPUT_BATCH_MODULE, "Writer", "CreateOutputBatch");
+        return NULL;
+    }
+    batch->fd = fd;
+    batch->iov = batch->iovStorage[0];
+    batch->buffers = batch->bufferStorage[0];
+    batch->ring = NULL;
+    batch->inflightIovCount = 0;
+    batch->inflightCount = 0;
+    batch->iovCount = 0;
+    batch->count = 0;
+    batch->pendingBytes = 0;
+    batch->bytesWritten = 0;
+    batch->syscalls = 0;
+    return batch;
+}
+
+/**
+ * @function CreateAsyncOutputBatch
+ * @argument fd - File descriptor to which the lines are written. Example- 1 for stdout
+ * @description
+ * Initialize an empty OutputBatch struct whose batches are written with io_uring and return it.
+ * If io_uring is not available, a note is printed on stderr and NULL is returned so that the caller can use
+ * CreateOutputBatch instead.
+ * */
+OutputBatch* CreateAsyncOutputBatch(int fd){
+    IoRing* ring = CreateIoRing(2);
+    if(ring == NULL){
+        fprintf(stderr, "io_uring is not available (%s). Writing the output with writev(2).\n", strerror(errno));
+        return NULL;
+    }
+    OutputBatch* batch = CreateOutputBatch(fd);
+    batch->ring = ring;
+    return batch;
+}
+
+/**
+ * @function AppendToOutputBatch
+ * @argument batch - OutputBatch struct
+ * @argument record - Record of the line to be written. Its pooled buffer, if any, is released once the line is written.
+ * @description
+ * Add the line and the '\n' which follows it (unless it is a segment of a long line) to the batch. If the line starts
+ * right where the previous one ended then the previous iovec is extended instead of using a new one.
+ * If the batch is already full then it is flushed first.
+ * */
+void AppendToOutputBatch(OutputBatch* batch, Record record){
+    if(batch->count == OUTPUT_BATCH_LINES || batch->pendingBytes >= OUTPUT_BATCH_BYTES){
+        // With io_uring the full batch is written while the next one is filled
+        if(batch->ring != NULL){
+            submitBatch(batch);
+        } else {
+            FlushOutputBatch(batch);
+        }
+    }
+
+    char* data = record.data;
+    // A segment of a long line is not followed by a newline
+    size_t len = (size_t) record.length + ((record.flags & RECORD_CONTINUED) ? 0 : 1);
+    struct iovec* last = batch->iovCount > 0 ? &batch->iov[batch->iovCount - 1] : NULL;
+    if(last != NULL && (char*) last->iov_base + last->iov_len == data){
+        last->iov_len = last->iov_len + len;
+    } else {
+        batch->iov[batch->iovCount].iov_base = data;
+        batch->iov[batch->iovCount].iov_len = len;
+        batch->iovCount = batch->iovCount + 1;
+    }
+    batch->buffers[batch->count] = record.buffer;
+    batch->count = batch->count + 1;
+    batch->pendingBytes = batch->pendingBytes + len;
+}
+
+/**
+ * @function FlushOutputBatch
+ * @argument batch - OutputBatch struct
+ * @description
+ * Write all the lines in the batch using writev. Partial writes are continued from where they stopped.
+ * Once written, the buffers of the lines are released to their pool.
+ * With io_uring, the batch is submitted and this waits until it and the batch before it have been written.
+ * */
+void FlushOutputBatch(OutputBatch* batch){
+    if(batch->ring != NULL){
+        if(batch->count > 0) submitBatch(batch);
+        waitForInflightBatch(batch);
+        return;
+    }
+
+    struct iovec* iov = batch->iov;
+    int remaining = batch->iovCount;
+
+    while(remaining > 0){
+        ssize_t written = writev(batch->fd, iov, remaining);
+        if(written < 0){
+            if(errno == EINTR) continue;
+            PrintSystemCallErrorAndExit(OUTPUT_BATCH_MODULE, "Writer", "writev", errno);
+        }
+        batch->syscalls = batch->syscalls + 1;
+        batch->bytesWritten = batch->bytesWritten + (unsigned long long) written;
+        skipWritten(&iov, &remaining, (size_t) written);
+    }
+
+    releaseBuffers(batch->buffers, batch->count);
+    batch->iovCount = 0;
+    batch->count = 0;
+    batch->pendingBytes = 0;
+}
+
+/**
+ * @function PrintOutputBatchStats
+ * @argument batch - OutputBatch struct
+ * @description Print the number of bytes written and writev calls issued on stderr
+ * */
+void PrintOutputBatchStats(OutputBatch* batch){
+    fprintf(stderr, "Statistics of Writer output -\n");
+    fprintf(stderr, "Bytes written is %llu\n", batch->bytesWritten);
+    if(batch->ring != NULL){
+        fprintf(stderr, "io_uring writev operations is %llu\n\n", batch->syscalls);
+    } else {
+        fprintf(stderr, "writev calls is %llu\n\n", batch->syscalls);
+    }
+}
+
+/**
+ * @function submitBatch
+ * @argument batch - OutputBatch struct which writes with io_uring
+ * @description
+ * Wait for the write of the previous batch and then submit this batch as a single writev. The other half of the
+ * storage becomes the batch which is filled next.
+ * */
+static void submitBatch(OutputBatch* batch){
+    waitForInflightBatch(batch);
+
+    batch->inflightIov = batch->iov;
+    batch->inflightIovCount = batch->iovCount;
+    batch->inflightBuffers = batch->buffers;
+    batch->inflightCount = batch->count;
+    PrepareIoRingWritev(batch->ring, batch->fd, batch->inflightIov, (unsigned) batch->inflightIovCount, 0);
+    SubmitIoRing(batch->ring);
+    batch->syscalls = batch->syscalls + 1;
+
+    int half = batch->iov == batch->iovStorage[0] ? 1 : 0;
+    batch->iov = batch->iovStorage[half];
+    batch->buffers = batch->bufferStorage[half];
+    batch->iovCount = 0;
+    batch->count = 0;
+    batch->pendingBytes = 0;
+}
+
+/**
+ * @function waitForInflightBatch
+ * @argument batch - OutputBatch struct which writes with io_uring
+ * @description
+ * Wait until the batch in flight has been written completely and release its buffers. A partial write is submitted
+ * again from where it stopped.
+ * In case of a write error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+static void waitForInflightBatch(OutputBatch* batch){
+    unsigned long long userData;
+    while(batch->inflightIovCount > 0){
+        int written = WaitIoRingCompletion(batch->ring, &userData);
+        if(written < 0 && written != -EINTR && written != -EAGAIN){
+            PrintSystemCallErrorAndExit(OUTPUT_BATCH_MODULE, "Writer", "io_uring writev", -written);
+        }
+        if(written > 0){
+            batch->bytesWritten = batch->bytesWritten + (unsigned long long) written;
+            skipWritten(&batch->inflightIov, &batch->inflightIovCount, (size_t) written);
+        }
+        if(batch->inflightIovCount > 0){
+            PrepareIoRingWritev(batch->ring, batch->fd, batch->inflightIov, (unsigned) batch->inflightIovCount, 0);
+            SubmitIoRing(batch->ring);
+            batch->syscalls = batch->syscalls + 1;
+        }
+    }
+    releaseBuffers(batch->inflightBuffers, batch->inflightCount);
+    batch->inflightCount = 0;
+}
+
+/**
+ * @function skipWritten
+ * @argument iov - First iovec which has not been written completely. Moved past the written iovecs.
+ * @argument remaining - Number of iovecs from iov onwards. Reduced by the written iovecs.
+ * @argument written - Number of bytes written
+ * @description Skip the iovecs which were written completely and adjust the one which was written partially
+ * */
+static void skipWritten(struct iovec** iov, int* remaining, size_t written){
+    while(*remaining > 0 && written >= (*iov)->iov_len){
+        written = written - (*iov)->iov_len;
+        (*iov)++;
+        (*remaining)--;
+    }
+    if(*remaining > 0){
+        (*iov)->iov_base = (char*) (*iov)->iov_base + written;
+        (*iov)->iov_len = (*iov)->iov_len - written;
+    }
+}
+
+/**
+ * @function releaseBuffers
+ * @argument buffers - Buffers of the lines which have been written
+ * @argument count - Number of buffers
+ * @description Return the buffers to their pool
+ * */
+static void releaseBuffers(char** buffers, int count){
+    for(int index = 0; index < count; index++){
+        ReleaseLineBuffer(buffers[index]);
+    }
+}
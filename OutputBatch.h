@@ -0,0 +1,76 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module gathers the lines printed by the Writer into a batch of iovecs which is written using a single writev(2).
+ * Every line is followed by its '\n' (see Record and Threads modules), so a line needs a single iovec. Lines which
+ * follow each other in memory, e.g. views of consecutive lines of the mapped input, share one iovec.
+ * The buffers of the lines are kept in the batch until it is written and only then released to their pool.
+ * A batch is flushed explicitly by the caller or when it is full. The number of bytes and system calls is recorded.
+ *
+ * With CreateAsyncOutputBatch a full batch is submitted to io_uring as a writev and the next batch is filled while it is
+ * being written. Its buffers are released once the write has completed. Only one write is in flight at a time so that
+ * the output stays in order. FlushOutputBatch still waits until everything has been written.
+ *
+ * @functions
+ * CreateOutputBatch - Return an empty OutputBatch struct which writes to the given file descriptor
+ * CreateAsyncOutputBatch - Same as CreateOutputBatch but batches are written with io_uring. NULL if it is not available.
+ * AppendToOutputBatch - Add the record of a line to the batch. Flushes the batch first if it is full.
+ * FlushOutputBatch - Write every line in the batch and release their buffers
+ * PrintOutputBatchStats - Print the number of bytes and system calls used to write the output
+ * */
+
+#ifndef ASSIGNMENT2_OUTPUTBATCH_H
+#define ASSIGNMENT2_OUTPUTBATCH_H
+
+#include <stddef.h>
+#include <sys/uio.h>
+#include "IoRing.h"
+#include "Record.h"
+
+#define OUTPUT_BATCH_MODULE "OutputBatch"
+// Maximum number of lines in a batch. Must not exceed IOV_MAX (1024 on Linux).
+#define OUTPUT_BATCH_LINES 1024
+// A batch is flushed once it holds this many bytes
+#define OUTPUT_BATCH_BYTES (256 * 1024)
+
+typedef struct {
+    // File descriptor to which the batch is written
+    int fd;
+    // One iovec per run of adjacent lines. Each line ends with '\n'. Points to one half of iovStorage.
+    struct iovec* iov;
+    // Number of iovecs in use
+    int iovCount;
+    // Pooled buffers to be released once the batch is written (NULL for a line outside the pool). Points to one half
+    // of bufferStorage.
+    char** buffers;
+    // Number of lines in the batch
+    int count;
+    // Number of bytes in the batch
+    size_t pendingBytes;
+
+    // Total bytes written
+    unsigned long long bytesWritten;
+    // Total writev calls issued (including the ones which wrote partially)
+    unsigned long long syscalls;
+
+    // Ring to which full batches are submitted. NULL if batches are written with writev(2).
+    IoRing* ring;
+    // Batch whose write is in flight, in the other half of the storage. Iovecs which have been written are skipped.
+    struct iovec* inflightIov;
+    int inflightIovCount;
+    char** inflightBuffers;
+    int inflightCount;
+    // The batch being filled and the batch being written
+    struct iovec iovStorage[2][OUTPUT_BATCH_LINES];
+    char* bufferStorage[2][OUTPUT_BATCH_LINES];
+} OutputBatch;
+
+OutputBatch* CreateOutputBatch(int fd);
+OutputBatch* CreateAsyncOutputBatch(int fd);
+void AppendToOutputBatch(OutputBatch* batch, Record record);
+void FlushOutputBatch(OutputBatch* batch);
+void PrintOutputBatchStats(OutputBatch* batch);
+
+#endif
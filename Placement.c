@@ -0,0 +1,303 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sched.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "Placement.h"
+#include "Error.h"
+
+// Number of words in the node mask passed to mbind. Covers nodes 0 to 1023.
+#define NODE_MASK_WORDS (1024 / (8 * sizeof(unsigned long)))
+
+// Function and name of a thread, passed to startNamed. The name is truncated to the 15 characters the kernel keeps.
+typedef struct {
+    char name[16];
+    void* (*start)(void*);
+    void* argument;
+} NamedStart;
+
+// Static utility functions
+static void readTopology(Placement* placement);
+static int readFirstCpu(int cpu, const char* file, int fallback);
+static int readCacheGroup(int cpu, int level, int fallback);
+static int readNode(int cpu);
+static int compareCpus(const void* left, const void* right);
+static void* startNamed(void* ptr);
+
+/**
+ * @function CreatePlacement
+ * @argument policy - Policy used to choose the cpus
+ * @argument threadCount - Number of threads of the pipeline
+ * @description
+ * Return a Placement struct. For any policy other than PLACEMENT_NONE, the topology of the allowed cpus is read and
+ * ordered so that thread i of the pipeline runs on cpus[i % cpuCount].
+ * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+Placement* CreatePlacement(PlacementPolicy policy, int threadCount){
+    Placement* placement = malloc(sizeof(Placement));
+    if(placement == NULL) {
+        PrintMallocErrorAndExit(PLACEMENT_MODULE, "Placement", "CreatePlacement");
+        return NULL;
+    }
+    placement->policy = policy;
+    placement->cpus = NULL;
+    placement->cpuCount = 0;
+    placement->nodeCount = 1;
+    placement->threadCount = threadCount;
+
+    if(policy != PLACEMENT_NONE) readTopology(placement);
+    // Nothing to pin to if the allowed cpus cannot be found
+    if(placement->cpuCount == 0) placement->policy = PLACEMENT_NONE;
+    return placement;
+}
+
+/**
+ * @function GetPlacementNode
+ * @argument placement - Placement struct
+ * @argument threadIndex - Position of the thread in the pipeline
+ * @description
+ * Return the NUMA node of the cpu the thread is pinned to. Returns -1 if the threads are not pinned or all the allowed
+ * cpus are on a single node, in which case there is nothing to gain from binding memory.
+ * */
+int GetPlacementNode(Placement* placement, int threadIndex){
+    if(placement->policy == PLACEMENT_NONE || placement->nodeCount <= 1) return -1;
+    return placement->cpus[threadIndex % placement->cpuCount].node;
+}
+
+/**
+ * @function CreatePlacedThread
+ * @argument placement - Placement struct
+ * @argument threadIndex - Position of the thread in the pipeline
+ * @argument name - Name of the stage run by the thread. Used for the message printed on stderr and as thread name.
+ * @argument thread - Set to the created thread
+ * @argument start - Function run by the thread
+ * @argument argument - Argument passed to the function
+ * @description
+ * Create the thread with an affinity attribute which pins it to its cpu and print the cpu on stderr.
+ * Without a placement it is a plain pthread_create. Either way the thread is named after its stage, so that top, perf
+ * and traces (Trace module) show which stage it runs. Returns the value of pthread_create.
+ * */
+int CreatePlacedThread(Placement* placement, int threadIndex, char* name, pthread_t* thread,
+                       void* (*start)(void*), void* argument){
+    // The thread names itself before it runs its function, so the name is set before its first trace event
+    NamedStart* namedStart = malloc(sizeof(NamedStart));
+    if(namedStart == NULL) PrintMallocErrorAndExit(PLACEMENT_MODULE, name, "NamedStart");
+    snprintf(namedStart->name, sizeof(namedStart->name), "%s", name);
+    namedStart->start = start;
+    namedStart->argument = argument;
+
+    if(placement->policy == PLACEMENT_NONE) {
+        int retVal = pthread_create(thread, NULL, startNamed, namedStart);
+        if(retVal != 0) free(namedStart);
+        return retVal;
+    }
+
+    CpuTopology* cpu = &placement->cpus[threadIndex % placement->cpuCount];
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu->cpu, &set);
+
+    pthread_attr_t attributes;
+    int retVal = pthread_attr_init(&attributes);
+    if(retVal != 0) {
+        free(namedStart);
+        return retVal;
+    }
+    retVal = pthread_attr_setaffinity_np(&attributes, sizeof(set), &set);
+    if(retVal == 0) retVal = pthread_create(thread, &attributes, startNamed, namedStart);
+    pthread_attr_destroy(&attributes);
+
+    if(retVal != 0) {
+        free(namedStart);
+        return retVal;
+    }
+
+    fprintf(stderr, "Thread %d (%s) is pinned to cpu %d (node %d, package %d, L3 of cpu %d, L2 of cpu %d)\n",
+            threadIndex, name, cpu->cpu, cpu->node, cpu->package, cpu->l3, cpu->l2);
+    return 0;
+}
+
+/**
+ * @function BindMemoryToNode
+ * @argument address - Start of the memory range
+ * @argument length - Length of the memory range in bytes
+ * @argument node - NUMA node on which the pages should be kept. Nothing is done for a negative node.
+ * @description
+ * Set the MPOL_PREFERRED policy for the pages of the range and move the pages which already exist.
+ * The range is widened to whole pages, so neighbouring data on the first and last page moves with it.
+ * Returns 0 on success and -1 if the kernel refused, which callers may ignore as the binding is only a hint.
+ * */
+int BindMemoryToNode(void* address, size_t length, int node){
+    if(node < 0 || address == NULL || length == 0) return 0;
+    if((size_t) node >= NODE_MASK_WORDS * 8 * sizeof(unsigned long)) return -1;
+
+    uintptr_t pageSize = (uintptr_t) sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t) address & ~(pageSize - 1);
+    uintptr_t end = ((uintptr_t) address + length + pageSize - 1) & ~(pageSize - 1);
+
+    unsigned long mask[NODE_MASK_WORDS];
+    memset(mask, 0, sizeof(mask));
+    mask[(size_t) node / (8 * sizeof(unsigned long))] = 1UL << ((size_t) node % (8 * sizeof(unsigned long)));
+
+    long retVal = syscall(SYS_mbind, (void*) start, (unsigned long) (end - start), MPOL_PREFERRED, mask,
+                          (unsigned long) (8 * sizeof(mask)), MPOL_MF_MOVE);
+    return retVal == 0 ? 0 : -1;
+}
+
+/**
+ * @function readTopology
+ * @argument placement - Placement struct
+ * @description
+ * Read the package, caches, core and node of every cpu the process may run on and sort the cpus in placement order.
+ * Leaves cpuCount at 0 if the affinity of the process cannot be read.
+ * */
+static void readTopology(Placement* placement){
+    cpu_set_t allowed;
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+
+    placement->cpus = malloc(sizeof(CpuTopology) * (size_t) CPU_COUNT(&allowed));
+    if(placement->cpus == NULL) {
+        PrintMallocErrorAndExit(PLACEMENT_MODULE, "Placement", "Topology");
+        return;
+    }
+
+    int count = 0;
+    for(int cpu = 0; cpu < CPU_SETSIZE; cpu++){
+        if(!CPU_ISSET(cpu, &allowed)) continue;
+        CpuTopology* topology = &placement->cpus[count++];
+        topology->cpu = cpu;
+        topology->package = readFirstCpu(cpu, "topology/physical_package_id", 0);
+        topology->core = readFirstCpu(cpu, "topology/thread_siblings_list", cpu);
+        topology->l2 = readCacheGroup(cpu, 2, topology->core);
+        topology->l3 = readCacheGroup(cpu, 3, readFirstCpu(cpu, "topology/core_siblings_list", topology->l2));
+        topology->node = readNode(cpu);
+        topology->sibling = 0;
+    }
+
+    // A cpu is a sibling of every allowed cpu below it which belongs to the same core
+    for(int index = 0; index < count; index++){
+        for(int other = 0; other < index; other++){
+            if(placement->cpus[other].core == placement->cpus[index].core) placement->cpus[index].sibling++;
+        }
+    }
+    qsort(placement->cpus, (size_t) count, sizeof(CpuTopology), compareCpus);
+
+    // Count the distinct nodes
+    placement->nodeCount = 0;
+    for(int index = 0; index < count; index++){
+        int seen = 0;
+        for(int other = 0; other < index && !seen; other++) seen = placement->cpus[other].node == placement->cpus[index].node;
+        if(!seen) placement->nodeCount++;
+    }
+    placement->cpuCount = count;
+}
+
+/**
+ * @function readFirstCpu
+ * @argument cpu - Number of the cpu
+ * @argument file - File below /sys/devices/system/cpu/cpuN. Example- topology/thread_siblings_list
+ * @argument fallback - Value returned if the file cannot be read
+ * @description Return the first number in the file. For a cpu list that is the lowest cpu of the list.
+ * */
+static int readFirstCpu(int cpu, const char* file, int fallback){
+    char path[256];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", cpu, file);
+    FILE* stream = fopen(path, "r");
+    if(stream == NULL) return fallback;
+    int value;
+    if(fscanf(stream, "%d", &value) != 1) value = fallback;
+    fclose(stream);
+    return value;
+}
+
+/**
+ * @function readCacheGroup
+ * @argument cpu - Number of the cpu
+ * @argument level - Level of the cache. Example- 3
+ * @argument fallback - Value returned if the cpu has no cache of this level
+ * @description Return the lowest cpu which shares the data (or unified) cache of the given level with this cpu
+ * */
+static int readCacheGroup(int cpu, int level, int fallback){
+    for(int index = 0; ; index++){
+        char file[64], type[32] = "";
+        snprintf(file, sizeof(file), "cache/index%d/level", index);
+        int cacheLevel = readFirstCpu(cpu, file, -1);
+        if(cacheLevel < 0) return fallback;
+        if(cacheLevel != level) continue;
+
+        char path[256];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/type", cpu, index);
+        FILE* stream = fopen(path, "r");
+        if(stream != NULL){
+            if(fscanf(stream, "%31s", type) != 1) type[0] = '\0';
+            fclose(stream);
+        }
+        if(strcmp(type, "Instruction") == 0) continue;
+
+        snprintf(file, sizeof(file), "cache/index%d/shared_cpu_list", index);
+        return readFirstCpu(cpu, file, fallback);
+    }
+}
+
+/**
+ * @function readNode
+ * @argument cpu - Number of the cpu
+ * @description Return the NUMA node of the cpu, i.e. N of the nodeN link in its /sys directory. 0 if there is none.
+ * */
+static int readNode(int cpu){
+    char path[256];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR* directory = opendir(path);
+    if(directory == NULL) return 0;
+
+    int node = 0;
+    struct dirent* entry;
+    while((entry = readdir(directory)) != NULL){
+        if(strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9'){
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(directory);
+    return node;
+}
+
+/**
+ * @function compareCpus
+ * @argument left, right - CpuTopology structs
+ * @description
+ * qsort order of the compact policy- package, L3 group, SMT sibling position, L2 group and finally the cpu number.
+ * */
+static int compareCpus(const void* left, const void* right){
+    const CpuTopology* a = left;
+    const CpuTopology* b = right;
+    if(a->package != b->package) return a->package < b->package ? -1 : 1;
+    if(a->l3 != b->l3) return a->l3 < b->l3 ? -1 : 1;
+    if(a->sibling != b->sibling) return a->sibling < b->sibling ? -1 : 1;
+    if(a->l2 != b->l2) return a->l2 < b->l2 ? -1 : 1;
+    return a->cpu < b->cpu ? -1 : (a->cpu > b->cpu ? 1 : 0);
+}
+
+/**
+ * @function startNamed
+ * @argument ptr - NamedStart struct. Freed before the function of the thread runs.
+ * @description
+ * Start routine of every placed thread. Set the name of the thread and run its function. The name is only a hint,
+ * so a failure is ignored.
+ * */
+static void* startNamed(void* ptr){
+    NamedStart namedStart = *(NamedStart*) ptr;
+    free(ptr);
+    pthread_setname_np(pthread_self(), namedStart.name);
+    return namedStart.start(namedStart.argument);
+}
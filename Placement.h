@@ -0,0 +1,79 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module decides on which cpu each thread of the pipeline runs and on which NUMA node the memory a stage reads is
+ * allocated. Without a placement the scheduler is free to migrate the threads, and adjacent stages may end up on
+ * different sockets so that every line crosses the interconnect.
+ *
+ * The topology is read from /sys/devices/system/cpu. Only the cpus the process is allowed to run on are used.
+ * With the compact policy the cpus are ordered by package, then by the L3 cache they share, then by the L2 cache (core)
+ * they share, with the first hardware thread of every core ahead of its SMT siblings. Threads are handed out in pipeline
+ * order (Reader, Munch1 workers, Munch2 workers, Writer), so adjacent stages run on cores which share a cache and only
+ * share a core once every core of the cache has a thread. If there are more threads than cpus, they wrap around.
+ *
+ * Memory is moved to a node with mbind(2) and the MPOL_PREFERRED policy, so an allocation still succeeds when the node
+ * is full. The system call is made directly so that no libnuma is needed. Binding is a hint- on a machine with a single
+ * node, or when the kernel refuses, nothing happens.
+ *
+ * @functions
+ * CreatePlacement - Read the topology and choose the cpu of every thread of the pipeline
+ * GetPlacementNode - NUMA node of the cpu a thread runs on, or -1 if the thread is not pinned
+ * CreatePlacedThread - pthread_create which pins the thread to its cpu and prints where it runs
+ * BindMemoryToNode - Ask the kernel to keep the pages of a memory range on a NUMA node
+ * */
+
+#ifndef ASSIGNMENT2_PLACEMENT_H
+#define ASSIGNMENT2_PLACEMENT_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+#define PLACEMENT_MODULE "Placement"
+
+// Policies for the placement of the threads
+typedef enum {
+    // Leave the threads to the scheduler
+    PLACEMENT_NONE,
+    // Pin adjacent stages to cores which share a cache
+    PLACEMENT_COMPACT
+} PlacementPolicy;
+
+// Topology of a single cpu
+typedef struct {
+    // Number of the cpu
+    int cpu;
+    // NUMA node of the cpu. 0 if the kernel has no NUMA support.
+    int node;
+    // Socket of the cpu
+    int package;
+    // Lowest cpu which shares the last level cache with this cpu
+    int l3;
+    // Lowest cpu which shares the L2 cache (usually the core) with this cpu
+    int l2;
+    // Lowest hardware thread of the core of this cpu
+    int core;
+    // Position of this cpu among the SMT siblings of its core. 0 for the first hardware thread.
+    int sibling;
+} CpuTopology;
+
+typedef struct {
+    // Policy used to choose the cpus
+    PlacementPolicy policy;
+    // Allowed cpus in the order in which threads are placed on them
+    CpuTopology* cpus;
+    int cpuCount;
+    // Number of distinct NUMA nodes among the allowed cpus
+    int nodeCount;
+    // Number of threads which are placed
+    int threadCount;
+} Placement;
+
+Placement* CreatePlacement(PlacementPolicy policy, int threadCount);
+int GetPlacementNode(Placement* placement, int threadIndex);
+int CreatePlacedThread(Placement* placement, int threadIndex, char* name, pthread_t* thread,
+                       void* (*start)(void*), void* argument);
+int BindMemoryToNode(void* address, size_t length, int node);
+
+#endif
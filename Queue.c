@@ -3,144 +3,753 @@
  * @author Sidharth Gurbani, gurbani, gurbani
  * */
 
-#include <stdlib.h>
-#include <time.h>
+#include <errno.h>
 #include "Queue.h"
+#include "Placement.h"
+#include "Trace.h"
 #include "Error.h"
 
+// Static utility functions
+static void enqueueLocked(Queue *q, Record record);
+static Record dequeueLocked(Queue *q);
+static int enqueueLockedBatch(Queue *q, Record *records, int count);
+static int dequeueLockedBatch(Queue *q, Record *records, int maxCount);
+static int acquirePermits(Queue *q, sem_t *sem, int maxCount, char* functionalIdentity);
+static void waitForPermit(Queue *q, sem_t *sem, char* functionalIdentity);
+static void recordBlockedOnFull(Queue *q, unsigned long long start, unsigned long long end);
+static void recordBlockedOnEmpty(Queue *q, unsigned long long start, unsigned long long end);
+static void recordOccupancy(Queue *q, int occupancy);
+static void adaptCapacity(Queue *q, unsigned long long now);
+static int resizeLocked(Queue *q, int capacity, int target);
+static int tryTakePermit(void *context);
+static int tryPushRing(void *context);
+static int tryPopRing(void *context);
+static size_t ringTryPush(Queue *q, Record *records, size_t count);
+static size_t ringTryPop(Queue *q, Record *records, size_t maxCount);
+static int ringSize(Queue *q);
+
+// Attempt to take a permit of the empty or full semaphore. Used as the condition of a wait.
+typedef struct {
+    Queue *q;
+    sem_t *sem;
+    char* functionalIdentity;
+} PermitAttempt;
+
+// Attempt to push or pop records on the lock-free ring. Used as the condition of a wait.
+typedef struct {
+    Queue *q;
+    Record *records;
+    size_t count;
+    size_t moved;
+} RingAttempt;
+
 /**
  * @function CreateStringQueue
  * @argument size - size of the queue
  * @argument queueIdentity - Name associated with the queue
- * @description This method initializes a new instance of the queue and returns the same.
+ * @description This method initializes a new instance of the semaphore based queue and returns the same.
  * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
  * */
 Queue *CreateStringQueue(int size, char* queueIdentity) {
+    return CreateStringQueueOfType(size, queueIdentity, QUEUE_LOCKED);
+}
+
+/**
+ * @function CreateStringQueueOfType
+ * @argument size - size of the queue
+ * @argument queueIdentity - Name associated with the queue
+ * @argument type - Backend to be used for this queue
+ * @description This method initializes a new instance of the queue with the given backend and returns the same.
+ * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+Queue *CreateStringQueueOfType(int size, char* queueIdentity, QueueType type) {
+    return CreateAdaptiveStringQueue(size, size, size, queueIdentity, type);
+}
+
+/**
+ * @function CreateAdaptiveStringQueue
+ * @argument size - Initial size of the queue. Clamped between minSize and maxSize.
+ * @argument minSize - Smallest size the queue shrinks to
+ * @argument maxSize - Largest size the queue grows to. Space for this many records is allocated up front.
+ * @argument queueIdentity - Name associated with the queue
+ * @argument type - Backend to be used for this queue
+ * @description This method initializes a new instance of the queue whose size adapts to the backpressure between
+ * minSize and maxSize and returns the same. With minSize equal to maxSize the size is fixed.
+ * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+Queue *CreateAdaptiveStringQueue(int size, int minSize, int maxSize, char* queueIdentity, QueueType type) {
+    return CreateSharedStringQueue(size, minSize, maxSize, queueIdentity, type, NULL);
+}
 
-    // Allocate the space for Queue struct using malloc
-    Queue *stringQueue = malloc(sizeof(Queue));
-    // If malloc returns an error then print the error message and exit
+/**
+ * @function CreateSharedStringQueue
+ * @argument size - Initial size of the queue. Clamped between minSize and maxSize.
+ * @argument minSize - Smallest size the queue shrinks to
+ * @argument maxSize - Largest size the queue grows to. Space for this many records is allocated up front.
+ * @argument queueIdentity - Name associated with the queue
+ * @argument type - Backend to be used for this queue
+ * @argument segment - Shared memory segment in which the queue is placed. NULL keeps it private to this process.
+ * @description This method initializes a new instance of the adaptive queue in the given segment and returns the same.
+ * The queue can then be used by threads of every process which maps the segment at the same address.
+ * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+Queue *CreateSharedStringQueue(int size, int minSize, int maxSize, char* queueIdentity, QueueType type, SharedSegment* segment) {
+    if(minSize < 1) minSize = 1;
+    if(maxSize < minSize) maxSize = minSize;
+    if(size < minSize) size = minSize;
+    if(size > maxSize) size = maxSize;
+
+    // Allocate the space for Queue struct. The wait points are cache line aligned.
+    Queue *stringQueue = AllocateAligned(segment, 64, sizeof(Queue));
+    // If the allocation fails then print the error message and exit
     if(stringQueue == NULL) {
         PrintMallocErrorAndExit(QUEUE_MODULE, queueIdentity, "Queue Structure");
         return NULL;
     }
 
-    // Set the name associated with the queue
+    // Set the name and backend associated with the queue
     stringQueue->queueIdentity = queueIdentity;
+    stringQueue->type = type;
+    stringQueue->segment = segment;
+    stringQueue->ring = NULL;
+    stringQueue->mpmcRing = NULL;
 
-    // Set the size of the queue
-    stringQueue->capacity = size;
+    // Set the size of the queue and its bounds
+    atomic_init(&stringQueue->capacity, size);
+    stringQueue->minCapacity = minSize;
+    stringQueue->maxCapacity = maxSize;
     // Initialise the front and end of the queue to 0
     stringQueue->front = 0;
     stringQueue->end = 0;
-    // Allocate space for the string array
-    stringQueue->queue = malloc(sizeof(char *) * size);
-    // If malloc returns an error then print the corresponding error message and exit
+    stringQueue->size = 0;
+    // Create stats struct by calling the appropriate method from statistics module
+    stringQueue->stats = CreateStatistics(queueIdentity, size, segment);
+
+    // The controller starts its first period now
+    atomic_flag_clear(&stringQueue->adapting);
+    atomic_init(&stringQueue->periodStart, GetMonotonicTime());
+    atomic_init(&stringQueue->blockedOnFullTime, 0);
+    atomic_init(&stringQueue->blockedOnEmptyTime, 0);
+    stringQueue->periodBlockedOnFull = 0;
+    stringQueue->periodBlockedOnEmpty = 0;
+    atomic_init(&stringQueue->peakOccupancy, 0);
+
+    // Waiting threads spin, then yield and then park until the other side signals
+    stringQueue->waitPolicy.spinLimit = WAIT_DEFAULT_SPIN_LIMIT;
+    stringQueue->waitPolicy.yieldLimit = WAIT_DEFAULT_YIELD_LIMIT;
+    InitWaitPoint(&stringQueue->notFull, segment != NULL);
+    InitWaitPoint(&stringQueue->notEmpty, segment != NULL);
+
+    // The lock-free backend keeps its own ring and does not need the array or the semaphores
+    if(type == QUEUE_SPSC) {
+        stringQueue->queue = NULL;
+        stringQueue->ring = CreateSpscRing((size_t) maxSize, queueIdentity, segment);
+        SpscRingSetCapacity(stringQueue->ring, (size_t) size);
+        return stringQueue;
+    }
+    if(type == QUEUE_MPMC) {
+        stringQueue->queue = NULL;
+        stringQueue->mpmcRing = CreateMpmcRing((size_t) maxSize, queueIdentity, segment);
+        MpmcRingSetCapacity(stringQueue->mpmcRing, (size_t) size);
+        return stringQueue;
+    }
+
+    // Allocate space for the record array
+    stringQueue->queue = AllocateAligned(segment, 64, sizeof(Record) * maxSize);
+    // If the allocation fails then print the corresponding error message and exit
     if(stringQueue->queue == NULL) {
-        free(stringQueue);
         PrintMallocErrorAndExit(QUEUE_MODULE, queueIdentity, "Queue Array");
         return NULL;
     }
 
     int retVal;
+    // The semaphores of a queue in a shared segment are used by several processes
+    int pshared = segment != NULL;
     // Initialize lock semaphore with initial value of 1. In case of error print error message and exit.
-    retVal = sem_init(&stringQueue->lock, 0, 1);
+    retVal = sem_init(&stringQueue->lock, pshared, 1);
     if(retVal != 0) PrintSemInitErrorAndExit(QUEUE_MODULE, queueIdentity, "Lock");
     // Initialize full semaphore with initial value of 0. In case of error print error message and exit.
-    retVal = sem_init(&stringQueue->full, 0, 0);
+    retVal = sem_init(&stringQueue->full, pshared, 0);
     if(retVal != 0) PrintSemInitErrorAndExit(QUEUE_MODULE, queueIdentity, "Full");
     // Initialize empty semaphore with initial value of size. In case of error print error message and exit.
     // This is done as initially the queue would be empty and would have 'size' available slots.
-    retVal = sem_init(&stringQueue->empty, 0, size);
+    retVal = sem_init(&stringQueue->empty, pshared, size);
     if(retVal != 0) PrintSemInitErrorAndExit(QUEUE_MODULE, queueIdentity, "Empty");
 
-    // Create stats struct by calling the appropriate method from statistics module
-    stringQueue->stats = CreateStatistics(queueIdentity);
-
     return stringQueue;
 }
 
 /**
  * @function EnqueueString
  * @argument q - Queue struct
- * @argument string - String to be enqueued
+ * @argument record - Record of the line to be enqueued
+ * @description
+ * Enqueue the given record in the given queue.
+ * The access to this queue should be synchronized.
+ * */
+void EnqueueString(Queue *q, Record record) {
+    // A traced line enters the queue when it is offered, so its slice includes the time blocked on a full queue
+    TraceRecords(TRACE_ENQUEUE, q->queueIdentity, &record, 1);
+    if(q->type == QUEUE_LOCKED) {
+        enqueueLocked(q, record);
+        return;
+    }
+
+    // Lock-free backend. The wait is only used if the ring is full.
+    unsigned long long start = GetMonotonicTime();
+    if(ringTryPush(q, &record, 1) == 0){
+        RingAttempt attempt = {q, &record, 1, 0};
+        UpdateWaitPhase(q->stats, (int) AwaitCondition(&q->notFull, &q->waitPolicy, tryPushRing, &attempt));
+        recordBlockedOnFull(q, start, GetMonotonicTime());
+    }
+    SignalWaitPoint(&q->notEmpty, 1);
+    unsigned long long end = GetMonotonicTime();
+    UpdateEnqueueCount(q->stats, 1);
+    UpdateEnqueueTime(q->stats, start, end);
+    recordOccupancy(q, ringSize(q));
+    adaptCapacity(q, end);
+}
+
+/**
+ * @function DequeueString
+ * @argument q - Queue struct
  * @description
- * Enqueue the given string in the given queue.
+ * Dequeue the record of a line from the queue.
  * The access to this queue should be synchronized.
  * */
-void EnqueueString(Queue *q, char *string) {
+Record DequeueString(Queue *q) {
+    Record record;
+    if(q->type == QUEUE_LOCKED) {
+        record = dequeueLocked(q);
+        TraceRecords(TRACE_DEQUEUE, q->queueIdentity, &record, 1);
+        return record;
+    }
+
+    // Lock-free backend. The wait is only used if the ring is empty.
+    unsigned long long start = GetMonotonicTime();
+    if(ringTryPop(q, &record, 1) == 0){
+        RingAttempt attempt = {q, &record, 1, 0};
+        UpdateWaitPhase(q->stats, (int) AwaitCondition(&q->notEmpty, &q->waitPolicy, tryPopRing, &attempt));
+        recordBlockedOnEmpty(q, start, GetMonotonicTime());
+    }
+    SignalWaitPoint(&q->notFull, 1);
+    unsigned long long end = GetMonotonicTime();
+    UpdateDequeueCount(q->stats, 1);
+    UpdateDequeueTime(q->stats, start, end);
+    recordOccupancy(q, ringSize(q));
+    TraceRecords(TRACE_DEQUEUE, q->queueIdentity, &record, 1);
+    return record;
+}
+
+/**
+ * @function enqueueLocked
+ * @argument q - Queue struct
+ * @argument record - Record to be enqueued
+ * @description
+ * Enqueue the given record in the semaphore based queue.
+ * */
+static void enqueueLocked(Queue *q, Record record) {
 
     int retVal;
     // Start the clock timer
-    clock_t start = clock();
+    unsigned long long start = GetMonotonicTime();
     // Check if the queue has empty slot. If so the proceed else wait.
-    retVal = sem_wait(&q->empty);
-    // In case of error print error message and exit
-    if(retVal != 0) PrintSemWaitErrorAndExit(QUEUE_MODULE, q->queueIdentity, "Enqueue-Empty");
+    waitForPermit(q, &q->empty, "Enqueue-Empty");
     // If we have an empty slot then lock this function or wait to lock it.
     retVal = sem_wait(&q->lock);
     // In case of error print error message and exit
     if(retVal != 0) PrintSemWaitErrorAndExit(QUEUE_MODULE, q->queueIdentity, "Enqueue-Lock");
 
-    // Enqueue the string and update the enqueue count
-    q->queue[q->end] = string;
-    q->end = (q->end + 1) % q->capacity;
-    UpdateEnqueueCount(q->stats, 1);
-
+    // Enqueue the record and update the enqueue count
+    q->queue[q->end] = record;
+    q->end = (q->end + 1) % q->maxCapacity;
+    int occupancy = ++q->size;
 
     // Increment the full semaphore to indicate that an entry was added
     retVal = sem_post(&q->full);
     if(retVal != 0) PrintSemPostErrorAndExit(QUEUE_MODULE, q->queueIdentity, "Enqueue-Full");
 
-    // End clock timer and update the enqueue time.
-    clock_t end = clock();
-    UpdateEnqueueTime(q->stats, start, end);
-
     // Release the lock on this method
     retVal = sem_post(&q->lock);
     if(retVal != 0) PrintSemPostErrorAndExit(QUEUE_MODULE, q->queueIdentity, "Enqueue-Lock");
+    // Wake a consumer parked on the empty queue, if there is one
+    SignalWaitPoint(&q->notEmpty, 1);
+
+    // End clock timer and update the enqueue count and time. The stats do not need the queue lock.
+    unsigned long long end = GetMonotonicTime();
+    UpdateEnqueueCount(q->stats, 1);
+    UpdateEnqueueTime(q->stats, start, end);
+    recordOccupancy(q, occupancy);
+    adaptCapacity(q, end);
 }
 
 /**
- * @function DequeueString
+ * @function dequeueLocked
  * @argument q - Queue struct
  * @description
- * Dequeue a string from the queue.
- * The access to this queue should be synchronized.
+ * Dequeue a record from the semaphore based queue.
  * */
-char *DequeueString(Queue *q) {
+static Record dequeueLocked(Queue *q) {
 
     int retVal;
     // Start the clock
-    clock_t start = clock();
+    unsigned long long start = GetMonotonicTime();
     // Check if the queue has some entry which can be dequeued. If so then proceed else wait for an entry to be added.
-    retVal = sem_wait(&q->full);
-    // In case of error print error message and exit
-    if(retVal != 0) PrintSemWaitErrorAndExit(QUEUE_MODULE, q->queueIdentity, "Dequeue-Full");
+    waitForPermit(q, &q->full, "Dequeue-Full");
     // If the entry is available in queue for dequeue then lock this method or wait to lock it.
     retVal = sem_wait(&q->lock);
     // In case of error print error message and exit
     if(retVal != 0) PrintSemWaitErrorAndExit(QUEUE_MODULE, q->queueIdentity, "Dequeue-Lock");
 
-    // Dequeue a string from the queue.
-    char* string = q->queue[q->front];
-    q->front = (q->front + 1) % q->capacity;
-    UpdateDequeueCount(q->stats, 1);
+    // Dequeue a record from the queue.
+    Record record = q->queue[q->front];
+    q->front = (q->front + 1) % q->maxCapacity;
+    int occupancy = --q->size;
 
     // Update the semaphore to indicate that an empty slot is available due to dequeue
     retVal = sem_post(&q->empty);
     if(retVal != 0) PrintSemPostErrorAndExit(QUEUE_MODULE, q->queueIdentity, "Dequeue-Empty");
 
-    // end the clock and update the dequeue time
-    clock_t end = clock();
-    UpdateDequeueTime(q->stats, start, end);
-
     // Release the lock on this method.
     retVal = sem_post(&q->lock);
     if(retVal != 0) PrintSemPostErrorAndExit(QUEUE_MODULE, q->queueIdentity, "Dequeue-Lock");
+    // Wake a producer parked on the full queue, if there is one
+    SignalWaitPoint(&q->notFull, 1);
+
+    // end the clock and update the dequeue count and time. The stats do not need the queue lock.
+    unsigned long long end = GetMonotonicTime();
+    UpdateDequeueCount(q->stats, 1);
+    UpdateDequeueTime(q->stats, start, end);
+    recordOccupancy(q, occupancy);
 
-    // return the dequeued string
-    return string;
+    // return the dequeued record
+    return record;
+}
+
+/**
+ * @function EnqueueStrings
+ * @argument q - Queue struct
+ * @argument records - Array of records to be enqueued
+ * @argument count - Number of records in the array
+ * @description
+ * Enqueue all the given records in order. As many records as there are free slots are moved under a single
+ * acquisition of the queue and the stats are updated once per such batch. Waits while the queue is full.
+ * */
+void EnqueueStrings(Queue *q, Record *records, int count) {
+    TraceRecords(TRACE_ENQUEUE, q->queueIdentity, records, count);
+    int done = 0;
+    unsigned long long end = 0;
+    while(done < count) {
+        unsigned long long start = GetMonotonicTime();
+        int moved;
+        if(q->type == QUEUE_LOCKED) {
+            moved = enqueueLockedBatch(q, records + done, count - done);
+        } else {
+            moved = (int) ringTryPush(q, records + done, (size_t) (count - done));
+            if(moved == 0) {
+                RingAttempt attempt = {q, records + done, (size_t) (count - done), 0};
+                UpdateWaitPhase(q->stats, (int) AwaitCondition(&q->notFull, &q->waitPolicy, tryPushRing, &attempt));
+                moved = (int) attempt.moved;
+                recordBlockedOnFull(q, start, GetMonotonicTime());
+            }
+            SignalWaitPoint(&q->notEmpty, moved);
+            recordOccupancy(q, ringSize(q));
+        }
+        end = GetMonotonicTime();
+        UpdateEnqueueCount(q->stats, moved);
+        UpdateEnqueueTime(q->stats, start, end);
+        done = done + moved;
+    }
+    if(count > 0) adaptCapacity(q, end);
+}
+
+/**
+ * @function DequeueStrings
+ * @argument q - Queue struct
+ * @argument records - Array into which the dequeued records are stored
+ * @argument maxCount - Maximum number of records which can be stored in the array
+ * @description
+ * Dequeue all the records currently available (at most maxCount) under a single acquisition of the queue.
+ * Waits until at least one record is available. Returns the number of records dequeued.
+ * */
+int DequeueStrings(Queue *q, Record *records, int maxCount) {
+    if(maxCount <= 0) return 0;
+    unsigned long long start = GetMonotonicTime();
+    int count;
+    if(q->type == QUEUE_LOCKED) {
+        count = dequeueLockedBatch(q, records, maxCount);
+    } else {
+        count = (int) ringTryPop(q, records, (size_t) maxCount);
+        if(count == 0) {
+            RingAttempt attempt = {q, records, (size_t) maxCount, 0};
+            UpdateWaitPhase(q->stats, (int) AwaitCondition(&q->notEmpty, &q->waitPolicy, tryPopRing, &attempt));
+            count = (int) attempt.moved;
+            recordBlockedOnEmpty(q, start, GetMonotonicTime());
+        }
+        SignalWaitPoint(&q->notFull, count);
+        recordOccupancy(q, ringSize(q));
+    }
+    unsigned long long end = GetMonotonicTime();
+    UpdateDequeueCount(q->stats, count);
+    UpdateDequeueTime(q->stats, start, end);
+    TraceRecords(TRACE_DEQUEUE, q->queueIdentity, records, count);
+    return count;
+}
+
+/**
+ * @function enqueueLockedBatch
+ * @argument q - Queue struct
+ * @argument records - Array of records to be enqueued
+ * @argument count - Number of records in the array
+ * @description
+ * Enqueue as many records as there are empty slots (at least one) in the semaphore based queue.
+ * Returns the number of records enqueued.
+ * */
+static int enqueueLockedBatch(Queue *q, Record *records, int count) {
+    int retVal;
+    // Wait for one empty slot and then take any other slots which are free without waiting
+    int permits = acquirePermits(q, &q->empty, count, "EnqueueBatch-Empty");
+
+    retVal = sem_wait(&q->lock);
+    if(retVal != 0) PrintSemWaitErrorAndExit(QUEUE_MODULE, q->queueIdentity, "EnqueueBatch-Lock");
+    for(int index = 0; index < permits; index++) {
+        q->queue[q->end] = records[index];
+        q->end = (q->end + 1) % q->maxCapacity;
+    }
+    q->size = q->size + permits;
+    int occupancy = q->size;
+    retVal = sem_post(&q->lock);
+    if(retVal != 0) PrintSemPostErrorAndExit(QUEUE_MODULE, q->queueIdentity, "EnqueueBatch-Lock");
+    recordOccupancy(q, occupancy);
+
+    // Indicate that entries were added. The lock is not held here so consumers can start right away.
+    for(int index = 0; index < permits; index++) {
+        retVal = sem_post(&q->full);
+        if(retVal != 0) PrintSemPostErrorAndExit(QUEUE_MODULE, q->queueIdentity, "EnqueueBatch-Full");
+    }
+    SignalWaitPoint(&q->notEmpty, permits);
+    return permits;
+}
+
+/**
+ * @function dequeueLockedBatch
+ * @argument q - Queue struct
+ * @argument records - Array into which the dequeued records are stored
+ * @argument maxCount - Maximum number of records which can be stored in the array
+ * @description
+ * Dequeue all the available records (at least one, at most maxCount) from the semaphore based queue.
+ * Returns the number of records dequeued.
+ * */
+static int dequeueLockedBatch(Queue *q, Record *records, int maxCount) {
+    int retVal;
+    // Wait for one entry and then take any other entries which are available without waiting
+    int permits = acquirePermits(q, &q->full, maxCount, "DequeueBatch-Full");
+
+    retVal = sem_wait(&q->lock);
+    if(retVal != 0) PrintSemWaitErrorAndExit(QUEUE_MODULE, q->queueIdentity, "DequeueBatch-Lock");
+    for(int index = 0; index < permits; index++) {
+        records[index] = q->queue[q->front];
+        q->front = (q->front + 1) % q->maxCapacity;
+    }
+    q->size = q->size - permits;
+    int occupancy = q->size;
+    retVal = sem_post(&q->lock);
+    if(retVal != 0) PrintSemPostErrorAndExit(QUEUE_MODULE, q->queueIdentity, "DequeueBatch-Lock");
+    recordOccupancy(q, occupancy);
+
+    // Indicate that the slots are empty again
+    for(int index = 0; index < permits; index++) {
+        retVal = sem_post(&q->empty);
+        if(retVal != 0) PrintSemPostErrorAndExit(QUEUE_MODULE, q->queueIdentity, "DequeueBatch-Empty");
+    }
+    SignalWaitPoint(&q->notFull, permits);
+    return permits;
+}
+
+/**
+ * @function acquirePermits
+ * @argument q - Queue struct
+ * @argument sem - Semaphore from which the permits are taken
+ * @argument maxCount - Maximum number of permits to take
+ * @argument functionalIdentity - Name used in the error message
+ * @description
+ * Wait for one permit of the semaphore and then take up to maxCount - 1 more permits without blocking.
+ * Returns the number of permits taken.
+ * */
+static int acquirePermits(Queue *q, sem_t *sem, int maxCount, char* functionalIdentity) {
+    int retVal;
+    waitForPermit(q, sem, functionalIdentity);
+
+    int permits = 1;
+    while(permits < maxCount) {
+        retVal = sem_trywait(sem);
+        if(retVal != 0) {
+            // EAGAIN just means that no more permits are available right now
+            if(errno != EAGAIN) PrintSemWaitErrorAndExit(QUEUE_MODULE, q->queueIdentity, functionalIdentity);
+            break;
+        }
+        permits = permits + 1;
+    }
+    return permits;
+}
+
+/**
+ * @function waitForPermit
+ * @argument q - Queue struct
+ * @argument sem - Either the empty semaphore (producers) or the full semaphore (consumers) of the queue
+ * @argument functionalIdentity - Name used in the error message
+ * @description
+ * Take one permit of the semaphore. If none is available right away then wait for one using the wait policy of the
+ * queue (spin, yield and then park until the other side signals) instead of sleeping in sem_wait. The time spent
+ * waiting is recorded as blocked on full (for the empty semaphore) or blocked on empty (for the full semaphore), and
+ * the phase which resolved the wait is counted.
+ * */
+static void waitForPermit(Queue *q, sem_t *sem, char* functionalIdentity) {
+    if(sem_trywait(sem) == 0) return;
+    if(errno != EAGAIN) PrintSemWaitErrorAndExit(QUEUE_MODULE, q->queueIdentity, functionalIdentity);
+
+    unsigned long long start = GetMonotonicTime();
+    PermitAttempt attempt = {q, sem, functionalIdentity};
+    WaitPoint *point = sem == &q->empty ? &q->notFull : &q->notEmpty;
+    UpdateWaitPhase(q->stats, (int) AwaitCondition(point, &q->waitPolicy, tryTakePermit, &attempt));
+    if(sem == &q->empty) {
+        recordBlockedOnFull(q, start, GetMonotonicTime());
+    } else {
+        recordBlockedOnEmpty(q, start, GetMonotonicTime());
+    }
+}
+
+/**
+ * @function tryTakePermit
+ * @argument context - PermitAttempt struct
+ * @description Condition of a wait for a permit. Takes a permit if one is available and returns 1, otherwise 0.
+ * */
+static int tryTakePermit(void *context) {
+    PermitAttempt *attempt = context;
+    if(sem_trywait(attempt->sem) == 0) return 1;
+    if(errno != EAGAIN) PrintSemWaitErrorAndExit(QUEUE_MODULE, attempt->q->queueIdentity, attempt->functionalIdentity);
+    return 0;
+}
+
+/**
+ * @function tryPushRing
+ * @argument context - RingAttempt struct
+ * @description Condition of a wait for a free slot in the ring. Pushes as many records as fit and returns 1 if any did.
+ * */
+static int tryPushRing(void *context) {
+    RingAttempt *attempt = context;
+    attempt->moved = ringTryPush(attempt->q, attempt->records, attempt->count);
+    return attempt->moved > 0;
+}
+
+/**
+ * @function tryPopRing
+ * @argument context - RingAttempt struct
+ * @description Condition of a wait for an entry in the ring. Pops the available records and returns 1 if there were any.
+ * */
+static int tryPopRing(void *context) {
+    RingAttempt *attempt = context;
+    attempt->moved = ringTryPop(attempt->q, attempt->records, attempt->count);
+    return attempt->moved > 0;
+}
+
+/**
+ * @function ringTryPush
+ * @argument q - Queue struct with a lock-free backend
+ * @argument records - Array of records to be pushed
+ * @argument count - Number of records in the array
+ * @description Push as many records as fit in the ring of the queue without waiting and return how many were pushed
+ * */
+static size_t ringTryPush(Queue *q, Record *records, size_t count) {
+    if(q->type == QUEUE_MPMC) return MpmcRingTryPushBatch(q->mpmcRing, records, count);
+    return SpscRingTryPushBatch(q->ring, records, count);
+}
+
+/**
+ * @function ringTryPop
+ * @argument q - Queue struct with a lock-free backend
+ * @argument records - Array into which the popped records are stored
+ * @argument maxCount - Maximum number of records which can be stored in the array
+ * @description Pop the available records (at most maxCount) from the ring of the queue without waiting and return how many
+ * */
+static size_t ringTryPop(Queue *q, Record *records, size_t maxCount) {
+    if(q->type == QUEUE_MPMC) return MpmcRingTryPopBatch(q->mpmcRing, records, maxCount);
+    return SpscRingTryPopBatch(q->ring, records, maxCount);
+}
+
+/**
+ * @function ringSize
+ * @argument q - Queue struct with a lock-free backend
+ * @description Return a sample of the number of records in the ring of the queue
+ * */
+static int ringSize(Queue *q) {
+    if(q->type == QUEUE_MPMC) return (int) MpmcRingSize(q->mpmcRing);
+    return (int) SpscRingSize(q->ring);
+}
+
+/**
+ * @function recordBlockedOnFull
+ * @argument q - Queue struct
+ * @argument start - Time at which the producer started to wait
+ * @argument end - Time at which the producer got a free slot
+ * @description Add the wait to the stats and to the total which the capacity controller samples
+ * */
+static void recordBlockedOnFull(Queue *q, unsigned long long start, unsigned long long end) {
+    UpdateBlockedOnFull(q->stats, start, end);
+    atomic_fetch_add_explicit(&q->blockedOnFullTime, end - start, memory_order_relaxed);
+}
+
+/**
+ * @function recordBlockedOnEmpty
+ * @argument q - Queue struct
+ * @argument start - Time at which the consumer started to wait
+ * @argument end - Time at which the consumer got an entry
+ * @description Add the wait to the stats and to the total which the capacity controller samples
+ * */
+static void recordBlockedOnEmpty(Queue *q, unsigned long long start, unsigned long long end) {
+    UpdateBlockedOnEmpty(q->stats, start, end);
+    atomic_fetch_add_explicit(&q->blockedOnEmptyTime, end - start, memory_order_relaxed);
+}
+
+/**
+ * @function recordOccupancy
+ * @argument q - Queue struct
+ * @argument occupancy - Number of records in the queue after an operation
+ * @description Add the sample to the stats. An adaptive queue also keeps the largest sample of the current period.
+ * */
+static void recordOccupancy(Queue *q, int occupancy) {
+    UpdateOccupancy(q->stats, occupancy);
+    if(q->minCapacity == q->maxCapacity) return;
+    int peak = atomic_load_explicit(&q->peakOccupancy, memory_order_relaxed);
+    while(occupancy > peak &&
+          !atomic_compare_exchange_weak_explicit(&q->peakOccupancy, &peak, occupancy, memory_order_relaxed, memory_order_relaxed));
+}
+
+/**
+ * @function adaptCapacity
+ * @argument q - Queue struct
+ * @argument now - Current time returned by GetMonotonicTime
+ * @description
+ * Capacity controller of an adaptive queue. Called by the producers after an enqueue. Once per QUEUE_ADAPT_PERIOD_NS
+ * one of them looks at the blocked times and the peak occupancy of the period which just ended and doubles or halves
+ * the capacity, within minCapacity and maxCapacity. For the single-producer ring the producer is the only caller, which
+ * is what SpscRingSetCapacity requires. The multi-producer ring can be resized by any thread.
+ * */
+static void adaptCapacity(Queue *q, unsigned long long now) {
+    if(q->minCapacity == q->maxCapacity) return;
+    unsigned long long periodStart = atomic_load_explicit(&q->periodStart, memory_order_relaxed);
+    if(now < periodStart + QUEUE_ADAPT_PERIOD_NS) return;
+    // Another producer is already deciding for this period
+    if(atomic_flag_test_and_set_explicit(&q->adapting, memory_order_acquire)) return;
+    periodStart = atomic_load_explicit(&q->periodStart, memory_order_relaxed);
+    if(now < periodStart + QUEUE_ADAPT_PERIOD_NS) {
+        atomic_flag_clear_explicit(&q->adapting, memory_order_release);
+        return;
+    }
+
+    unsigned long long period = now - periodStart;
+    unsigned long long fullTotal = atomic_load_explicit(&q->blockedOnFullTime, memory_order_relaxed);
+    unsigned long long emptyTotal = atomic_load_explicit(&q->blockedOnEmptyTime, memory_order_relaxed);
+    unsigned long long blockedOnFull = fullTotal - q->periodBlockedOnFull;
+    unsigned long long blockedOnEmpty = emptyTotal - q->periodBlockedOnEmpty;
+    int peak = atomic_exchange_explicit(&q->peakOccupancy, 0, memory_order_relaxed);
+    int capacity = atomic_load_explicit(&q->capacity, memory_order_relaxed);
+
+    int target = capacity;
+    if(blockedOnFull * 100 >= period * QUEUE_GROW_BLOCKED_PERCENT &&
+       blockedOnEmpty * 100 >= period * QUEUE_GROW_BLOCKED_PERCENT) {
+        // Both sides waited on each other. A deeper queue absorbs the bursts.
+        target = capacity < q->maxCapacity / 2 ? capacity * 2 : q->maxCapacity;
+    } else if(blockedOnFull == 0 && peak * 4 <= capacity) {
+        // The queue sat mostly empty. Give back the slots so that fewer lines can be in flight.
+        target = capacity / 2 > q->minCapacity ? capacity / 2 : q->minCapacity;
+    }
+
+    if(target != capacity) {
+        if(q->type == QUEUE_LOCKED) {
+            target = resizeLocked(q, capacity, target);
+        } else if(q->type == QUEUE_MPMC) {
+            MpmcRingSetCapacity(q->mpmcRing, (size_t) target);
+        } else {
+            SpscRingSetCapacity(q->ring, (size_t) target);
+        }
+        if(target != capacity) {
+            atomic_store_explicit(&q->capacity, target, memory_order_relaxed);
+            UpdateCapacity(q->stats, target);
+        }
+    }
+
+    q->periodBlockedOnFull = fullTotal;
+    q->periodBlockedOnEmpty = emptyTotal;
+    atomic_store_explicit(&q->periodStart, now, memory_order_relaxed);
+    atomic_flag_clear_explicit(&q->adapting, memory_order_release);
+}
+
+/**
+ * @function resizeLocked
+ * @argument q - Queue struct
+ * @argument capacity - Current capacity of the queue
+ * @argument target - Capacity the controller asked for
+ * @description
+ * Change the capacity of the semaphore based queue by adding or taking away permits of the empty semaphore.
+ * Growing always succeeds. Shrinking only takes the permits which are free right now, so the queue may shrink less
+ * than asked when it is not empty. Returns the new capacity.
+ * */
+static int resizeLocked(Queue *q, int capacity, int target) {
+    int retVal;
+    if(target > capacity) {
+        for(int index = capacity; index < target; index++) {
+            retVal = sem_post(&q->empty);
+            if(retVal != 0) PrintSemPostErrorAndExit(QUEUE_MODULE, q->queueIdentity, "Resize-Empty");
+        }
+        SignalWaitPoint(&q->notFull, target - capacity);
+        return target;
+    }
+
+    int taken = 0;
+    while(taken < capacity - target) {
+        retVal = sem_trywait(&q->empty);
+        if(retVal != 0) {
+            if(errno != EAGAIN) PrintSemWaitErrorAndExit(QUEUE_MODULE, q->queueIdentity, "Resize-Empty");
+            break;
+        }
+        taken = taken + 1;
+    }
+    return capacity - taken;
+}
+
+/**
+ * @function SetQueueWaitPolicy
+ * @argument q - queue struct
+ * @argument spinLimit - Number of times a waiting thread tries again while spinning
+ * @argument yieldLimit - Number of times a waiting thread tries again after yielding the cpu, before it parks
+ * @description
+ * Set how the producers and consumers of this queue wait on a full or empty queue. Larger limits lower the latency
+ * of a short wait at the cost of cpu time. Both 0 parks right away. Should be called before the threads start.
+ * */
+void SetQueueWaitPolicy(Queue *q, int spinLimit, int yieldLimit) {
+    q->waitPolicy.spinLimit = spinLimit;
+    q->waitPolicy.yieldLimit = yieldLimit;
+}
+
+/**
+ * @function PlaceQueueOnNode
+ * @argument q - queue struct
+ * @argument node - NUMA node of the consumer of the queue. Nothing is done for a negative node.
+ * @description
+ * Bind the slots of the queue (and for the lock-free backends the ring with its head and tail) to the node, so that the
+ * consumer reads them from local memory. Should be called before the threads start. A refused binding is ignored.
+ * */
+void PlaceQueueOnNode(Queue *q, int node) {
+    if(q->type == QUEUE_SPSC) {
+        BindMemoryToNode(q->ring, sizeof(SpscRing), node);
+        BindMemoryToNode(q->ring->slots, sizeof(Record) * (q->ring->mask + 1), node);
+    } else if(q->type == QUEUE_MPMC) {
+        BindMemoryToNode(q->mpmcRing, sizeof(MpmcRing), node);
+        BindMemoryToNode(q->mpmcRing->slots, sizeof(MpmcSlot) * (q->mpmcRing->mask + 1), node);
+    } else {
+        BindMemoryToNode(q->queue, sizeof(Record) * (size_t) q->maxCapacity, node);
+    }
 }
 
 /**
@@ -4,15 +4,53 @@
  *
  * @description
  * This module implements the functionality of a synchronized queue.
+ * The queue carries Records (Record module) by value, so the length, sequence number and flags of a line travel with
+ * its pointer and the end of the input is a flagged record rather than a NULL string.
  * Each enqueue and dequeue operation is locked before any operation is performed.
  * We use semaphores available in semaphore.h for synchronization.
  * Actual queue is implemented as an array of input size.
- * The statistics of the queue are recorded using Statistics module
+ * The statistics of the queue are recorded using Statistics module. Besides the counts and times of each operation,
+ * the time spent blocked on a full or an empty queue and the occupancy after every operation are recorded.
+ * Blocked time is only measured when an operation actually has to wait, so the common path does not read the clock twice.
+ *
+ * A producer waiting on a full queue, or a consumer waiting on an empty queue, does not sleep in sem_wait. It follows
+ * the wait policy of the queue (WaitPoint module)- it spins, then yields and only then parks on a futex until the other
+ * side signals. Every operation which frees a slot or adds an entry signals, which costs a fence and a load unless a
+ * thread is parked. The stats count how many waits each phase resolved.
+ *
+ * A queue can alternatively be backed by a lock-free single-producer/single-consumer ring (SpscRing module).
+ * That backend does not take any semaphore and must only be used when exactly one thread enqueues and
+ * exactly one thread dequeues.
+ * With several producers or consumers, a queue can be backed by a lock-free multi-producer/multi-consumer ring
+ * (MpmcRing module) instead of the semaphores. Producers then only contend on a compare-and-swap of the tail and
+ * consumers on the head, once per batch, rather than all of them serializing on the lock semaphore.
+ * The backend is chosen per queue when it is created (CreateStringQueueOfType and CreateAdaptiveStringQueue).
+ *
+ * A queue can be shared between processes (CreateSharedStringQueue). The queue, its array or ring and its stats are
+ * then allocated in a shared memory segment (SharedSegment module), the semaphores are process-shared and the wait
+ * points use shared futexes. Every backend works that way, as none of them keeps state outside the queue. The records
+ * must point into the same segment, e.g. at pooled buffers allocated from it, so the consumer can read the lines.
+ *
+ * A queue can also be adaptive. Its capacity then changes at runtime between a min and a max. The array (or ring) is
+ * allocated with max slots up front, so resizing never moves an entry; only the number of slots producers may use
+ * changes. A small controller is run by the producers at most once per QUEUE_ADAPT_PERIOD_NS. It doubles the capacity
+ * when, during the last period, producers were blocked on a full queue and consumers were blocked on an empty queue,
+ * i.e. the stages run in bursts and a deeper queue would decouple them. It halves the capacity when producers were never
+ * blocked and the queue stayed below a quarter of its capacity, which bounds the number of lines (and pooled buffers)
+ * in flight again once the burst is over. When only one side is blocked the capacity is left alone, since a deeper
+ * queue does not help a stage which is simply slower.
  *
  * @functions
  * CreateStringQueue - Return an initialized Queue struct which can be used directly.
- * EnqueueString - Enqueue a string in the queue
- * DequeueString - Dequeue a string from the queue
+ * CreateStringQueueOfType - Same as CreateStringQueue but the backend of the queue can be chosen.
+ * CreateAdaptiveStringQueue - Same as CreateStringQueueOfType but the capacity adapts between a min and a max.
+ * CreateSharedStringQueue - Same as CreateAdaptiveStringQueue but the queue is placed in a segment shared by processes.
+ * EnqueueString - Enqueue the record of a line in the queue
+ * DequeueString - Dequeue the record of a line from the queue
+ * EnqueueStrings - Enqueue an array of records. Moves as many as fit under a single acquisition of the queue.
+ * DequeueStrings - Dequeue all available records (at least one) up to a maximum under a single acquisition.
+ * SetQueueWaitPolicy - Set how long waiting producers and consumers spin and yield before they park
+ * PlaceQueueOnNode - Keep the slots of the queue on the given NUMA node
  * PrintQueueStats - Print the stats of the queue
  *
  * */
@@ -22,22 +60,50 @@
 
 #include <semaphore.h>
 #include "statistics.h"
+#include "SpscRing.h"
+#include "MpmcRing.h"
+#include "WaitPoint.h"
+#include "Record.h"
+#include "SharedSegment.h"
 
 #define QUEUE_MODULE "Queue"
+// Minimum time between two decisions of the capacity controller of an adaptive queue (10 ms)
+#define QUEUE_ADAPT_PERIOD_NS 10000000ULL
+// Percentage of a period which both producers and consumers must spend blocked for an adaptive queue to grow
+#define QUEUE_GROW_BLOCKED_PERCENT 5
+
+// Backends available for a queue
+typedef enum {
+    // Array guarded by lock/full/empty semaphores. Any number of producers and consumers.
+    QUEUE_LOCKED,
+    // Lock-free ring. Exactly one producer thread and one consumer thread.
+    QUEUE_SPSC,
+    // Lock-free ring with sequence-numbered slots. Any number of producers and consumers.
+    QUEUE_MPMC
+} QueueType;
 
 // The struct of queue which stores all the variables used for implementing the queue functionality
 typedef struct {
     // Name of the queue
     char* queueIdentity;
+    // Backend used by this queue
+    QueueType type;
+    // Segment shared between processes in which the queue lives. NULL if the queue is private to the process.
+    SharedSegment* segment;
 
-    // Capacity is the size of the queue
-    int capacity;
+    // Capacity is the number of strings the queue may hold right now
+    atomic_int capacity;
+    // Bounds of the capacity. The array (or ring) has maxCapacity slots. Both are equal unless the queue is adaptive.
+    int minCapacity;
+    int maxCapacity;
     // front stores the front index at which an element is present
     int front;
     // end stores the end index at which an element would be inserted
     int end;
-    // Array of strings which store the actual data
-    char** queue;
+    // Number of strings in the queue. Updated under the lock and sampled for the occupancy histogram.
+    int size;
+    // Array of records which store the actual data
+    Record* queue;
 
     // Semaphore for locking the method before performing any operation
     sem_t lock;
@@ -46,13 +112,44 @@ typedef struct {
     // Semaphore to indicate that the queue is empty
     sem_t empty;
 
+    // Ring used when type is QUEUE_SPSC. The array and semaphores above are unused in that case.
+    SpscRing* ring;
+    // Ring used when type is QUEUE_MPMC. The array and semaphores above are unused in that case.
+    MpmcRing* mpmcRing;
+
     // A struct of stats module which stores the statistics of this queue
     Stats* stats;
+
+    // Capacity controller of an adaptive queue. Set while a producer runs the controller so that only one runs at once.
+    atomic_flag adapting;
+    // Start of the current period of the controller
+    atomic_ullong periodStart;
+    // Total time in nanoseconds producers were blocked on a full queue and consumers on an empty queue
+    atomic_ullong blockedOnFullTime;
+    atomic_ullong blockedOnEmptyTime;
+    // Values of the two totals above at the start of the current period
+    unsigned long long periodBlockedOnFull;
+    unsigned long long periodBlockedOnEmpty;
+    // Largest occupancy seen during the current period
+    atomic_int peakOccupancy;
+
+    // How producers and consumers wait on a full or empty queue
+    WaitPolicy waitPolicy;
+    // Signalled when a slot is freed (producers park here) and when an entry is added (consumers park here)
+    WaitPoint notFull;
+    WaitPoint notEmpty;
 } Queue;
 
 Queue *CreateStringQueue(int size, char* queueIdentity);
-void EnqueueString(Queue *q, char *string);
-char * DequeueString(Queue *q);
+Queue *CreateStringQueueOfType(int size, char* queueIdentity, QueueType type);
+Queue *CreateAdaptiveStringQueue(int size, int minSize, int maxSize, char* queueIdentity, QueueType type);
+Queue *CreateSharedStringQueue(int size, int minSize, int maxSize, char* queueIdentity, QueueType type, SharedSegment* segment);
+void EnqueueString(Queue *q, Record record);
+Record DequeueString(Queue *q);
+void EnqueueStrings(Queue *q, Record *records, int count);
+int DequeueStrings(Queue *q, Record *records, int maxCount);
+void SetQueueWaitPolicy(Queue *q, int spinLimit, int yieldLimit);
+void PlaceQueueOnNode(Queue *q, int node);
 void PrintQueueStats(Queue *q);
 
 #endif
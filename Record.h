@@ -0,0 +1,41 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * A Record describes one line as it moves through the pipeline. Records are passed by value through the queues, so
+ * a stage gets the position, length, sequence number and flags of a line without touching the memory of the line.
+ * The length is always known, hence no stage scans a line for its end and a line may contain '\0' characters.
+ *
+ * The characters of a line are either in a pooled buffer (BufferPool module) or, when stdin is mapped, in the mapping.
+ * In both cases they are followed by the '\n' of the line, unless the record is a segment of a long line which is
+ * continued by the next record. The Writer releases the pooled buffer, if any, once the line has been written.
+ *
+ * The end of the input is a record flagged with RECORD_END_OF_STREAM. It carries no line.
+ * */
+
+#ifndef ASSIGNMENT2_RECORD_H
+#define ASSIGNMENT2_RECORD_H
+
+// Segment of a long line which is continued by the next record. It is not followed by a newline.
+#define RECORD_CONTINUED 1u
+// No more records follow. Passed through the pipeline after the last line.
+#define RECORD_END_OF_STREAM 2u
+// Line sampled for tracing (Trace module). Its events are recorded at every queue and stage.
+#define RECORD_TRACED 4u
+
+// Kept at 32 bytes, so that two records share a cache line in the queues
+typedef struct {
+    // First character of the line. NULL only for the end of stream.
+    char* data;
+    // Number of characters in the line, without its newline. Lines are shorter than MAX_BUFFER_SIZE.
+    unsigned int length;
+    // RECORD_* values of the record. 0 for a complete line.
+    unsigned int flags;
+    // Position of the line in the input. Stamped by the Reader and used to restore the order in the Writer.
+    unsigned long sequence;
+    // Pooled buffer which holds the characters. NULL if they live outside the pool, e.g. in the mapped input.
+    char* buffer;
+} Record;
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#include <string.h>
+#include "ReorderBuffer.h"
+#include "Error.h"
+
+/**
+ * @function CreateReorderBuffer
+ * @argument window - Maximum number of lines in flight
+ * @argument segment - Shared memory segment in which the buffer is allocated. NULL allocates it from the heap.
+ * @description
+ * Initialize a ReorderBuffer struct with all slots empty and window credits and return it.
+ * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+ReorderBuffer* CreateReorderBuffer(unsigned long window, SharedSegment* segment){
+    ReorderBuffer* reorderBuffer = AllocateAligned(segment, sizeof(void*), sizeof(ReorderBuffer));
+    if(reorderBuffer == NULL) {
+        PrintMallocErrorAndExit(REORDER_BUFFER_MODULE, "Writer", "CreateReorderBuffer");
+        return NULL;
+    }
+
+    reorderBuffer->slots = AllocateAligned(segment, sizeof(void*), window * sizeof(Record));
+    if(reorderBuffer->slots == NULL) {
+        PrintMallocErrorAndExit(REORDER_BUFFER_MODULE, "Writer", "Slots");
+        return NULL;
+    }
+    // Every slot starts empty
+    memset(reorderBuffer->slots, 0, window * sizeof(Record));
+
+    reorderBuffer->window = window;
+    reorderBuffer->next = 0;
+    // The credits are shared with the Reader, which is another process if the buffer is in a segment
+    int retVal = sem_init(&reorderBuffer->credits, segment != NULL, (unsigned int) window);
+    if(retVal != 0) PrintSemInitErrorAndExit(REORDER_BUFFER_MODULE, "Writer", "Credits");
+    return reorderBuffer;
+}
+
+/**
+ * @function AcquireReorderCredit
+ * @argument reorderBuffer - ReorderBuffer struct
+ * @description
+ * Take a credit for a new line. Waits while window lines are already in flight.
+ * */
+void AcquireReorderCredit(ReorderBuffer* reorderBuffer){
+    int retVal = sem_wait(&reorderBuffer->credits);
+    if(retVal != 0) PrintSemWaitErrorAndExit(REORDER_BUFFER_MODULE, "Reader", "Credits");
+}
+
+/**
+ * @function InsertInReorderBuffer
+ * @argument reorderBuffer - ReorderBuffer struct
+ * @argument record - Record of a line which reached the Writer. Its sequence number was stamped by the Reader.
+ * @description
+ * Store the record in its slot. The credits guarantee that sequence < next + window, so the slot is free.
+ * */
+void InsertInReorderBuffer(ReorderBuffer* reorderBuffer, Record record){
+    reorderBuffer->slots[record.sequence % reorderBuffer->window] = record;
+}
+
+/**
+ * @function TakeNextInOrder
+ * @argument reorderBuffer - ReorderBuffer struct
+ * @argument record - Set to the record of the line if it has arrived
+ * @description
+ * If the line with the next sequence number has arrived then remove it from its slot, return its credit to the
+ * Reader, store it in record and return 1. Otherwise return 0.
+ * */
+int TakeNextInOrder(ReorderBuffer* reorderBuffer, Record* record){
+    unsigned long slot = reorderBuffer->next % reorderBuffer->window;
+    if(reorderBuffer->slots[slot].data == NULL) return 0;
+
+    *record = reorderBuffer->slots[slot];
+    reorderBuffer->slots[slot].data = NULL;
+    reorderBuffer->next = reorderBuffer->next + 1;
+    int retVal = sem_post(&reorderBuffer->credits);
+    if(retVal != 0) PrintSemPostErrorAndExit(REORDER_BUFFER_MODULE, "Writer", "Credits");
+    return 1;
+}
@@ -0,0 +1,49 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module restores the input order of lines when a munch stage runs as a pool of workers.
+ * The Reader stamps every line with a sequence number. Workers may finish lines out of order, so the Writer inserts
+ * each line in a window of slots indexed by sequence % window and only emits lines once all earlier lines are done.
+ *
+ * The window is bounded using credits. The Reader takes a credit before stamping a line and the Writer returns it once
+ * the line is emitted. Therefore a line is never more than window positions ahead of the next line to be emitted,
+ * its slot is always free, and at most window lines are in flight in the whole pipeline.
+ * When the Reader and the Writer are separate processes, the buffer is created in their shared segment and the credits
+ * are a process-shared semaphore.
+ *
+ * @functions
+ * CreateReorderBuffer - Return an initialized ReorderBuffer struct with the given window
+ * AcquireReorderCredit - Called by the Reader before a new line enters the pipeline. Waits while the window is full.
+ * InsertInReorderBuffer - Called by the Writer. Stores the record of a line in its slot.
+ * TakeNextInOrder - Called by the Writer. Takes the next line in input order if it is available.
+ * */
+
+#ifndef ASSIGNMENT2_REORDERBUFFER_H
+#define ASSIGNMENT2_REORDERBUFFER_H
+
+#include <semaphore.h>
+#include "Record.h"
+#include "SharedSegment.h"
+
+#define REORDER_BUFFER_MODULE "ReorderBuffer"
+
+typedef struct {
+    // Number of slots in the window
+    unsigned long window;
+    // Records of the lines which have arrived but cannot be emitted yet. Indexed by sequence % window.
+    // A slot is empty when its data is NULL, which is never the case for the record of a line.
+    Record* slots;
+    // Sequence number of the next line to be emitted. Only used by the Writer.
+    unsigned long next;
+    // Credits available to the Reader. Initialized to window.
+    sem_t credits;
+} ReorderBuffer;
+
+ReorderBuffer* CreateReorderBuffer(unsigned long window, SharedSegment* segment);
+void AcquireReorderCredit(ReorderBuffer* reorderBuffer);
+void InsertInReorderBuffer(ReorderBuffer* reorderBuffer, Record record);
+int TakeNextInOrder(ReorderBuffer* reorderBuffer, Record* record);
+
+#endif
@@ -0,0 +1,75 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "SharedSegment.h"
+#include "Error.h"
+
+/**
+ * @function CreateSharedSegment
+ * @argument size - Size of the segment in bytes
+ * @argument segmentIdentity - Name associated with the segment. Used for error messages.
+ * @description
+ * Create a POSIX shared memory object with a name unique to this process, size and map it and unlink the name again.
+ * The mapping is inherited by the processes forked afterwards.
+ * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+SharedSegment* CreateSharedSegment(size_t size, char* segmentIdentity){
+    SharedSegment* segment = malloc(sizeof(SharedSegment));
+    if(segment == NULL) {
+        PrintMallocErrorAndExit(SHARED_SEGMENT_MODULE, segmentIdentity, "CreateSharedSegment");
+        return NULL;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "/prodcom-%ld", (long) getpid());
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if(fd < 0) PrintSystemCallErrorAndExit(SHARED_SEGMENT_MODULE, segmentIdentity, "shm_open", errno);
+    // The mapping keeps the object alive. Unlinking now means a crash cannot leave it behind.
+    shm_unlink(name);
+    if(ftruncate(fd, (off_t) size) != 0) PrintSystemCallErrorAndExit(SHARED_SEGMENT_MODULE, segmentIdentity, "ftruncate", errno);
+
+    void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(base == MAP_FAILED) PrintSystemCallErrorAndExit(SHARED_SEGMENT_MODULE, segmentIdentity, "mmap", errno);
+    close(fd);
+
+    segment->segmentIdentity = segmentIdentity;
+    segment->base = base;
+    segment->size = size;
+    segment->header = base;
+    atomic_init(&segment->header->used, sizeof(SharedSegmentHeader));
+    return segment;
+}
+
+/**
+ * @function AllocateAligned
+ * @argument segment - Segment to allocate from. NULL allocates from the heap with posix_memalign.
+ * @argument alignment - Alignment of the memory. A power of two which is a multiple of sizeof(void*).
+ * @argument size - Number of bytes to allocate
+ * @description
+ * Return memory of the given size and alignment or NULL if there is not enough left. Memory of a segment is zero
+ * filled and can be allocated from any process which maps the segment. It is never freed.
+ * */
+void* AllocateAligned(SharedSegment* segment, size_t alignment, size_t size){
+    if(segment == NULL) {
+        void* memory = NULL;
+        if(posix_memalign(&memory, alignment, size) != 0) return NULL;
+        return memory;
+    }
+
+    size_t used = atomic_load_explicit(&segment->header->used, memory_order_relaxed);
+    size_t start;
+    do {
+        start = (used + alignment - 1) & ~(alignment - 1);
+        if(start + size > segment->size || start + size < start) return NULL;
+    } while(!atomic_compare_exchange_weak_explicit(&segment->header->used, &used, start + size,
+                                                   memory_order_relaxed, memory_order_relaxed));
+    return segment->base + start;
+}
@@ -0,0 +1,56 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module implements the shared memory segment used when the Reader, the stages and the Writer run as separate
+ * processes. The segment is created with shm_open, sized with ftruncate and mapped with MAP_SHARED. Its name is
+ * unlinked right after the mapping, so nothing is left in /dev/shm even if a process of the pipeline crashes.
+ *
+ * Everything two processes share is carved out of the segment by a bump allocator- the queues with their rings,
+ * semaphores and stats, the reorder window and the slabs of the line buffers. The offset of the next free byte lives
+ * in the segment itself and is advanced with an atomic add, so any process can allocate. Memory is never returned.
+ *
+ * The stage processes are forked after the segment is mapped, so it sits at the same address in all of them and the
+ * structures in it (and the records passed through the queues) keep plain pointers. A line is still handed from one
+ * process to the next without being copied.
+ *
+ * The file is sized up front but tmpfs only backs the pages which are touched, so a large segment costs nothing until
+ * it is used.
+ *
+ * @functions
+ * CreateSharedSegment - Create and map a segment of the given size
+ * AllocateAligned - Allocate aligned memory from a segment, or from the heap if the segment is NULL
+ * */
+
+#ifndef ASSIGNMENT2_SHAREDSEGMENT_H
+#define ASSIGNMENT2_SHAREDSEGMENT_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define SHARED_SEGMENT_MODULE "SharedSegment"
+// Default size of the segment in MB
+#define SHARED_SEGMENT_DEFAULT_MB 256
+
+// Start of the segment. The rest of the segment is handed out by AllocateAligned.
+typedef struct {
+    // Offset of the first byte which has not been allocated yet
+    atomic_size_t used;
+} SharedSegmentHeader;
+
+typedef struct {
+    // Name of the segment used for error messages
+    char* segmentIdentity;
+    // Start of the mapping. Same in every process of the pipeline.
+    char* base;
+    // Size of the mapping in bytes
+    size_t size;
+    // Header at the start of the mapping
+    SharedSegmentHeader* header;
+} SharedSegment;
+
+SharedSegment* CreateSharedSegment(size_t size, char* segmentIdentity);
+void* AllocateAligned(SharedSegment* segment, size_t alignment, size_t size);
+
+#endif
@@ -0,0 +1,124 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#include "SpscRing.h"
+#include "Error.h"
+
+/**
+ * @function CreateSpscRing
+ * @argument capacity - Number of entries the ring can hold
+ * @argument ringIdentity - Name associated with the ring. Used for error messages.
+ * @argument segment - Shared memory segment in which the ring is allocated. NULL allocates it from the heap.
+ * @description
+ * Allocate a cache line aligned ring. The slot array is rounded up to the next power of two.
+ * In case of an error, an appropriate message is printed on the stderr and then method exits using failure code.
+ * */
+SpscRing* CreateSpscRing(size_t capacity, char* ringIdentity, SharedSegment* segment){
+    // The struct needs cache line alignment so that head and tail do not share a line
+    SpscRing* ring = AllocateAligned(segment, CACHE_LINE_SIZE, sizeof(SpscRing));
+    if(ring == NULL) {
+        PrintMallocErrorAndExit(SPSC_RING_MODULE, ringIdentity, "Ring Structure");
+        return NULL;
+    }
+
+    // Round the physical size up to a power of two
+    size_t physicalSize = 1;
+    while(physicalSize < capacity) physicalSize = physicalSize << 1;
+
+    ring->slots = AllocateAligned(segment, CACHE_LINE_SIZE, sizeof(Record) * physicalSize);
+    if(ring->slots == NULL) {
+        PrintMallocErrorAndExit(SPSC_RING_MODULE, ringIdentity, "Ring Slots");
+        return NULL;
+    }
+
+    ring->capacity = capacity;
+    ring->mask = physicalSize - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->cachedHead = 0;
+    ring->cachedTail = 0;
+
+    return ring;
+}
+
+/**
+ * @function SpscRingTryPushBatch
+ * @argument ring - SpscRing struct
+ * @argument records - Array of records to be pushed
+ * @argument count - Number of records in the array
+ * @description
+ * Push as many records as there are free slots (at most count). Returns 0 without waiting if the ring is full.
+ * Must only be called from the single producer thread. The cached head is only refreshed when the ring looks full.
+ * */
+size_t SpscRingTryPushBatch(SpscRing* ring, Record* records, size_t count){
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if(tail - ring->cachedHead >= ring->capacity){
+        ring->cachedHead = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if(tail - ring->cachedHead >= ring->capacity) return 0;
+    }
+
+    // Copy as many entries as the free space allows and publish them with a single release store
+    size_t available = ring->capacity - (tail - ring->cachedHead);
+    if(count > available) count = available;
+    for(size_t index = 0; index < count; index++){
+        ring->slots[(tail + index) & ring->mask] = records[index];
+    }
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    return count;
+}
+
+/**
+ * @function SpscRingTryPopBatch
+ * @argument ring - SpscRing struct
+ * @argument records - Array into which the popped records are stored
+ * @argument maxCount - Maximum number of records which can be stored in the array
+ * @description
+ * Pop all the available records (at most maxCount). Returns 0 without waiting if the ring is empty.
+ * Must only be called from the single consumer thread. The cached tail is only refreshed when the ring looks empty.
+ * */
+size_t SpscRingTryPopBatch(SpscRing* ring, Record* records, size_t maxCount){
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if(head == ring->cachedTail){
+        ring->cachedTail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if(head == ring->cachedTail) return 0;
+    }
+
+    // Copy the available entries and release their slots with a single release store
+    size_t count = ring->cachedTail - head;
+    if(count > maxCount) count = maxCount;
+    for(size_t index = 0; index < count; index++){
+        records[index] = ring->slots[(head + index) & ring->mask];
+    }
+    atomic_store_explicit(&ring->head, head + count, memory_order_release);
+    return count;
+}
+
+/**
+ * @function SpscRingSize
+ * @argument ring - SpscRing struct
+ * @description
+ * Return the number of entries in the ring. Can be called from either side. As the other side keeps running, the
+ * value is only a sample.
+ * */
+size_t SpscRingSize(SpscRing* ring){
+    // Read head first so that the tail read afterwards is never behind it
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return tail - head;
+}
+
+/**
+ * @function SpscRingSetCapacity
+ * @argument ring - Ring struct
+ * @argument capacity - New number of entries the ring may hold. Clamped to the physical size of the ring.
+ * @description
+ * Change the capacity of the ring. Must only be called by the producer thread, which is the only reader of capacity.
+ * If the ring holds more entries than the new capacity then nothing is pushed until the consumer drains it below.
+ * */
+void SpscRingSetCapacity(SpscRing* ring, size_t capacity){
+    if(capacity > ring->mask + 1) capacity = ring->mask + 1;
+    if(capacity == 0) capacity = 1;
+    ring->capacity = capacity;
+}
@@ -0,0 +1,60 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module implements a lock-free single-producer/single-consumer ring which is used as a backend by the Queue module.
+ * The producer only writes the tail index and the consumer only writes the head index. Both are published using
+ * release stores and read using acquire loads, so no semaphore or lock is taken on the common path.
+ * Head and tail live on separate cache lines. Each side also keeps a cached copy of the opposite index on its own
+ * cache line so that it only touches the other side's line when the cached value says the ring is full/empty.
+ * The physical ring is rounded up to a power of two so that the index can be masked instead of using modulo.
+ * The ring never waits. A full or empty ring returns 0 and the Queue module waits on its WaitPoint instead.
+ *
+ * @functions
+ * CreateSpscRing - Return an initialized ring which can hold 'capacity' entries
+ * SpscRingTryPushBatch - Push as many entries from an array as fit in the ring. Returns 0 when the ring is full.
+ * SpscRingTryPopBatch - Pop up to a given number of entries. Returns 0 when the ring is empty.
+ * SpscRingSize - Number of entries in the ring. Approximate while the other side is running.
+ * SpscRingSetCapacity - Change the number of entries the ring may hold, up to its physical size. Producer only.
+ * */
+
+#ifndef ASSIGNMENT2_SPSCRING_H
+#define ASSIGNMENT2_SPSCRING_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include "Record.h"
+#include "SharedSegment.h"
+
+#define SPSC_RING_MODULE "SpscRing"
+// Size of a cache line on the targets we care about
+#define CACHE_LINE_SIZE 64
+
+// The struct of the ring. Fields are grouped by the thread which writes them.
+typedef struct {
+    // Producer side. tail is the index at which the next entry would be inserted.
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t tail;
+    // Producer's cached copy of head. Only refreshed when the ring looks full.
+    size_t cachedHead;
+
+    // Consumer side. head is the index at which the next entry would be removed.
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t head;
+    // Consumer's cached copy of tail. Only refreshed when the ring looks empty.
+    size_t cachedTail;
+
+    // Number of entries the ring may hold. Only read and changed by the producer.
+    _Alignas(CACHE_LINE_SIZE) size_t capacity;
+    // mask is the physical size - 1. Physical size is a power of two >= capacity.
+    size_t mask;
+    // Array of entries which store the records by value
+    Record* slots;
+} SpscRing;
+
+SpscRing* CreateSpscRing(size_t capacity, char* ringIdentity, SharedSegment* segment);
+size_t SpscRingTryPushBatch(SpscRing* ring, Record* records, size_t count);
+size_t SpscRingTryPopBatch(SpscRing* ring, Record* records, size_t maxCount);
+size_t SpscRingSize(SpscRing* ring);
+void SpscRingSetCapacity(SpscRing* ring, size_t capacity);
+
+#endif
@@ -0,0 +1,209 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include "Stage.h"
+#include "Transform.h"
+#include "Error.h"
+
+// Maximum length of a single entry of a spec
+#define MAX_STAGE_ENTRY 1024
+
+// Built-in transforms. They have the same signature as TransformRecords of a plugin.
+static void munch1Records(StageRecord* records, size_t count);
+static void munch2Records(StageRecord* records, size_t count);
+static void fusedRecords(StageRecord* records, size_t count);
+
+// Static utility functions
+static void findEntry(const char* spec, int index, char* entry);
+static int parseWorkers(char* entry, int defaultWorkers);
+static void loadPlugin(Stage* stage, char* path);
+static char* pluginName(const char* path);
+
+// A stage compiled into prodcom
+typedef struct {
+    // Name used in the spec
+    const char* specName;
+    // Name of the stage. Matches the names used for the queues before stages could be chosen.
+    char* name;
+    StageTransform transform;
+} BuiltinStage;
+
+static const BuiltinStage builtinStages[] = {
+    {"munch1", "Munch1", munch1Records},
+    {"munch2", "Munch2", munch2Records},
+    {"fused", "FusedMunch", fusedRecords}
+};
+
+/**
+ * @function CountStages
+ * @argument spec - Comma separated stages. Example- 'munch1,munch2'
+ * @description Return the number of stages in the spec. An empty spec has none- the Reader feeds the Writer directly.
+ * */
+int CountStages(const char* spec){
+    if(*spec == '\0') return 0;
+    int count = 1;
+    for(const char* character = spec; *character != '\0'; character++){
+        if(*character == STAGE_SEPARATOR) count++;
+    }
+    return count;
+}
+
+/**
+ * @function LoadStage
+ * @argument spec - Comma separated stages. Example- 'munch1,munch2'
+ * @argument index - Position of the stage in the spec, counting from 0
+ * @argument defaultWorkers - Number of workers if the entry does not give one
+ * @description
+ * Return the stage at the given position of the spec. A built-in name is resolved to its transform, anything which
+ * looks like a path is loaded as a plugin. In case of an unknown stage, a plugin which cannot be loaded or an invalid
+ * number of workers, an appropriate message is printed on stderr and the program exits with failure code.
+ * */
+Stage* LoadStage(const char* spec, int index, int defaultWorkers){
+    char entry[MAX_STAGE_ENTRY];
+    findEntry(spec, index, entry);
+
+    Stage* stage = malloc(sizeof(Stage));
+    if(stage == NULL) {
+        PrintMallocErrorAndExit(STAGE_MODULE, entry, "LoadStage");
+        return NULL;
+    }
+    stage->workers = parseWorkers(entry, defaultWorkers);
+    stage->handle = NULL;
+
+    for(size_t builtin = 0; builtin < sizeof(builtinStages) / sizeof(builtinStages[0]); builtin++){
+        if(strcmp(entry, builtinStages[builtin].specName) == 0){
+            stage->name = builtinStages[builtin].name;
+            stage->transform = builtinStages[builtin].transform;
+            return stage;
+        }
+    }
+
+    size_t length = strlen(entry);
+    if(strchr(entry, '/') == NULL && (length < 3 || strcmp(entry + length - 3, ".so") != 0)){
+        PrintStageErrorAndExit(STAGE_MODULE, entry, "not a built-in stage (munch1, munch2, fused) or a path to a plugin");
+    }
+    loadPlugin(stage, entry);
+    return stage;
+}
+
+/**
+ * @function findEntry
+ * @argument spec - Comma separated stages
+ * @argument index - Position of the entry, counting from 0
+ * @argument entry - Array of MAX_STAGE_ENTRY characters in which the entry is stored
+ * @description Copy the entry at the given position of the spec. Exits with failure code if it is empty or too long.
+ * */
+static void findEntry(const char* spec, int index, char* entry){
+    const char* start = spec;
+    for(int skipped = 0; skipped < index && start != NULL; skipped++){
+        start = strchr(start, STAGE_SEPARATOR);
+        if(start != NULL) start++;
+    }
+    if(start == NULL) PrintStageErrorAndExit(STAGE_MODULE, (char*) spec, "has fewer stages than expected");
+
+    const char* end = strchr(start, STAGE_SEPARATOR);
+    size_t length = end != NULL ? (size_t) (end - start) : strlen(start);
+    if(length == 0 || length >= MAX_STAGE_ENTRY) PrintStageErrorAndExit(STAGE_MODULE, (char*) spec, "has an empty or too long stage");
+    memcpy(entry, start, length);
+    entry[length] = '\0';
+}
+
+/**
+ * @function parseWorkers
+ * @argument entry - Entry of a spec. The ':N' suffix, if any, is removed.
+ * @argument defaultWorkers - Value returned if the entry has no suffix
+ * @description Return the number of workers given by the entry. Exits with failure code if it is not a positive number.
+ * */
+static int parseWorkers(char* entry, int defaultWorkers){
+    char* separator = strrchr(entry, STAGE_WORKERS_SEPARATOR);
+    if(separator == NULL) return defaultWorkers;
+
+    char* end;
+    long workers = strtol(separator + 1, &end, 10);
+    if(separator[1] == '\0' || *end != '\0' || workers <= 0 || workers > 1024){
+        PrintStageErrorAndExit(STAGE_MODULE, entry, "has an invalid number of workers");
+    }
+    *separator = '\0';
+    return (int) workers;
+}
+
+/**
+ * @function loadPlugin
+ * @argument stage - Stage struct which is filled in
+ * @argument path - Path of the shared object
+ * @description
+ * Open the plugin with dlopen, check its ABI version and look up its transform.
+ * A path without a '/' is searched for by dlopen in the usual library directories.
+ * */
+static void loadPlugin(Stage* stage, char* path){
+    stage->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if(stage->handle == NULL) PrintStageErrorAndExit(STAGE_MODULE, path, dlerror());
+
+    const int* version = dlsym(stage->handle, STAGE_PLUGIN_VERSION_SYMBOL);
+    if(version == NULL) PrintStageErrorAndExit(STAGE_MODULE, path, "does not export " STAGE_PLUGIN_VERSION_SYMBOL);
+    if(*version != STAGE_PLUGIN_ABI_VERSION) PrintStageErrorAndExit(STAGE_MODULE, path, "was built for another plugin ABI version");
+
+    // dlsym returns an object pointer. Converting it through a union keeps -pedantic quiet about function pointers.
+    union {
+        void* symbol;
+        StageTransform transform;
+    } function;
+    function.symbol = dlsym(stage->handle, STAGE_PLUGIN_TRANSFORM_SYMBOL);
+    if(function.symbol == NULL) PrintStageErrorAndExit(STAGE_MODULE, path, "does not export " STAGE_PLUGIN_TRANSFORM_SYMBOL);
+    stage->transform = function.transform;
+    stage->name = pluginName(path);
+}
+
+/**
+ * @function pluginName
+ * @argument path - Path of the shared object
+ * @description Return the file name of the plugin without its directory and '.so'. Example- 'rot13' for './rot13.so'
+ * */
+static char* pluginName(const char* path){
+    const char* start = strrchr(path, '/');
+    start = start != NULL ? start + 1 : path;
+    char* name = strdup(start);
+    if(name == NULL) {
+        PrintMallocErrorAndExit(STAGE_MODULE, (char*) path, "pluginName");
+        return NULL;
+    }
+    size_t length = strlen(name);
+    if(length > 3 && strcmp(name + length - 3, ".so") == 0) name[length - 3] = '\0';
+    return name;
+}
+
+/**
+ * @function munch1Records
+ * @argument records - Batch of lines
+ * @argument count - Number of lines in the batch
+ * @description Built-in munch1 stage. Convert space to * in every line.
+ * */
+static void munch1Records(StageRecord* records, size_t count){
+    for(size_t index = 0; index < count; index++) ReplaceSpaceWithAsterisk(records[index].data, records[index].length);
+}
+
+/**
+ * @function munch2Records
+ * @argument records - Batch of lines
+ * @argument count - Number of lines in the batch
+ * @description Built-in munch2 stage. Convert lower case to upper case in every line.
+ * */
+static void munch2Records(StageRecord* records, size_t count){
+    for(size_t index = 0; index < count; index++) ConvertLowerToUpperCase(records[index].data, records[index].length);
+}
+
+/**
+ * @function fusedRecords
+ * @argument records - Batch of lines
+ * @argument count - Number of lines in the batch
+ * @description Built-in fused stage. Apply both munch transforms to every line in one pass.
+ * */
+static void fusedRecords(StageRecord* records, size_t count){
+    for(size_t index = 0; index < count; index++) ApplyFusedTransform(records[index].data, records[index].length);
+}
@@ -0,0 +1,44 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module resolves the transform stages of the pipeline. The stages between the Reader and the Writer are given
+ * as a comma separated spec, Example- 'munch1,munch2' or 'fused:4,./rot13.so'. Each entry is a stage name optionally
+ * followed by ':' and its number of worker threads.
+ *
+ * The munch transforms are built in and use the same batch interface as a plugin (StagePlugin.h)-
+ * munch1 (space to '*'), munch2 (lower to upper case) and fused (both in one pass).
+ * Any other name which contains a '/' or ends in '.so' is loaded with dlopen. Its TransformRecords function is used
+ * after checking that it was built for the same StagePluginAbiVersion.
+ *
+ * @functions
+ * CountStages - Number of stages in a spec
+ * LoadStage - Resolve the n-th stage of a spec to a built-in stage or a plugin
+ * */
+
+#ifndef ASSIGNMENT2_STAGE_H
+#define ASSIGNMENT2_STAGE_H
+
+#include "StagePlugin.h"
+
+#define STAGE_MODULE "Stage"
+// Separator of the stages in a spec and of a stage and its number of workers
+#define STAGE_SEPARATOR ','
+#define STAGE_WORKERS_SEPARATOR ':'
+
+typedef struct {
+    // Name of the stage. Used for the names of the queues and in messages. Example- 'Munch1' or 'rot13'
+    char* name;
+    // Function applied to every batch of lines
+    StageTransform transform;
+    // Handle returned by dlopen. NULL for a built-in stage.
+    void* handle;
+    // Number of worker threads running the stage
+    int workers;
+} Stage;
+
+int CountStages(const char* spec);
+Stage* LoadStage(const char* spec, int index, int defaultWorkers);
+
+#endif
@@ -0,0 +1,47 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * Interface between prodcom and a stage plugin. This is the only header a plugin needs.
+ *
+ * A plugin is a shared object which transforms lines in place. It must export-
+ *   const int StagePluginAbiVersion = STAGE_PLUGIN_ABI_VERSION;
+ *   void TransformRecords(StageRecord* records, size_t count);
+ * TransformRecords is called by the worker threads of the stage with a batch of up to 64 lines at a time, so it can
+ * vectorize across lines as well as within a line. It may be called from several threads at once (with different
+ * batches) when the stage runs with more than one worker, so it must not keep unsynchronized state.
+ *
+ * The characters of a record may be changed but its length may not, and nothing outside
+ * [data, data + length) may be written. The characters are not '\0' terminated.
+ * With --long-lines stream, a line which does not fit in a buffer arrives as several records (segments) which may be
+ * in different batches, so a transform which needs the whole line should not be used in that mode.
+ *
+ * Example- build a plugin and run it after the built-in munch stages
+ *   gcc -O2 -shared -fPIC -o rot13.so Rot13.c
+ *   prodcom --stages munch1,munch2,./rot13.so < input
+ * */
+
+#ifndef ASSIGNMENT2_STAGEPLUGIN_H
+#define ASSIGNMENT2_STAGEPLUGIN_H
+
+#include <stddef.h>
+
+// Version of this interface. Plugins built against another version are refused.
+#define STAGE_PLUGIN_ABI_VERSION 1
+// Names of the symbols looked up in a plugin
+#define STAGE_PLUGIN_VERSION_SYMBOL "StagePluginAbiVersion"
+#define STAGE_PLUGIN_TRANSFORM_SYMBOL "TransformRecords"
+
+// A line handed to a plugin
+typedef struct {
+    // First character of the line
+    char* data;
+    // Number of characters in the line
+    size_t length;
+} StageRecord;
+
+// Signature of TransformRecords
+typedef void (*StageTransform)(StageRecord* records, size_t count);
+
+#endif
@@ -6,303 +6,467 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 #include <pthread.h>
+#include <unistd.h>
 #include "Threads.h"
+#include "Trace.h"
 #include "Error.h"
 
 // Static utility functions
-static void readLine(char* buffer, int* response);
 static void copyLine(char* buffer, char* str, int len);
-static void copyLineToQueue(Reader* reader, char* buffer, int len);
-static void signalEndOfExecutionByReader(Reader* reader, char* buffer, int freeBuffer);
-static void replaceSpaceWithAsterisk(char* str);
-static void convertLowerToUpperCase(char* str);
+static void copyLineToQueue(Reader* reader, char* buffer, int len, unsigned flags);
+static void enqueueLine(Reader* reader, char* data, int len, unsigned flags, char* pooledBuffer);
+static void signalEndOfExecutionByReader(Reader* reader);
+static void signalEndOfExecutionByWorker(WorkerGroup* group, Queue* inputQueue, Queue* outputQueue);
+static void writeString(Writer* writer, Record record);
+static void sendInOrder(Sender* sender, Record* batch, int* count, Record record);
+
+// Record passed through the pipeline after the last line
+static const Record endOfStream = {NULL, 0, RECORD_END_OF_STREAM, 0, NULL};
+
+/**
+ * @function CreateWorkerGroup
+ * @argument workers - Number of worker threads which run the same stage
+ * @argument processed - Counter of the records transformed by the stage. NULL if no metrics are exported.
+ * @description
+ * Initialize a WorkerGroup struct which tracks how many workers of a stage are still running and return it
+ * */
+WorkerGroup* CreateWorkerGroup(int workers, MetricsCounter* processed){
+    WorkerGroup* group = malloc(sizeof(WorkerGroup));
+    if(group == NULL) {
+        PrintMallocErrorAndExit(THREADS_MODULE, "WorkerGroup", "CreateWorkerGroup");
+        return NULL;
+    }
+    group->workers = workers;
+    atomic_init(&group->activeWorkers, workers);
+    group->processed = processed;
+    return group;
+}
 
 /**
  * @function CreateReader
- * @argument outputQueue - Shared queue between Reader-Munch1
+ * @argument outputQueue - Shared queue between the Reader and the first stage
+ * @argument reorderBuffer - Window used to restore the input order. NULL if the lines cannot be reordered.
+ * @argument mapInput - If set and stdin is a regular file then it is mapped and lines are passed on without copying
+ * @argument ioUring - If set then stdin is read with io_uring instead, if the kernel supports it
+ * @argument streamLongLines - If set then lines of MAX_BUFFER_SIZE or more characters are passed on in segments
+ * instead of being skipped
+ * @argument segment - Shared memory segment of the pipeline when the stages are separate processes, NULL otherwise.
+ * The line buffers are allocated in it so that the other processes can read them. stdin is then never mapped.
  * @description
  * Initialize a Reader struct and return it
  * */
-Reader* CreateReader(Queue* outputQueue){
+Reader* CreateReader(Queue* outputQueue, ReorderBuffer* reorderBuffer, int mapInput, int ioUring, int streamLongLines,
+                     SharedSegment* segment){
     Reader* reader = malloc(sizeof(Reader));
     if(reader == NULL) {
         PrintMallocErrorAndExit(THREADS_MODULE, READER, "CreateReader");
         return NULL;
     }
     reader->outputQueue = outputQueue;
-    return reader;
-}
-
-/**
- * @function CreateMunch1
- * @argument inputQueue - Shared queue between Reader-Munch1
- * @argument outputQueue - Shared queue between Munch1-Munch2
- * @description
- * Initialize a Munch1 struct and return it
- * */
-Munch1* CreateMunch1(Queue* inputQueue, Queue* outputQueue){
-    Munch1* munch1 = malloc(sizeof(Munch1));
-    if(munch1 == NULL) {
-        PrintMallocErrorAndExit(THREADS_MODULE, MUNCH1, "CreateMunch1");
+    reader->reorderBuffer = reorderBuffer;
+    reader->nextSequence = 0;
+    // Lines are split out of large blocks read from stdin (with io_uring if asked for) or out of the mapping of stdin
+    reader->lineReader = ioUring ? CreateAsyncLineReader(STDIN_FILENO, MAX_BUFFER_SIZE) : NULL;
+    // A private mapping of stdin is not shared with the other processes, which could not see the transformed lines
+    if(segment != NULL) mapInput = 0;
+    if(reader->lineReader == NULL) reader->lineReader = CreateLineReader(STDIN_FILENO, MAX_BUFFER_SIZE, mapInput);
+    SetLongLineSegments(reader->lineReader, streamLongLines);
+    // Lines are copied into recycled buffers of this pool. The Writer returns them once printed.
+    reader->bufferPool = CreateBufferPool(READER, segment);
+    // Scratch buffer into which each line is read. It is reused for every line.
+    reader->buffer = malloc(sizeof(char) * MAX_BUFFER_SIZE);
+    if(reader->buffer == NULL) {
+        PrintMallocErrorAndExit(THREADS_MODULE, READER, "Buffer");
         return NULL;
     }
-    munch1->inputQueue = inputQueue;
-    munch1->outputQueue = outputQueue;
-    return munch1;
+    return reader;
 }
 
 /**
- * @function CreateMunch2
- * @argument inputQueue - Shared queue between Munch1-Munch2
- * @argument outputQueue - Shared queue between Munch2-Writer
+ * @function CreateStageWorker
+ * @argument inputQueue - Shared queue with the previous stage or the Reader
+ * @argument outputQueue - Shared queue with the next stage or the Writer
+ * @argument group - Workers running the stage
+ * @argument stage - Stage run by the worker
  * @description
- * Initialize a Munch2 struct and return it
+ * Initialize a StageWorker struct and return it
  * */
-Munch2* CreateMunch2(Queue* inputQueue, Queue* outputQueue){
-    Munch2* munch2 = malloc(sizeof(Munch2));
-    if(munch2 == NULL) {
-        PrintMallocErrorAndExit(THREADS_MODULE, MUNCH2, "CreateMunch2");
+StageWorker* CreateStageWorker(Queue* inputQueue, Queue* outputQueue, WorkerGroup* group, Stage* stage){
+    StageWorker* worker = malloc(sizeof(StageWorker));
+    if(worker == NULL) {
+        PrintMallocErrorAndExit(THREADS_MODULE, stage->name, "CreateStageWorker");
         return NULL;
     }
-    munch2->inputQueue = inputQueue;
-    munch2->outputQueue = outputQueue;
-    return munch2;
+    worker->inputQueue = inputQueue;
+    worker->outputQueue = outputQueue;
+    worker->group = group;
+    worker->stage = stage;
+    return worker;
 }
 
 /**
  * @function CreateWriter
- * @argument inputQueue - Shared queue between Munch2-Writer
+ * @argument inputQueue - Shared queue between the last stage and the Writer
+ * @argument reorderBuffer - Window used to restore the input order. NULL if the lines already arrive in order.
+ * @argument ioUring - If set then stdout is written with io_uring, if the kernel supports it
+ * @argument processed - Counter to which the number of strings processed is published. NULL if no metrics are exported.
  * @description
  * Initialize a Writer struct and return it
  * */
-Writer* CreateWriter(Queue* inputQueue){
+Writer* CreateWriter(Queue* inputQueue, ReorderBuffer* reorderBuffer, int ioUring, MetricsCounter* processed){
     Writer* writer = malloc(sizeof(Writer));
     if(writer == NULL) {
         PrintMallocErrorAndExit(THREADS_MODULE, WRITER, "CreateWriter");
         return NULL;
     }
     writer->inputQueue = inputQueue;
+    writer->reorderBuffer = reorderBuffer;
+    // Lines are gathered and written to stdout using writev, or submitted to io_uring if asked for
+    writer->output = ioUring ? CreateAsyncOutputBatch(STDOUT_FILENO) : NULL;
+    if(writer->output == NULL) writer->output = CreateOutputBatch(STDOUT_FILENO);
+    // On a terminal every dequeued batch is written right away so that interactive use is not delayed
+    writer->flushEachBatch = isatty(STDOUT_FILENO);
     writer->stringsProcessedCount = 0;
+    writer->processed = processed;
     return writer;
 }
 
+/**
+ * @function CreateReceiver
+ * @argument outputQueue - Shared queue between the Receiver and the first stage
+ * @argument reorderBuffer - Window used to restore the input order. NULL if the lines cannot be reordered.
+ * @argument address - Address on which the Sender of the other process is awaited. See NetQueue module.
+ * @argument capacity - Number of lines the Sender may send ahead of the first stage
+ * @argument segment - Shared memory segment of the pipeline when the stages are separate processes, NULL otherwise.
+ * The line buffers are allocated in it so that the other processes can read them.
+ * @description
+ * Initialize a Receiver struct, wait for the Sender to connect and return it
+ * */
+Receiver* CreateReceiver(Queue* outputQueue, ReorderBuffer* reorderBuffer, char* address, int capacity,
+                         SharedSegment* segment){
+    Receiver* receiver = malloc(sizeof(Receiver));
+    if(receiver == NULL) {
+        PrintMallocErrorAndExit(THREADS_MODULE, RECEIVER, "CreateReceiver");
+        return NULL;
+    }
+    receiver->outputQueue = outputQueue;
+    receiver->reorderBuffer = reorderBuffer;
+    receiver->nextSequence = 0;
+    // Received lines are copied into recycled buffers of this pool. The Writer returns them once printed.
+    receiver->input = ListenNetQueue(address, capacity, CreateBufferPool(RECEIVER, segment), RECEIVER);
+    return receiver;
+}
+
+/**
+ * @function CreateSender
+ * @argument inputQueue - Shared queue between the last stage and the Sender
+ * @argument reorderBuffer - Window used to restore the input order. NULL if the lines already arrive in order.
+ * @argument address - Address of the Receiver of the other process. See NetQueue module.
+ * @argument processed - Counter of the records sent. NULL if no metrics are exported.
+ * @description
+ * Initialize a Sender struct, connect to the Receiver and return it
+ * */
+Sender* CreateSender(Queue* inputQueue, ReorderBuffer* reorderBuffer, char* address, MetricsCounter* processed){
+    Sender* sender = malloc(sizeof(Sender));
+    if(sender == NULL) {
+        PrintMallocErrorAndExit(THREADS_MODULE, SENDER, "CreateSender");
+        return NULL;
+    }
+    sender->inputQueue = inputQueue;
+    sender->reorderBuffer = reorderBuffer;
+    sender->output = ConnectNetQueue(address, SENDER);
+    sender->processed = processed;
+    return sender;
+}
+
 /**
  * @function StartReader
  * @argument ptr - Reader struct passed via create_thread
  * @description
  * Starts the reader operation in a separate thread.
- * Reads from stdin and fills its buffer. If the line length exceeds max length then buffer is flushed.
+ * Reads from stdin using the LineReader module and fills its buffer. If the line length exceeds max length then the line is skipped.
+ * When stdin is mapped, every complete line is passed on as a record which points into the mapping and is never copied.
+ * If long lines are streamed, each segment of such a line is passed on as a record flagged with RECORD_CONTINUED,
+ * except the last one. The stages and the Writer then handle it like any other line.
  * */
 void* StartReader(void* ptr){
     Reader* reader = (Reader*) ptr;
+    // Response of reading a line. First index is the status and second index is the length.
+    int response[2];
+    // First character of the line. Points into the block (or mapping) of the LineReader or to the scratch buffer.
+    char* line;
 
     while(1){
-        // Allocate buffer for each new line. This buffer will be freed and the string will be copied to a new proper sized buffer.
-        char* buffer = malloc(sizeof(char) * MAX_BUFFER_SIZE);
-        // In case of error, print error message and exit with failure code
-        if(buffer == NULL) {
-            PrintMallocErrorAndExit(THREADS_MODULE, READER, "Buffer");
-            return NULL;
-        }
+        // Find the next line of stdin. Only a line which spans two blocks is assembled in the scratch buffer.
+        ReadLineView(reader->lineReader, reader->buffer, &line, response);
 
-        // Allocate memory for response of reading line
-        int* response = malloc(sizeof(int)*2);
-        // Read the line from stdin
-        readLine(buffer, response);
-
-        if(response[0] == -1){ // response = -1 means buffer overflow, so skip this line
-            free(buffer);
+        if(response[0] == LINE_OVERFLOW){ // response = -1 means buffer overflow, so skip this line
             continue;
-        } else if(response[0] == -2){// response = -2 means EOF is received and there is no data in buffer. Signal end directly.
-            signalEndOfExecutionByReader(reader, buffer, 1);
+        } else if(response[0] == LINE_EOF){// response = -2 means EOF is received and there is no data in buffer. Signal end directly.
+            signalEndOfExecutionByReader(reader);
             break;
-        } else if(response[0] == -3){// response = -3 means EOF is received and there is some data to be copied in buffer. Copy data then signal end.
-            copyLineToQueue(reader, buffer, response[1]);
-            signalEndOfExecutionByReader(reader, NULL, 0);
+        } else if(response[0] == LINE_EOF_WITH_DATA){// response = -3 means EOF is received and there is some data to be copied in buffer. Copy data then signal end.
+            // The last line is not followed by a newline in the input, so it is always copied
+            copyLineToQueue(reader, line, response[1], 0);
+            signalEndOfExecutionByReader(reader);
             break;
-        } else if(response[0] == -4){// response = -4 means EOF is received after the current line overflow the buffer. So skip line and signal end.
-            signalEndOfExecutionByReader(reader, buffer, 1);
+        } else if(response[0] == LINE_EOF_AFTER_OVERFLOW){// response = -4 means EOF is received after the current line overflow the buffer. So skip line and signal end.
+            signalEndOfExecutionByReader(reader);
             break;
         }
 
-        // In case of normal execution, copy the contents to an appropriately sized string and enqueue it.
-        copyLineToQueue(reader, buffer, response[1]);
-        free(response);
+        // A segment is continued by the next line (or segment) which is read
+        unsigned flags = response[0] == LINE_SEGMENT ? RECORD_CONTINUED : 0;
+        // In case of normal execution, point to the mapped line or copy it to an appropriately sized pooled buffer
+        if(reader->lineReader->mapped && line != reader->buffer){
+            enqueueLine(reader, line, response[1], flags, NULL);
+        } else {
+            copyLineToQueue(reader, line, response[1], flags);
+        }
     }
 
     pthread_exit(NULL);
 }
 
 /**
- * @function StartMunch1
- * @argument ptr - Munch1 struct
+ * @function StartStageWorker
+ * @argument ptr - StageWorker struct
  * @description
- * This method runs in its own thread and performs Munch1 functionality i.e. converts space to *
- * Adds the converted string to shared queue between Munch1 and Munch2
+ * This method runs in its own thread and applies the transform of its stage, Example- Munch1 converts space to *
+ * Strings are drained from the input queue in batches. The whole batch is handed to the transform in one call and
+ * then forwarded to the queue of the next stage.
  * */
-void* StartMunch1(void* ptr){
-    Munch1* munch1 = (Munch1*) ptr;
+void* StartStageWorker(void* ptr){
+    StageWorker* worker = (StageWorker*) ptr;
+    Record batch[MAX_BATCH_SIZE];
+    StageRecord records[MAX_BATCH_SIZE];
 
     while(1){
-        // Dequeue a string from Reader-Munch1 queue
-        char* str = DequeueString(munch1->inputQueue);
-        // EndOfExecution is signalled by NULL being passed through the pipeline.
-        if(str == NULL){
-            // Propagate EndOfExecution to next stage and terminate this thread
-            EnqueueString(munch1->outputQueue, NULL);
+        // Dequeue all the strings available in the input queue (at most MAX_BATCH_SIZE)
+        int count = DequeueStrings(worker->inputQueue, batch, MAX_BATCH_SIZE);
+        int index, endOfExecution = 0;
+        for(index = 0; index < count; index++){
+            // EndOfExecution is signalled by a record flagged with RECORD_END_OF_STREAM.
+            if(batch[index].flags & RECORD_END_OF_STREAM){
+                endOfExecution = 1;
+                break;
+            }
+            records[index].data = batch[index].data;
+            records[index].length = batch[index].length;
+        }
+        // Transform the strings in place
+        TraceRecords(TRACE_TRANSFORM_BEGIN, worker->stage->name, batch, index);
+        if(index > 0) worker->stage->transform(records, (size_t) index);
+        TraceRecords(TRACE_TRANSFORM_END, worker->stage->name, batch, index);
+        AddToMetricsCounter(worker->group->processed, (unsigned long) index);
+        // Enqueue the converted strings to next stage queue
+        EnqueueStrings(worker->outputQueue, batch, index);
+        // Once EndOfExecution has been received, propagate it and terminate this thread
+        if(endOfExecution){
+            signalEndOfExecutionByWorker(worker->group, worker->inputQueue, worker->outputQueue);
             break;
         }
-        // Convert space to *
-        replaceSpaceWithAsterisk(str);
-        // Enqueue this string to next stage queue
-        EnqueueString(munch1->outputQueue, str);
     }
 
     pthread_exit(NULL);
 }
 
 /**
- * @function StartMunch2
- * @argument ptr - Munch2 struct
+ * @function StartWriter
+ * @argument ptr - Writer struct
  * @description
- * This method runs in its own thread and performs Munch2 functionality i.e. converts lower case to upper case
- * Adds the converted string to shared queue between Munch2 and Writer
+ * This method runs in its own thread and writes the data to stdout. It also maintains a count of strings processed.
+ * Strings are drained from the input queue in batches and written using the OutputBatch module.
  * */
-void* StartMunch2(void* ptr){
-    Munch2* munch2 = (Munch2*) ptr;
+void* StartWriter(void* ptr){
+    Writer* writer = (Writer*) ptr;
+    Record batch[MAX_BATCH_SIZE];
+
+    int retVal, endOfExecution = 0;
+    while(!endOfExecution){
+        // Dequeue all the strings available in Munch2-Writer queue (at most MAX_BATCH_SIZE)
+        int count = DequeueStrings(writer->inputQueue, batch, MAX_BATCH_SIZE);
+        for(int index = 0; index < count; index++){
+            Record record = batch[index];
+            // EndOfExecution is signalled by a record flagged with RECORD_END_OF_STREAM.
+            if(record.flags & RECORD_END_OF_STREAM){
+                // Write the lines still in the output batch before anything else is printed
+                FlushOutputBatch(writer->output);
+                // Print the total number of strings processed and then terminate this thread.
+                retVal = printf("Writer processed %d strings!\n\n",writer->stringsProcessedCount);
+                if(retVal < 0) PrintOutputPrintErrorAndExit(THREADS_MODULE, WRITER, "Processed Count");
+                endOfExecution = 1;
+                break;
+            }
 
-    while(1){
-        // Dequeue a string from Munch1-Munch2 queue
-        char* str = DequeueString(munch2->inputQueue);
-        // EndOfExecution is signalled by NULL being passed through the pipeline.
-        if(str == NULL){
-            // Propagate EndOfExecution to next stage and terminate this thread
-            EnqueueString(munch2->outputQueue, NULL);
-            break;
+            if(writer->reorderBuffer == NULL){
+                writeString(writer, record);
+                continue;
+            }
+            // Park the string in its slot and print every string which is now next in input order
+            InsertInReorderBuffer(writer->reorderBuffer, record);
+            while(TakeNextInOrder(writer->reorderBuffer, &record)){
+                writeString(writer, record);
+            }
         }
-        // Convert lower case to upper case
-        convertLowerToUpperCase(str);
-        // Enqueue string to Munch2-Writer queue
-        EnqueueString(munch2->outputQueue, str);
+        if(writer->flushEachBatch && !endOfExecution) FlushOutputBatch(writer->output);
+        // Only the Writer updates its count, so publishing it is a plain store once per batch
+        SetMetricsCounter(writer->processed, (unsigned long) writer->stringsProcessedCount);
     }
 
     pthread_exit(NULL);
 }
 
 /**
- * @function StartWriter
- * @argument ptr - Writer struct
+ * @function StartReceiver
+ * @argument ptr - Receiver struct
  * @description
- * This method runs in its own thread and writes the data to stdout. It also maintains a count of strings processed.
+ * This method runs in its own thread and takes the place of the Reader. The lines received from the other process are
+ * stamped with their sequence number, like lines read from stdin, and enqueued for the first stage. Once the end of
+ * stream has been received it is passed on and the connection is closed.
  * */
-void* StartWriter(void* ptr){
-    Writer* writer = (Writer*) ptr;
-
-    int retVal;
-    while(1){
-        // Dequeue a string from Munch2-Writer queue
-        char* str = DequeueString(writer->inputQueue);
-        // EndOfExecution is signalled by NULL being passed through the pipeline.
-        if(str == NULL){
-            // Print the total number of strings processed and then terminate this thread.
-            retVal = printf("Writer processed %d strings!\n\n",writer->stringsProcessedCount);
-            if(retVal < 0) PrintOutputPrintErrorAndExit(THREADS_MODULE, WRITER, "Processed Count");
-            break;
+void* StartReceiver(void* ptr){
+    Receiver* receiver = (Receiver*) ptr;
+    Record batch[MAX_BATCH_SIZE];
+
+    int endOfExecution = 0;
+    while(!endOfExecution){
+        int count = NetDequeueStrings(receiver->input, batch, MAX_BATCH_SIZE);
+        int index;
+        for(index = 0; index < count; index++){
+            if(batch[index].flags & RECORD_END_OF_STREAM){
+                endOfExecution = 1;
+                break;
+            }
+            batch[index].sequence = receiver->nextSequence;
+            receiver->nextSequence = receiver->nextSequence + 1;
+            if(TraceSampled(batch[index].sequence)){
+                batch[index].flags = batch[index].flags | RECORD_TRACED;
+                TraceRecords(TRACE_READ, RECEIVER, &batch[index], 1);
+            }
+            // Each line waits for its slot in the window before it enters the pipeline, as in the Reader
+            if(receiver->reorderBuffer != NULL){
+                AcquireReorderCredit(receiver->reorderBuffer);
+                EnqueueString(receiver->outputQueue, batch[index]);
+            }
         }
-        // Print the string to stdout
-        retVal = printf("%s\n",str);
-        if(retVal < 0) PrintOutputPrintErrorAndExit(THREADS_MODULE, WRITER, "Processed-String");
-
-        // Increment the count of strings which have been processed
-        writer->stringsProcessedCount = writer->stringsProcessedCount + 1;
-        free(str);
+        if(receiver->reorderBuffer == NULL) EnqueueStrings(receiver->outputQueue, batch, index);
     }
+    EnqueueString(receiver->outputQueue, endOfStream);
+    CloseNetQueue(receiver->input);
 
     pthread_exit(NULL);
 }
 
 /**
- * @function readLine
- * @argument buffer - The buffer in which the data is stored
- * @argument response - pointer to an integer array which will hold the response
+ * @function StartSender
+ * @argument ptr - Sender struct
  * @description
- * This method reads a line from stdin using fgetc. If the total length of string becomes equal to max buffer size, then we ignore that line.
- *
- * The response is returned by this method using the response array taken as param.
- * The first index corresponds to status and the second index corresponds to length of the string
- *
- * For Status-
- * A status value of -1 means that the buffer was flushed due to length of line exceeding the max size
- * A status value of -2 means that EOF has been reached with empty buffer
- * A status value of -3 means that EOF has been reached with some value in buffer
- * A status value of -4 means that EOF was reached after line length exceeded Max length. Therefore skip the line.
- * A status value of 0 means normal execution
- *
- * When buffer contains some value then we append '\0' at the end.
- * Second index of response is set to length for status 0, -3.
- *
- * Explanation for newline case-
- * response would be [0,0] which means normal execution and length of 0.
- * In the copyLine method, a null string would be created which will be enqueued.
+ * This method runs in its own thread and takes the place of the Writer. Strings are drained from the input queue in
+ * batches, put back in input order like in the Writer and sent to the other process. The end of stream is sent last,
+ * after which the connection is closed.
  * */
-static void readLine(char* buffer, int* response){
-    int len = 0, eof = 0, retVal = 0;
-    char ch;
-    while(1){
-        // Read a character from stdin
-        ch = fgetc(stdin);
-
-        // If the total length until now exceeds MAX_BUFFER_SIZE -1 then do not update the buffer. Wait for EOF or newline.
-        // Consider that MAX_BUFFER_SIZE is 10. Then when len == 10 then 10 characters would have been placed in buffer and there won't be space for last '\0'
-        // Hence this would be an overflow
-        if(len >= MAX_BUFFER_SIZE){
-            // In case of EOF being received, we will use eof variable as a flag
-            if(ch == EOF) {
-                eof = 1;
+void* StartSender(void* ptr){
+    Sender* sender = (Sender*) ptr;
+    Record batch[MAX_BATCH_SIZE];
+    // Strings in input order which are sent next
+    Record ordered[MAX_BATCH_SIZE];
+
+    int endOfExecution = 0;
+    while(!endOfExecution){
+        int count = DequeueStrings(sender->inputQueue, batch, MAX_BATCH_SIZE);
+        int orderedCount = 0;
+        for(int index = 0; index < count; index++){
+            Record record = batch[index];
+            // EndOfExecution is signalled by a record flagged with RECORD_END_OF_STREAM. It is sent after every string.
+            if(record.flags & RECORD_END_OF_STREAM){
+                sendInOrder(sender, ordered, &orderedCount, record);
+                endOfExecution = 1;
                 break;
             }
-            else if(ch == '\n') { // In case len >= MAX_BUFFER_SIZE wait for len to break the read loop
-                break;
+
+            if(sender->reorderBuffer == NULL){
+                sendInOrder(sender, ordered, &orderedCount, record);
+                continue;
             }
-        } else {
-            // If the total len is less that max buffer size then execute this
-            if(ch == EOF){ // If EOF is received then check the len to set the appropriate return value
-                if(len == 0){
-                    response[0] = -2;
-                } else {
-                    buffer[len] = '\0';
-                    response[0] = -3;
-                    response[1] = len;
-                }
-                break;
-            } else if(ch == '\n'){ // If this is new line char then ignore it and break the read loop
-                buffer[len] = '\0';
-                response[0] = 0;
-                response[1] = len;
-                break;
+            // Park the string in its slot and send every string which is now next in input order
+            InsertInReorderBuffer(sender->reorderBuffer, record);
+            while(TakeNextInOrder(sender->reorderBuffer, &record)){
+                sendInOrder(sender, ordered, &orderedCount, record);
             }
-            // In case of normal character with len < MAX_BUFFER_SIZE, update the buffer
-            buffer[len++] = ch;
         }
+        NetEnqueueStrings(sender->output, ordered, orderedCount);
+        SetMetricsCounter(sender->processed, sender->output->recordCount);
     }
+    CloseNetQueue(sender->output);
 
-    // In case of buffer overflow, set the appropriate return value depending on eof flag
-    if(len >= MAX_BUFFER_SIZE){
-        if(eof == 0) {
-            response[0] = -1;
-            response[1] = 0;
-        }
-        else {
-            response[0] = -4;
-            response[1] = 0;
-        }
-        retVal = fprintf(stderr, "Current line's length exceeded the max size of buffer. Skipping it.\n");
-        if(retVal < 0) PrintOutputPrintErrorAndExit(THREADS_MODULE, READER, "STDERR-Buffer-Exceeded");
+    pthread_exit(NULL);
+}
+
+/**
+ * @function PrintWriterStats
+ * @argument writer - Writer struct
+ * @description
+ * Print the number of bytes and system calls used by the Writer to write the output
+ * */
+void PrintWriterStats(Writer* writer){
+    PrintOutputBatchStats(writer->output);
+}
+
+/**
+ * @function PrintReceiverStats
+ * @argument receiver - Receiver struct
+ * @description Print the frames, records and bytes received by the Receiver
+ * */
+void PrintReceiverStats(Receiver* receiver){
+    PrintNetQueueStats(receiver->input);
+}
+
+/**
+ * @function PrintSenderStats
+ * @argument sender - Sender struct
+ * @description Print the frames, records and bytes sent by the Sender and how often it waited for credits
+ * */
+void PrintSenderStats(Sender* sender){
+    PrintNetQueueStats(sender->output);
+}
+
+/**
+ * @function sendInOrder
+ * @argument sender - Sender struct
+ * @argument batch - Strings in input order which have not been sent yet
+ * @argument count - Number of strings in the batch. Reset when the batch is sent.
+ * @argument record - Record of the next string in input order
+ * @description Add the string to the batch. A full batch is sent right away.
+ * */
+static void sendInOrder(Sender* sender, Record* batch, int* count, Record record){
+    TraceRecords(TRACE_WRITE, SENDER, &record, 1);
+    batch[*count] = record;
+    *count = *count + 1;
+    if(*count == MAX_BATCH_SIZE){
+        NetEnqueueStrings(sender->output, batch, *count);
+        *count = 0;
     }
 }
 
+/**
+ * @function writeString
+ * @argument writer - Writer struct
+ * @argument record - Record of the string to be printed
+ * @description
+ * Add the string to the output batch and update the count of strings processed.
+ * Its buffer, if pooled, is returned to the pool of the Reader once the batch has been written.
+ * A segment of a long line is written as it is and the line is counted once its last segment is written.
+ * */
+static void writeString(Writer* writer, Record record){
+    TraceRecords(TRACE_WRITE, WRITER, &record, 1);
+    AppendToOutputBatch(writer->output, record);
+
+    // Increment the count of strings which have been processed
+    if(!(record.flags & RECORD_CONTINUED)) writer->stringsProcessedCount = writer->stringsProcessedCount + 1;
+}
+
 /**
  * @function copyLine
  * @argument buffer - Buffer in which data was being stored i.e. input buffer
@@ -312,13 +476,9 @@ static void readLine(char* buffer, int* response){
  * This method copies the data from input buffer to output buffer
  * */
 static void copyLine(char* buffer, char* str, int len){
-    int i = 0;
-    while(i < len){
-        str[i] = buffer[i];
-        i = i + 1;
-    }
-    // Last character of the line should be null
-    str[len] = '\0';
+    memcpy(str, buffer, len);
+    // The line is followed by its newline, as in the input, so that the Writer can write both at once
+    str[len] = '\n';
 }
 
 /**
@@ -326,78 +486,75 @@ static void copyLine(char* buffer, char* str, int len){
  * @argument reader - Reader struct
  * @argument buffer - Buffer in which data was being stored
  * @argument len - length of the input string
+ * @argument flags - RECORD_* values of the line
  * @description
- * This method allocates a new string buffer which is equal to the length of the input string.
- * The contents of the buffer are copied in this new buffer which is then enqueued on Reader-Munch1 queue
+ * This method takes a pooled buffer which can hold the input string from the buffer pool of the reader.
+ * The contents of the buffer are copied in this pooled buffer which is then enqueued on Reader-Munch1 queue
  * */
-static void copyLineToQueue(Reader* reader, char* buffer, int len){
+static void copyLineToQueue(Reader* reader, char* buffer, int len, unsigned flags){
     if(buffer == NULL) return;
 
-    // Allocate a new buffer which is equal to the length  of the string + 1. Extra 1 is for the null character at the end.
-    char* str = calloc(len+1, sizeof(char));
-    if(str == NULL) {
-        free(buffer);
-        PrintMallocErrorAndExit(THREADS_MODULE, READER, "calloc-reallocateString");
-        return;
-    }
+    // Take a buffer which can hold the string + 1. Extra 1 is for the newline at the end.
+    char* str = AllocateLineBuffer(reader->bufferPool, len);
 
-    // Copy the contents of original buffer into new buffer
+    // Copy the contents of original buffer into pooled buffer
     copyLine(buffer, str, len);
-    // Free the original buffer
-    free(buffer);
-    // Enqueue the string in Reader-Munch1 queue
-    EnqueueString(reader->outputQueue, str);
+    enqueueLine(reader, str, len, flags, str);
 }
 
 /**
- * @function signalEndOfExecutionByReader
+ * @function enqueueLine
  * @argument reader - Reader struct
- * @argument buffer - Buffer in which data was being stored
- * @argument freeBuffer - If 1 then free the buffer else ignore it
+ * @argument data - First character of the line, in a pooled buffer or in the mapped input
+ * @argument len - length of the line
+ * @argument flags - RECORD_* values of the line
+ * @argument pooledBuffer - Pooled buffer which holds the line. NULL if it is in the mapped input.
  * @description
- * This function signals the end of execution from Reader by passing a NULL value in the Reader-Munch1 queue
+ * Build the record of the line, stamp it with its sequence number and enqueue it on Reader-Munch1 queue.
+ * The line is flagged with RECORD_TRACED if it is sampled for tracing.
  * */
-static void signalEndOfExecutionByReader(Reader* reader, char* buffer, int freeBuffer){
-    if(freeBuffer){
-        free(buffer);
+static void enqueueLine(Reader* reader, char* data, int len, unsigned flags, char* pooledBuffer){
+    // Stamp the line with its position in the input
+    Record record = {data, (unsigned int) len, flags, reader->nextSequence, pooledBuffer};
+    reader->nextSequence = reader->nextSequence + 1;
+    // A traced line starts here, so its slice includes the wait for a slot in the reorder window
+    if(TraceSampled(record.sequence)){
+        record.flags = record.flags | RECORD_TRACED;
+        TraceRecords(TRACE_READ, READER, &record, 1);
     }
-    // EndOfExecution is signalled by NULL being passed through the pipeline.
-    // Therefore, pass NULL to Reader-Munch1 queue
-    EnqueueString(reader->outputQueue, NULL);
+    // If the lines have to be reordered later then wait for a slot in the window before the line enters the pipeline
+    if(reader->reorderBuffer != NULL) AcquireReorderCredit(reader->reorderBuffer);
+    // Enqueue the string in Reader-Munch1 queue
+    EnqueueString(reader->outputQueue, record);
 }
 
 /**
- * @function replaceSpaceWithAsterisk
- * @argument str - The string to be processed
+ * @function signalEndOfExecutionByReader
+ * @argument reader - Reader struct
  * @description
- * This function converts spaces in a string to *
+ * This function signals the end of execution from Reader by passing the end of stream record in the Reader-Munch1 queue
  * */
-static void replaceSpaceWithAsterisk(char* str){
-    int index, len = strlen(str);
-    // Iterate over the length of string
-    for(index = 0; index < len; index++){
-        char ch = str[index];
-        // If current character is space then change it to *
-        if(ch == ' '){
-            str[index] = '*';
-        }
-    }
+static void signalEndOfExecutionByReader(Reader* reader){
+    // EndOfExecution is signalled by a record flagged with RECORD_END_OF_STREAM being passed through the pipeline.
+    EnqueueString(reader->outputQueue, endOfStream);
 }
 
 /**
- * @function convertLowerToUpperCase
- * @argument str - The string to be processed
+ * @function signalEndOfExecutionByWorker
+ * @argument group - Workers of the stage
+ * @argument inputQueue - Queue from which the worker received the end of stream
+ * @argument outputQueue - Queue of the next stage
  * @description
- * This function converts a lowercase string to upper case
+ * Called by a stage worker once it has received the end of stream and forwarded all its strings.
+ * If other workers of the stage are still running then the end of stream is put back in the input queue so that the
+ * next worker also receives it. The last worker to finish passes it to the next stage. As every other worker has
+ * already forwarded its strings, the end of stream is always enqueued after the last string of the stage.
  * */
-static void convertLowerToUpperCase(char* str){
-    int index, len = strlen(str);
-    // Iterate over the length of string
-    for(index = 0; index < len; index++){
-        char ch = str[index];
-        // If the current character is lower case then change it to upper case
-        if(islower(ch) > 0){
-            str[index] = toupper(str[index]);
-        }
+static void signalEndOfExecutionByWorker(WorkerGroup* group, Queue* inputQueue, Queue* outputQueue){
+    int remaining = atomic_fetch_sub(&group->activeWorkers, 1) - 1;
+    if(remaining > 0){
+        EnqueueString(inputQueue, endOfStream);
+    } else {
+        EnqueueString(outputQueue, endOfStream);
     }
 }
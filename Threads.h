@@ -5,77 +5,159 @@
  * @description
  * This module implements the main functionality of Consumer-Producer problem.
  * We have a reader which reads the data from stdin and writes the same to its queue.
- * Munch1 runs in its own thread and waits for Reader to enqueue a string on the queue.
- * It takes the string and replaces spaces with *
- * Munch2 runs in its own thread and waits for Munch1 to complete its task and enqueue the string in the shared queue.
- * It takes the string and converts lower case to upper case.
+ * The transform stages (Stage module) run between the Reader and the Writer, each in its own thread. By default these
+ * are Munch1, which replaces spaces with *, and Munch2, which converts lower case to upper case. In the fused mode,
+ * a single FusedMunch stage performs both conversions in one pass. Any other stage can be loaded from a plugin.
+ * Every stage waits for the previous one to enqueue strings in the shared queue, transforms them in batches and
+ * enqueues them for the next one. A line is passed as a Record which carries its length, so no stage scans for its end.
  * Writer is the last thread which takes the string from shared queue and writes it to stdout
  * In case of any error in any thread, we print an error message and exit with failure code.
  *
+ * Every stage can run as a pool of workers sharing the same queues (WorkerGroup).
+ * The Reader then stamps each line with a sequence number and the Writer restores the input order (ReorderBuffer module).
+ *
+ * The Reader, the workers of a stage and the Writer may also run in separate processes which share the queues in a
+ * shared memory segment. Only the Reader needs to know about it- its lines are copied into buffers of that segment.
+ *
+ * A pipeline can also be split between two prodcom processes, possibly on two hosts, connected by a NetQueue. The
+ * Sender then takes the place of the Writer of the first one and the Receiver the place of the Reader of the second.
+ *
  * @functions
+ * CreateWorkerGroup - Create a struct shared by the workers of a stage
  * CreateReader - Create a reader struct
- * CreateMunch1 - Create a Munch1 struct
- * CreateMunch2 - Create a Munch2 struct
+ * CreateStageWorker - Create a struct for a worker of a transform stage
  * CreateWriter - Create a Writer struct
+ * CreateReceiver - Create a Receiver struct, which waits for the Sender of the other process to connect
+ * CreateSender - Create a Sender struct, which connects to the Receiver of the other process
+ * PrintWriterStats - Print the number of bytes and system calls used to write the output
+ * PrintReceiverStats, PrintSenderStats - Print the frames, records and bytes moved over the network queue
  *
  * All the methods below run in their own thread.
- * StartReader - Read from stdin as per given constraints and enqueue the string in shared queue with Munch1
- * StartMunch1 - Take the string from shared queue with reader and perform Munch1 operation.
- * StartMunch2 - Take the string from shared queue with Munch1 and perform Munch2 operation.
- * StartWriter - Take the string from shared queue with Munch2 and write the same to stdout
+ * StartReader - Read from stdin as per given constraints and enqueue the string in shared queue with the first stage
+ * StartStageWorker - Take the strings from shared queue with the previous stage and apply the transform of the stage.
+ * StartWriter - Take the string from shared queue with the last stage and write the same to stdout
+ * StartReceiver - Receive the strings from the network queue and enqueue them in shared queue with the first stage
+ * StartSender - Take the strings from shared queue with the last stage and send them over the network queue
  * */
 
 #ifndef ASSIGNMENT2_THREADS_H
+#include <stdatomic.h>
 #include "Queue.h"
+#include "LineReader.h"
+#include "BufferPool.h"
+#include "ReorderBuffer.h"
+#include "OutputBatch.h"
+#include "Stage.h"
+#include "NetQueue.h"
+#include "Metrics.h"
 
 
 #define ASSIGNMENT2_THREADS_H
 // Define maximum buffer size to be used for any string
 #define MAX_BUFFER_SIZE 4096
+// Maximum number of strings moved between two stages in a single queue operation
+#define MAX_BATCH_SIZE 64
 // Define constants for various strings
 #define THREADS_MODULE "Threads"
 #define READER "Reader"
-#define MUNCH1 "Munch1"
-#define MUNCH2 "Munch2"
 #define WRITER "Writer"
+#define RECEIVER "Receiver"
+#define SENDER "Sender"
+
+// Struct shared by all the workers which run the same stage
+typedef struct{
+    // Number of workers in the stage
+    int workers;
+    // Number of workers which have not received the end of stream yet
+    atomic_int activeWorkers;
+    // Records transformed by the workers, exported by the Metrics module. NULL if no metrics are exported.
+    MetricsCounter* processed;
+} WorkerGroup;
 
 // Struct for Reader
 typedef struct{
-    // Shared queue of Reader-Munch1
+    // Shared queue with the first stage
     Queue* outputQueue;
+    // Window which bounds the lines in flight when they have to be reordered. NULL otherwise.
+    ReorderBuffer* reorderBuffer;
+    // Sequence number stamped on the next line
+    unsigned long nextSequence;
+    // Splits the lines out of large blocks read from stdin or out of the mapping of stdin
+    LineReader* lineReader;
+    // Pool from which the buffer of each copied line is taken
+    BufferPool* bufferPool;
+    // Scratch buffer into which a line is read
+    char* buffer;
 } Reader;
 
-// Struct for Munch1
+// Struct for a worker of a transform stage
 typedef struct{
-    // Shared queue of Reader-Munch1
+    // Shared queue with the previous stage or the Reader
     Queue* inputQueue;
-    // Shared queue of Munch1-Munch2
+    // Shared queue with the next stage or the Writer
     Queue* outputQueue;
-} Munch1;
+    // Workers running this stage
+    WorkerGroup* group;
+    // Name and transform of the stage
+    Stage* stage;
+} StageWorker;
 
-// Struct for Munch2
+// Struct for Writer
 typedef struct{
-    // Shared queue of Munch1-Munch2
+    // Shared queue with the last stage
     Queue* inputQueue;
-    // Shared queue of Munch2-Writer
+    // Restores the input order when a stage has several workers. NULL otherwise.
+    ReorderBuffer* reorderBuffer;
+    // Lines waiting to be written to stdout using writev
+    OutputBatch* output;
+    // If set then the output batch is written after every dequeue instead of only when it is full
+    int flushEachBatch;
+    int stringsProcessedCount;
+    // stringsProcessedCount as seen by the Metrics module, published once per batch. NULL if no metrics are exported.
+    MetricsCounter* processed;
+} Writer;
+
+// Struct for Receiver. Takes the place of the Reader when the lines come from another prodcom process.
+typedef struct{
+    // Shared queue with the first stage
     Queue* outputQueue;
-} Munch2;
+    // Window which bounds the lines in flight when they have to be reordered. NULL otherwise.
+    ReorderBuffer* reorderBuffer;
+    // Sequence number stamped on the next line
+    unsigned long nextSequence;
+    // Consumer side of the network queue
+    NetQueue* input;
+} Receiver;
 
-// Struct for Writer
+// Struct for Sender. Takes the place of the Writer when the lines go on to another prodcom process.
 typedef struct{
-    // Shared queue of Munch2-Writer
+    // Shared queue with the last stage
     Queue* inputQueue;
-    int stringsProcessedCount;
-} Writer;
+    // Restores the input order when a stage has several workers. NULL otherwise.
+    ReorderBuffer* reorderBuffer;
+    // Producer side of the network queue
+    NetQueue* output;
+    // Records sent, exported by the Metrics module. NULL if no metrics are exported.
+    MetricsCounter* processed;
+} Sender;
+
+WorkerGroup* CreateWorkerGroup(int workers, MetricsCounter* processed);
+Reader* CreateReader(Queue* outputQueue, ReorderBuffer* reorderBuffer, int mapInput, int ioUring, int streamLongLines,
+                     SharedSegment* segment);
+StageWorker* CreateStageWorker(Queue* inputQueue, Queue* outputQueue, WorkerGroup* group, Stage* stage);
+Writer* CreateWriter(Queue* inputQueue, ReorderBuffer* reorderBuffer, int ioUring, MetricsCounter* processed);
+Receiver* CreateReceiver(Queue* outputQueue, ReorderBuffer* reorderBuffer, char* address, int capacity,
+                         SharedSegment* segment);
+Sender* CreateSender(Queue* inputQueue, ReorderBuffer* reorderBuffer, char* address, MetricsCounter* processed);
 
-Reader* CreateReader(Queue* outputQueue);
-Munch1* CreateMunch1(Queue* inputQueue, Queue* outputQueue);
-Munch2* CreateMunch2(Queue* inputQueue, Queue* outputQueue);
-Writer* CreateWriter(Queue* inputQueue);
+void PrintWriterStats(Writer* writer);
+void PrintReceiverStats(Receiver* receiver);
+void PrintSenderStats(Sender* sender);
 
 void* StartReader(void* ptr);
-void* StartMunch1(void* ptr);
-void* StartMunch2(void* ptr);
+void* StartStageWorker(void* ptr);
 void* StartWriter(void* ptr);
+void* StartReceiver(void* ptr);
+void* StartSender(void* ptr);
 
 #endif
@@ -0,0 +1,309 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "Trace.h"
+#include "statistics.h"
+#include "Error.h"
+
+// Deepest nesting of the slices of a line- the line, and a queue or a stage in it
+#define TRACE_MAX_DEPTH 2
+
+// Event of a ring. WriteTrace sorts the events of all the rings by line.
+typedef struct {
+    TraceEvent* event;
+    TraceRing* ring;
+} TraceEntry;
+
+static TraceRing* findRing(void);
+static int compareEntries(const void* left, const void* right);
+static int opensSlice(TraceEvent* event);
+static int closesSlice(TraceEvent* open, TraceEvent* close);
+static void writeEvent(FILE* file, Trace* trace, TraceRing* ring, TraceEvent* event);
+static void writeString(FILE* file, const char* str);
+
+// Trace of the pipeline. NULL unless tracing is enabled.
+static Trace* activeTrace = NULL;
+// Ring of this thread. Allocated on its first event.
+static _Thread_local TraceRing* threadRing = NULL;
+
+/**
+ * @function StartTrace
+ * @argument path - File the trace is written to by WriteTrace
+ * @argument sampleEvery - One line in sampleEvery is traced
+ * @argument segment - Shared segment from which the rings are allocated. NULL allocates them from the heap.
+ * @description
+ * Enable tracing. Must be called before the threads (and processes) of the pipeline are created.
+ * */
+void StartTrace(char* path, unsigned long sampleEvery, SharedSegment* segment){
+    Trace* trace = AllocateAligned(segment, 64, sizeof(Trace));
+    if(trace == NULL) PrintMallocErrorAndExit(TRACE_MODULE, path, "Trace");
+
+    trace->path = path;
+    trace->sampleEvery = sampleEvery;
+    trace->segment = segment;
+    trace->processId = (long) getpid();
+    trace->startTime = GetMonotonicTime();
+    atomic_init(&trace->rings, NULL);
+
+    activeTrace = trace;
+}
+
+/**
+ * @function TraceSampled
+ * @argument sequence - Sequence number of the line
+ * @description
+ * Return 1 if the line is traced, 0 if it is not or tracing is disabled
+ * */
+int TraceSampled(unsigned long sequence){
+    return activeTrace != NULL && sequence % activeTrace->sampleEvery == 0;
+}
+
+/**
+ * @function TraceRecords
+ * @argument type - Point of the pipeline the records have reached
+ * @argument name - Queue or stage at which the event happens. Must outlive the pipeline.
+ * @argument records - Array of records
+ * @argument count - Number of records in the array
+ * @description
+ * Record an event in the ring of this thread for every record flagged with RECORD_TRACED. The clock is only read
+ * if the array holds a traced record.
+ * */
+void TraceRecords(TraceEventType type, char* name, Record* records, int count){
+    if(activeTrace == NULL) return;
+
+    unsigned long long time = 0;
+    for(int index = 0; index < count; index++){
+        if(!(records[index].flags & RECORD_TRACED)) continue;
+        if(time == 0) time = GetMonotonicTime();
+
+        TraceRing* ring = findRing();
+        if(ring == NULL) return;
+        unsigned long recorded = atomic_load_explicit(&ring->recorded, memory_order_relaxed);
+        // A full ring keeps its first events, so the slices of the lines traced early stay complete
+        if(recorded == TRACE_RING_EVENTS){
+            unsigned long dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+            atomic_store_explicit(&ring->dropped, dropped + 1, memory_order_relaxed);
+            continue;
+        }
+        TraceEvent* event = &ring->events[recorded];
+        event->time = time;
+        event->sequence = records[index].sequence;
+        event->name = name;
+        event->type = type;
+        // Publish the event. WriteTrace reads the rings once the threads are joined, the release is for the processes.
+        atomic_store_explicit(&ring->recorded, recorded + 1, memory_order_release);
+    }
+}
+
+/**
+ * @function WriteTrace
+ * @description
+ * Write the events of every ring to the trace file as Chrome trace-event JSON. Called once every thread (and process)
+ * of the pipeline has finished. The events are sorted by line and a line is only written if every slice it opens is
+ * closed by the matching event, so a line with events dropped by a full ring does not show up as an open slice.
+ * Prints the number of lines and events written and dropped on stderr. Does nothing if tracing is disabled.
+ * */
+void WriteTrace(void){
+    Trace* trace = activeTrace;
+    if(trace == NULL) return;
+
+    // Gather the events of every ring
+    size_t count = 0;
+    unsigned long dropped = 0;
+    for(TraceRing* ring = atomic_load_explicit(&trace->rings, memory_order_acquire); ring != NULL; ring = ring->next){
+        count = count + atomic_load_explicit(&ring->recorded, memory_order_acquire);
+        dropped = dropped + atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+    }
+    TraceEntry* entries = malloc(sizeof(TraceEntry) * (count + 1));
+    if(entries == NULL) PrintMallocErrorAndExit(TRACE_MODULE, trace->path, "Events");
+    size_t next = 0;
+    for(TraceRing* ring = atomic_load_explicit(&trace->rings, memory_order_acquire); ring != NULL; ring = ring->next){
+        unsigned long recorded = atomic_load_explicit(&ring->recorded, memory_order_acquire);
+        for(unsigned long index = 0; index < recorded; index++){
+            entries[next].event = &ring->events[index];
+            entries[next].ring = ring;
+            next = next + 1;
+        }
+    }
+    qsort(entries, count, sizeof(TraceEntry), compareEntries);
+
+    FILE* file = fopen(trace->path, "w");
+    if(file == NULL) PrintSystemCallErrorAndExit(TRACE_MODULE, trace->path, "fopen", errno);
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":0,\"args\":{\"name\":\"prodcom\"}}",
+            trace->processId);
+    for(TraceRing* ring = atomic_load_explicit(&trace->rings, memory_order_acquire); ring != NULL; ring = ring->next){
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%ld,\"args\":{\"name\":",
+                trace->processId, ring->threadId);
+        writeString(file, ring->threadName);
+        fprintf(file, "}}");
+    }
+
+    // Events of one line are adjacent. Write the line if every slice it opens is closed by the matching event.
+    unsigned long lines = 0, incomplete = 0;
+    size_t written = 0;
+    size_t first = 0;
+    while(first < count){
+        unsigned long sequence = entries[first].event->sequence;
+        TraceEvent* open[TRACE_MAX_DEPTH];
+        int depth = 0, complete = entries[first].event->type == TRACE_READ;
+        size_t last;
+        for(last = first; last < count && entries[last].event->sequence == sequence; last++){
+            TraceEvent* event = entries[last].event;
+            if(opensSlice(event)) {
+                if(depth == TRACE_MAX_DEPTH) complete = 0;
+                else open[depth++] = event;
+            } else if(depth > 0 && closesSlice(open[depth - 1], event)) {
+                depth = depth - 1;
+            } else {
+                complete = 0;
+            }
+        }
+        if(complete && depth == 0){
+            for(size_t index = first; index < last; index++) writeEvent(file, trace, entries[index].ring, entries[index].event);
+            lines = lines + 1;
+            written = written + (last - first);
+        } else {
+            incomplete = incomplete + 1;
+        }
+        first = last;
+    }
+    free(entries);
+
+    fprintf(file, "\n]}\n");
+    if(fclose(file) != 0) PrintSystemCallErrorAndExit(TRACE_MODULE, trace->path, "fclose", errno);
+
+    fprintf(stderr, "Trace of 1 in %lu lines written to %s- %lu lines, %zu events", trace->sampleEvery, trace->path,
+            lines, written);
+    if(dropped > 0) fprintf(stderr, ", %lu later events dropped as the rings were full", dropped);
+    if(incomplete > 0) fprintf(stderr, ", %lu incomplete lines left out", incomplete);
+    fprintf(stderr, "\n");
+}
+
+/**
+ * @function findRing
+ * @description
+ * Return the ring of this thread. On the first call of a thread the ring is allocated and linked into the list of
+ * rings. Returns NULL if the ring could not be allocated, Example- the shared segment is full, in which case the
+ * events of the thread are not recorded.
+ * */
+static TraceRing* findRing(void){
+    if(threadRing != NULL) return threadRing;
+
+    TraceRing* ring = AllocateAligned(activeTrace->segment, 64, sizeof(TraceRing));
+    if(ring == NULL) return NULL;
+
+    memset(ring->threadName, 0, sizeof(ring->threadName));
+    if(pthread_getname_np(pthread_self(), ring->threadName, sizeof(ring->threadName)) != 0){
+        strcpy(ring->threadName, "prodcom");
+    }
+    ring->threadId = (long) syscall(SYS_gettid);
+    atomic_init(&ring->recorded, 0);
+    atomic_init(&ring->dropped, 0);
+
+    TraceRing* head = atomic_load_explicit(&activeTrace->rings, memory_order_relaxed);
+    do {
+        ring->next = head;
+    } while(!atomic_compare_exchange_weak_explicit(&activeTrace->rings, &head, ring,
+                                                   memory_order_release, memory_order_relaxed));
+    threadRing = ring;
+    return ring;
+}
+
+/**
+ * @function compareEntries
+ * @argument left, right - TraceEntry structs
+ * @description
+ * Order the events by line and then by time. Events of one ring at the same time keep the order in which they were
+ * recorded, and events of two rings at the same time put the opening event first.
+ * */
+static int compareEntries(const void* left, const void* right){
+    const TraceEntry* first = (const TraceEntry*) left;
+    const TraceEntry* second = (const TraceEntry*) right;
+    if(first->event->sequence != second->event->sequence) return first->event->sequence < second->event->sequence ? -1 : 1;
+    if(first->event->time != second->event->time) return first->event->time < second->event->time ? -1 : 1;
+    if(first->ring == second->ring) return first->event < second->event ? -1 : (first->event > second->event);
+    return opensSlice(second->event) - opensSlice(first->event);
+}
+
+/**
+ * @function opensSlice
+ * @argument event - TraceEvent struct
+ * @description Return 1 if the event opens a slice (read, enqueue and the start of a transform), 0 if it closes one
+ * */
+static int opensSlice(TraceEvent* event){
+    return event->type == TRACE_READ || event->type == TRACE_ENQUEUE || event->type == TRACE_TRANSFORM_BEGIN;
+}
+
+/**
+ * @function closesSlice
+ * @argument open - Event which opened the innermost slice of the line
+ * @argument close - Event which closes a slice
+ * @description
+ * Return 1 if the event closes the slice- a write closes the read of the line, a dequeue the enqueue on the same queue
+ * and the end of a transform its start in the same stage. Returns 0 if an event of the line was dropped in between.
+ * */
+static int closesSlice(TraceEvent* open, TraceEvent* close){
+    if(open->type == TRACE_READ) return close->type == TRACE_WRITE;
+    if(open->type == TRACE_ENQUEUE) return close->type == TRACE_DEQUEUE && open->name == close->name;
+    return close->type == TRACE_TRANSFORM_END && open->name == close->name;
+}
+
+/**
+ * @function writeEvent
+ * @argument file - Trace file
+ * @argument trace - Trace struct
+ * @argument ring - Ring which holds the event
+ * @argument event - Event to write
+ * @description
+ * Write an event as the begin or end of a nestable async slice. All the slices of a line share its sequence number
+ * as id- the line itself from read to write, and nested in it one slice per queue and per stage.
+ * */
+static void writeEvent(FILE* file, Trace* trace, TraceRing* ring, TraceEvent* event){
+    // Reads, enqueues and the start of a transform open a slice, the other events close the last one opened
+    const char* phase = opensSlice(event) ? "b" : "e";
+    const char* category = (event->type == TRACE_ENQUEUE || event->type == TRACE_DEQUEUE) ? "queue" : "stage";
+
+    unsigned long long elapsed = event->time > trace->startTime ? event->time - trace->startTime : 0;
+    fprintf(file, ",\n{\"ph\":\"%s\",\"id\":\"0x%lx\",\"pid\":%ld,\"tid\":%ld,\"ts\":%llu.%03llu,",
+            phase, event->sequence, trace->processId, ring->threadId, elapsed / 1000, elapsed % 1000);
+    if(event->type == TRACE_READ || event->type == TRACE_WRITE){
+        fprintf(file, "\"cat\":\"line\",\"name\":\"Line %lu\"", event->sequence);
+        if(event->type == TRACE_READ) fprintf(file, ",\"args\":{\"read by\":");
+        else fprintf(file, ",\"args\":{\"written by\":");
+        writeString(file, event->name);
+        fprintf(file, "}}");
+    } else {
+        fprintf(file, "\"cat\":\"line\",\"name\":");
+        writeString(file, event->name);
+        fprintf(file, ",\"args\":{\"kind\":\"%s\"}}", category);
+    }
+}
+
+/**
+ * @function writeString
+ * @argument file - Trace file
+ * @argument str - String to write
+ * @description
+ * Write the string as a JSON string, escaping quotes, backslashes and control characters
+ * */
+static void writeString(FILE* file, const char* str){
+    fputc('"', file);
+    for(const unsigned char* current = (const unsigned char*) str; *current != '\0'; current++){
+        if(*current == '"' || *current == '\\') fprintf(file, "\\%c", *current);
+        else if(*current < 0x20) fprintf(file, "\\u%04x", *current);
+        else fputc(*current, file);
+    }
+    fputc('"', file);
+}
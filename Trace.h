@@ -0,0 +1,104 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module traces single lines through the pipeline. The Reader samples 1 in N lines by their sequence number and
+ * flags their record with RECORD_TRACED. Every queue then records when a traced line is offered to it and when it is
+ * dequeued, every stage when it starts and finishes transforming the batch holding the line, and the Writer when the
+ * line is written. The aggregate stats of the queues show how long operations take on average, a trace shows where
+ * one slow line actually waited.
+ *
+ * Events go into a ring of the thread which records them, allocated on its first event. Only that thread writes the
+ * ring, so recording an event is two stores and no lock. Once the ring is full the thread only counts the events it
+ * drops. A full ring keeps its first events, so the lines traced early stay complete.
+ * The rings are linked into a list with a compare-and-swap when they are created. With --processes the state and the
+ * rings are allocated in the shared segment, so the parent process sees the rings of every role.
+ *
+ * Once the pipeline is done the rings are written as Chrome trace-event JSON, which Perfetto (ui.perfetto.dev) and
+ * chrome://tracing open. Each traced line is a nested async slice- the line from read to write, and within it a slice
+ * per queue (from being offered to being dequeued, so it includes the time blocked on a full queue) and per stage.
+ * Gaps between the slices are time spent in a worker's batch or in the reorder window. A line is only written if all its
+ * slices are closed, so a line whose later events were dropped is left out instead of showing up as an open slice.
+ *
+ * Without --trace nothing is allocated and each hook returns after checking a single pointer.
+ *
+ * @functions
+ * StartTrace - Enable tracing of 1 in N lines
+ * TraceSampled - Whether the line with the given sequence number is traced
+ * TraceRecords - Record an event for every traced record of an array
+ * WriteTrace - Write the events of every thread to the trace file as Chrome trace-event JSON
+ * */
+
+#ifndef ASSIGNMENT2_TRACE_H
+#define ASSIGNMENT2_TRACE_H
+
+#include <stdatomic.h>
+#include "Record.h"
+#include "SharedSegment.h"
+
+#define TRACE_MODULE "Trace"
+// Default number of lines per traced line
+#define TRACE_DEFAULT_SAMPLE 1000
+// Number of events kept per thread. Later events of the thread are dropped once its ring is full.
+#define TRACE_RING_EVENTS 65536
+
+// Points of the pipeline at which a traced line is recorded
+typedef enum {
+    // Read by the Reader (or received by the Receiver). Starts the slice of the line.
+    TRACE_READ,
+    // Offered to a queue and dequeued from it
+    TRACE_ENQUEUE,
+    TRACE_DEQUEUE,
+    // Start and end of the transform of the batch holding the line
+    TRACE_TRANSFORM_BEGIN,
+    TRACE_TRANSFORM_END,
+    // Written by the Writer (or sent by the Sender). Ends the slice of the line.
+    TRACE_WRITE
+} TraceEventType;
+
+// Kept at 32 bytes
+typedef struct {
+    // Time of CLOCK_MONOTONIC in nanoseconds
+    unsigned long long time;
+    // Sequence number of the line
+    unsigned long sequence;
+    // Queue or stage at which the event happened. Example- 'Reader-Munch1' or 'Munch1'
+    char* name;
+    TraceEventType type;
+} TraceEvent;
+
+// Events of one thread
+typedef struct TraceRing {
+    // Next ring in the list of all the rings
+    struct TraceRing* next;
+    // Name and id of the thread and id of its process
+    char threadName[16];
+    long threadId;
+    // Number of events in events[], at most TRACE_RING_EVENTS
+    atomic_ulong recorded;
+    // Number of events dropped as the ring was full
+    atomic_ulong dropped;
+    TraceEvent events[TRACE_RING_EVENTS];
+} TraceRing;
+
+typedef struct {
+    // File the trace is written to
+    char* path;
+    // One line in sampleEvery is traced
+    unsigned long sampleEvery;
+    // Segment the rings are allocated from. NULL allocates them from the heap.
+    SharedSegment* segment;
+    // Process which writes the trace. Every event is shown under it, so a line keeps one slice across processes.
+    long processId;
+    unsigned long long startTime;
+    // List of the rings of all the threads
+    _Atomic(TraceRing*) rings;
+} Trace;
+
+void StartTrace(char* path, unsigned long sampleEvery, SharedSegment* segment);
+int TraceSampled(unsigned long sequence);
+void TraceRecords(TraceEventType type, char* name, Record* records, int count);
+void WriteTrace(void);
+
+#endif
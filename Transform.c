@@ -0,0 +1,310 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#include <stddef.h>
+#include <string.h>
+#include "Transform.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TRANSFORM_X86 1
+#endif
+
+// Signature shared by all implementations of a transform
+typedef void (*TransformKernel)(char* str, size_t len);
+
+// Selected implementations. The scalar ones are used until SelectTransformKernels is called.
+static TransformKernel spaceKernel = ReplaceSpaceWithAsteriskScalar;
+static TransformKernel upperKernel = ConvertLowerToUpperCaseScalar;
+static const char* kernelName = "scalar";
+// Translation table of the fused transform i.e. Munch2(Munch1(byte)) for every byte value
+static unsigned char fusedTable[256];
+// Number of bytes translated before they are compared with the original ones in ApplyFusedTransform
+#define FUSED_CHUNK_SIZE 64
+
+#ifdef TRANSFORM_X86
+// Static SIMD implementations
+static void replaceSpaceWithAsteriskSse2(char* str, size_t len);
+static void convertLowerToUpperCaseSse2(char* str, size_t len);
+static void replaceSpaceWithAsteriskAvx2(char* str, size_t len);
+static void convertLowerToUpperCaseAvx2(char* str, size_t len);
+static void replaceSpaceWithAsteriskAvx512(char* str, size_t len);
+static void convertLowerToUpperCaseAvx512(char* str, size_t len);
+#endif
+
+/**
+ * @function SelectTransformKernels
+ * @description
+ * Query the cpu features once and pick the widest implementation available.
+ * Must be called before any thread uses the transforms.
+ * */
+void SelectTransformKernels(void){
+    ComposeFusedTransformTable();
+    // Try the widest implementation first
+    if(UseTransformKernels("avx512")) return;
+    if(UseTransformKernels("avx2")) return;
+    if(UseTransformKernels("sse2")) return;
+    UseTransformKernels("scalar");
+}
+
+/**
+ * @function UseTransformKernels
+ * @argument name - Name of the implementation. One of 'scalar', 'sse2', 'avx2' or 'avx512'.
+ * @description
+ * Select the given implementation if the cpu supports it. Returns 1 on success and 0 otherwise.
+ * Must be called before any thread uses the transforms.
+ * */
+int UseTransformKernels(const char* name){
+    if(strcmp(name, "scalar") == 0){
+        spaceKernel = ReplaceSpaceWithAsteriskScalar;
+        upperKernel = ConvertLowerToUpperCaseScalar;
+        kernelName = "scalar";
+        return 1;
+    }
+#ifdef TRANSFORM_X86
+    __builtin_cpu_init();
+    if(strcmp(name, "avx512") == 0 && __builtin_cpu_supports("avx512bw")){
+        spaceKernel = replaceSpaceWithAsteriskAvx512;
+        upperKernel = convertLowerToUpperCaseAvx512;
+        kernelName = "avx512";
+        return 1;
+    }
+    if(strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")){
+        spaceKernel = replaceSpaceWithAsteriskAvx2;
+        upperKernel = convertLowerToUpperCaseAvx2;
+        kernelName = "avx2";
+        return 1;
+    }
+    if(strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")){
+        spaceKernel = replaceSpaceWithAsteriskSse2;
+        upperKernel = convertLowerToUpperCaseSse2;
+        kernelName = "sse2";
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+/**
+ * @function GetTransformKernelName
+ * @description Return the name of the selected implementation
+ * */
+const char* GetTransformKernelName(void){
+    return kernelName;
+}
+
+/**
+ * @function ReplaceSpaceWithAsterisk
+ * @argument str - The string to be processed
+ * @argument len - Length of the string
+ * @description
+ * This function converts spaces in a string to * using the selected implementation
+ * */
+void ReplaceSpaceWithAsterisk(char* str, size_t len){
+    spaceKernel(str, len);
+}
+
+/**
+ * @function ConvertLowerToUpperCase
+ * @argument str - The string to be processed
+ * @argument len - Length of the string
+ * @description
+ * This function converts a lowercase string to upper case using the selected implementation
+ * */
+void ConvertLowerToUpperCase(char* str, size_t len){
+    upperKernel(str, len);
+}
+
+/**
+ * @function ComposeFusedTransformTable
+ * @description
+ * Build the 256 entry table of the fused transform by passing every byte value through Munch1 and then Munch2.
+ * Composing the scalar functions guarantees that the fused output is identical to running both stages.
+ * */
+void ComposeFusedTransformTable(void){
+    for(int value = 0; value < 256; value++){
+        char byte = (char) value;
+        ReplaceSpaceWithAsteriskScalar(&byte, 1);
+        ConvertLowerToUpperCaseScalar(&byte, 1);
+        fusedTable[value] = (unsigned char) byte;
+    }
+}
+
+/**
+ * @function ApplyFusedTransform
+ * @argument str - The string to be processed
+ * @argument len - Length of the string
+ * @description
+ * This function applies both munch transforms in a single pass using the composed translation table.
+ * The string is translated in chunks into a local buffer and a chunk is only copied back if a byte changed, so that
+ * unchanged pages of a mapped input are never written.
+ * */
+void ApplyFusedTransform(char* str, size_t len){
+    unsigned char* bytes = (unsigned char*) str;
+    unsigned char chunk[FUSED_CHUNK_SIZE];
+    for(size_t start = 0; start < len; start += FUSED_CHUNK_SIZE){
+        size_t size = len - start < FUSED_CHUNK_SIZE ? len - start : FUSED_CHUNK_SIZE;
+        unsigned char changed = 0;
+        for(size_t index = 0; index < size; index++){
+            chunk[index] = fusedTable[bytes[start + index]];
+            changed = changed | (chunk[index] ^ bytes[start + index]);
+        }
+        if(changed) memcpy(bytes + start, chunk, size);
+    }
+}
+
+/**
+ * @function ReplaceSpaceWithAsteriskScalar
+ * @argument str - The string to be processed
+ * @argument len - Length of the string
+ * @description
+ * This function converts spaces in a string to * one byte at a time
+ * */
+void ReplaceSpaceWithAsteriskScalar(char* str, size_t len){
+    for(size_t index = 0; index < len; index++){
+        // If current character is space then change it to *
+        if(str[index] == ' ') str[index] = '*';
+    }
+}
+
+/**
+ * @function ConvertLowerToUpperCaseScalar
+ * @argument str - The string to be processed
+ * @argument len - Length of the string
+ * @description
+ * This function converts a lowercase string to upper case one byte at a time
+ * */
+void ConvertLowerToUpperCaseScalar(char* str, size_t len){
+    for(size_t index = 0; index < len; index++){
+        // If the current character is lower case then change it to upper case
+        if(str[index] >= 'a' && str[index] <= 'z') str[index] = (char) (str[index] - ('a' - 'A'));
+    }
+}
+
+#ifdef TRANSFORM_X86
+
+/**
+ * @function replaceSpaceWithAsteriskSse2
+ * @description 16 bytes per iteration. '*' - ' ' is 10, so 10 is added to every byte which equals ' '.
+ * */
+__attribute__((target("sse2")))
+static void replaceSpaceWithAsteriskSse2(char* str, size_t len){
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i delta = _mm_set1_epi8('*' - ' ');
+    size_t index = 0;
+    for(; index + 16 <= len; index += 16){
+        __m128i bytes = _mm_loadu_si128((__m128i*) (str + index));
+        __m128i mask = _mm_cmpeq_epi8(bytes, space);
+        // Chunks without a match are not written back so that unchanged pages of a mapped input stay shared
+        if(_mm_movemask_epi8(mask) == 0) continue;
+        _mm_storeu_si128((__m128i*) (str + index), _mm_add_epi8(bytes, _mm_and_si128(mask, delta)));
+    }
+    ReplaceSpaceWithAsteriskScalar(str + index, len - index);
+}
+
+/**
+ * @function convertLowerToUpperCaseSse2
+ * @description
+ * 16 bytes per iteration. Bytes are compared as signed values, so bytes >= 0x80 are negative and never in 'a'-'z'.
+ * */
+__attribute__((target("sse2")))
+static void convertLowerToUpperCaseSse2(char* str, size_t len){
+    const __m128i below = _mm_set1_epi8('a' - 1);
+    const __m128i above = _mm_set1_epi8('z' + 1);
+    const __m128i delta = _mm_set1_epi8('a' - 'A');
+    size_t index = 0;
+    for(; index + 16 <= len; index += 16){
+        __m128i bytes = _mm_loadu_si128((__m128i*) (str + index));
+        __m128i mask = _mm_and_si128(_mm_cmpgt_epi8(bytes, below), _mm_cmplt_epi8(bytes, above));
+        if(_mm_movemask_epi8(mask) == 0) continue;
+        _mm_storeu_si128((__m128i*) (str + index), _mm_sub_epi8(bytes, _mm_and_si128(mask, delta)));
+    }
+    ConvertLowerToUpperCaseScalar(str + index, len - index);
+}
+
+/**
+ * @function replaceSpaceWithAsteriskAvx2
+ * @description 32 bytes per iteration. Same approach as the SSE2 implementation.
+ * */
+__attribute__((target("avx2")))
+static void replaceSpaceWithAsteriskAvx2(char* str, size_t len){
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i delta = _mm256_set1_epi8('*' - ' ');
+    size_t index = 0;
+    for(; index + 32 <= len; index += 32){
+        __m256i bytes = _mm256_loadu_si256((__m256i*) (str + index));
+        __m256i mask = _mm256_cmpeq_epi8(bytes, space);
+        if(_mm256_movemask_epi8(mask) == 0) continue;
+        _mm256_storeu_si256((__m256i*) (str + index), _mm256_add_epi8(bytes, _mm256_and_si256(mask, delta)));
+    }
+    replaceSpaceWithAsteriskSse2(str + index, len - index);
+}
+
+/**
+ * @function convertLowerToUpperCaseAvx2
+ * @description 32 bytes per iteration. Same approach as the SSE2 implementation.
+ * */
+__attribute__((target("avx2")))
+static void convertLowerToUpperCaseAvx2(char* str, size_t len){
+    const __m256i below = _mm256_set1_epi8('a' - 1);
+    const __m256i above = _mm256_set1_epi8('z' + 1);
+    const __m256i delta = _mm256_set1_epi8('a' - 'A');
+    size_t index = 0;
+    for(; index + 32 <= len; index += 32){
+        __m256i bytes = _mm256_loadu_si256((__m256i*) (str + index));
+        __m256i mask = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, below), _mm256_cmpgt_epi8(above, bytes));
+        if(_mm256_movemask_epi8(mask) == 0) continue;
+        _mm256_storeu_si256((__m256i*) (str + index), _mm256_sub_epi8(bytes, _mm256_and_si256(mask, delta)));
+    }
+    convertLowerToUpperCaseSse2(str + index, len - index);
+}
+
+/**
+ * @function replaceSpaceWithAsteriskAvx512
+ * @description 64 bytes per iteration. The tail is handled with a masked load/store instead of the scalar loop.
+ * */
+__attribute__((target("avx512f,avx512bw")))
+static void replaceSpaceWithAsteriskAvx512(char* str, size_t len){
+    const __m512i space = _mm512_set1_epi8(' ');
+    const __m512i asterisk = _mm512_set1_epi8('*');
+    size_t index = 0;
+    for(; index + 64 <= len; index += 64){
+        __m512i bytes = _mm512_loadu_si512((void*) (str + index));
+        __mmask64 mask = _mm512_cmpeq_epi8_mask(bytes, space);
+        _mm512_mask_storeu_epi8(str + index, mask, asterisk);
+    }
+    if(index < len){
+        __mmask64 tail = (1ULL << (len - index)) - 1;
+        __m512i bytes = _mm512_maskz_loadu_epi8(tail, str + index);
+        __mmask64 mask = _mm512_mask_cmpeq_epi8_mask(tail, bytes, space);
+        _mm512_mask_storeu_epi8(str + index, mask, asterisk);
+    }
+}
+
+/**
+ * @function convertLowerToUpperCaseAvx512
+ * @description 64 bytes per iteration. Only the bytes in 'a'-'z' are written back.
+ * */
+__attribute__((target("avx512f,avx512bw")))
+static void convertLowerToUpperCaseAvx512(char* str, size_t len){
+    const __m512i lower = _mm512_set1_epi8('a');
+    const __m512i range = _mm512_set1_epi8('z' - 'a');
+    const __m512i delta = _mm512_set1_epi8('a' - 'A');
+    size_t index = 0;
+    for(; index + 64 <= len; index += 64){
+        __m512i bytes = _mm512_loadu_si512((void*) (str + index));
+        // (byte - 'a') <= 25 as an unsigned compare selects exactly 'a' to 'z'
+        __mmask64 mask = _mm512_cmple_epu8_mask(_mm512_sub_epi8(bytes, lower), range);
+        _mm512_mask_storeu_epi8(str + index, mask, _mm512_sub_epi8(bytes, delta));
+    }
+    if(index < len){
+        __mmask64 tail = (1ULL << (len - index)) - 1;
+        __m512i bytes = _mm512_maskz_loadu_epi8(tail, str + index);
+        __mmask64 mask = _mm512_mask_cmple_epu8_mask(tail, _mm512_sub_epi8(bytes, lower), range);
+        _mm512_mask_storeu_epi8(str + index, mask, _mm512_sub_epi8(bytes, delta));
+    }
+}
+
+#endif
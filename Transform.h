@@ -0,0 +1,44 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module implements the per-byte transforms applied by Munch1 and Munch2.
+ * Each transform has a scalar implementation and SSE2, AVX2 and AVX-512 implementations which process 16, 32 and 64
+ * bytes per iteration using a compare followed by a masked add/sub. The implementation is selected once at startup
+ * using cpuid (SelectTransformKernels). Until then, and on cpus without these extensions, the scalar one is used.
+ * For the fused mode, both transforms are composed into one byte translation table which is applied in a single pass.
+ *
+ * Only the ASCII letters 'a' to 'z' are converted to upper case. This is the behaviour of islower/toupper in the
+ * "C" locale which the program runs in.
+ *
+ * @functions
+ * SelectTransformKernels - Pick the fastest implementation supported by the cpu. Must be called before threads start.
+ * UseTransformKernels - Select an implementation by name if the cpu supports it. Example- 'sse2'
+ * GetTransformKernelName - Name of the selected implementation. Example- 'avx2'
+ * ReplaceSpaceWithAsterisk - Convert ' ' to '*' in the given string
+ * ConvertLowerToUpperCase - Convert 'a'-'z' to 'A'-'Z' in the given string
+ * ComposeFusedTransformTable - Compose both transforms into a single 256 entry translation table
+ * ApplyFusedTransform - Apply both transforms in one pass using the composed table
+ * ReplaceSpaceWithAsteriskScalar - Scalar implementation of ReplaceSpaceWithAsterisk
+ * ConvertLowerToUpperCaseScalar - Scalar implementation of ConvertLowerToUpperCase
+ * */
+
+#ifndef ASSIGNMENT2_TRANSFORM_H
+#define ASSIGNMENT2_TRANSFORM_H
+
+#include <stddef.h>
+
+#define TRANSFORM_MODULE "Transform"
+
+void SelectTransformKernels(void);
+int UseTransformKernels(const char* name);
+const char* GetTransformKernelName(void);
+void ReplaceSpaceWithAsterisk(char* str, size_t len);
+void ConvertLowerToUpperCase(char* str, size_t len);
+void ComposeFusedTransformTable(void);
+void ApplyFusedTransform(char* str, size_t len);
+void ReplaceSpaceWithAsteriskScalar(char* str, size_t len);
+void ConvertLowerToUpperCaseScalar(char* str, size_t len);
+
+#endif
@@ -0,0 +1,121 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ * */
+
+#include <sched.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "WaitPoint.h"
+#include "Error.h"
+
+// Static utility functions
+static void futexWait(WaitPoint* point, unsigned int expected);
+static void futexWake(WaitPoint* point, int count);
+
+/**
+ * @function InitWaitPoint
+ * @argument point - WaitPoint struct
+ * @argument processShared - If set then the WaitPoint may be used by threads of several processes
+ * @description Initialize the futex word and the number of waiters
+ * */
+void InitWaitPoint(WaitPoint* point, int processShared){
+    atomic_init(&point->sequence, 0);
+    atomic_init(&point->waiters, 0);
+    point->processShared = processShared;
+}
+
+/**
+ * @function AwaitCondition
+ * @argument point - WaitPoint signalled whenever the condition may have become true
+ * @argument policy - Length of the spin and yield phases
+ * @argument condition - Tries the operation. Returns non-zero if it succeeded.
+ * @argument context - Argument passed to the condition
+ * @description
+ * Try the condition until it succeeds- first spinning, then yielding the cpu and finally parking on the futex of the
+ * WaitPoint. Returns the phase in which the condition succeeded.
+ * */
+WaitPhase AwaitCondition(WaitPoint* point, const WaitPolicy* policy, int (*condition)(void*), void* context){
+    for(int attempt = 0; attempt < policy->spinLimit; attempt++){
+        if(condition(context)) return WAIT_PHASE_SPIN;
+        CpuRelax();
+    }
+    for(int attempt = 0; attempt < policy->yieldLimit; attempt++){
+        if(condition(context)) return WAIT_PHASE_YIELD;
+        sched_yield();
+    }
+
+    while(1){
+        // Read the futex word before registering so that a signal after this point makes the futex wait return
+        unsigned int sequence = atomic_load_explicit(&point->sequence, memory_order_acquire);
+        atomic_fetch_add_explicit(&point->waiters, 1, memory_order_relaxed);
+        // Pairs with the fence in SignalWaitPoint
+        atomic_thread_fence(memory_order_seq_cst);
+        if(condition(context)){
+            atomic_fetch_sub_explicit(&point->waiters, 1, memory_order_relaxed);
+            return WAIT_PHASE_PARK;
+        }
+        futexWait(point, sequence);
+        atomic_fetch_sub_explicit(&point->waiters, 1, memory_order_relaxed);
+        if(condition(context)) return WAIT_PHASE_PARK;
+    }
+}
+
+/**
+ * @function SignalWaitPoint
+ * @argument point - WaitPoint struct
+ * @argument count - Maximum number of parked waiters to wake up. Example- the number of permits just posted.
+ * @description
+ * Called after the condition of the waiters may have become true. Does not make a system call if no thread is
+ * registered to park, so the common path is a fence and a load.
+ * */
+void SignalWaitPoint(WaitPoint* point, int count){
+    // Pairs with the fence in AwaitCondition. Orders the update which made the condition true before the load below.
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_load_explicit(&point->waiters, memory_order_relaxed) == 0) return;
+    atomic_fetch_add_explicit(&point->sequence, 1, memory_order_release);
+    futexWake(point, count);
+}
+
+/**
+ * @function CpuRelax
+ * @description Hint the cpu that we are in a spin loop. Used by every spin of the pipeline.
+ * */
+void CpuRelax(void){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/**
+ * @function futexWait
+ * @argument point - WaitPoint struct
+ * @argument expected - Value of the futex word read before the waiter registered
+ * @description
+ * Sleep until the futex word is signalled. Returns right away if the word is no longer 'expected'.
+ * Spurious returns are fine since the caller tries the condition again.
+ * */
+static void futexWait(WaitPoint* point, unsigned int expected){
+    int operation = point->processShared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
+    long retVal = syscall(SYS_futex, &point->sequence, operation, expected, NULL, NULL, 0);
+    if(retVal != 0 && errno != EAGAIN && errno != EINTR) {
+        PrintSystemCallErrorAndExit(WAIT_POINT_MODULE, "Futex", "Wait", errno);
+    }
+}
+
+/**
+ * @function futexWake
+ * @argument point - WaitPoint struct
+ * @argument count - Maximum number of threads to wake up
+ * @description Wake up to 'count' threads sleeping on the futex word
+ * */
+static void futexWake(WaitPoint* point, int count){
+    int operation = point->processShared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
+    long retVal = syscall(SYS_futex, &point->sequence, operation, count > 0 ? count : INT_MAX, NULL, NULL, 0);
+    if(retVal < 0) PrintSystemCallErrorAndExit(WAIT_POINT_MODULE, "Futex", "Wake", errno);
+}
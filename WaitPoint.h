@@ -0,0 +1,71 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * This module implements the wait of a thread until a condition holds, e.g. until a queue has a free slot.
+ * The wait goes through three phases- a bounded spin with a pause instruction, a bounded number of sched_yield calls
+ * and finally parking on a futex. Short waits are resolved without a context switch, long waits do not burn a core.
+ * How long each phase lasts is set by a WaitPolicy, so every queue can trade cpu for latency on its own.
+ *
+ * A WaitPoint is an event count. A waiter registers itself before it checks the condition for the last time and then
+ * sleeps on the futex word unless that word changed in between. A thread which makes the condition true calls
+ * SignalWaitPoint, which only makes the futex system call if some thread is registered. Both sides use a full fence
+ * between their own update and reading the other side's, so either the waiter sees the condition or the signaller
+ * sees the waiter, and no wakeup is lost.
+ *
+ * The condition is a function which tries the operation itself (Example- take a permit or push an entry) and returns
+ * non-zero if it succeeded, so a waiter which sees the condition also makes use of it.
+ *
+ * A WaitPoint in memory shared between processes must be initialized as process-shared. Its futex is then keyed by
+ * the physical page instead of the address space, which is slightly slower, so threads of one process use a private one.
+ *
+ * @functions
+ * InitWaitPoint - Initialize a WaitPoint with no waiters, private to the process or shared between processes
+ * AwaitCondition - Wait until the condition succeeds. Returns the phase which resolved the wait.
+ * SignalWaitPoint - Wake up to a given number of parked waiters after the condition may have become true
+ * CpuRelax - Pause instruction for the body of a spin loop
+ * */
+
+#ifndef ASSIGNMENT2_WAITPOINT_H
+#define ASSIGNMENT2_WAITPOINT_H
+
+#include <stdatomic.h>
+
+#define WAIT_POINT_MODULE "WaitPoint"
+// Default number of pause iterations before a waiter starts yielding the cpu
+#define WAIT_DEFAULT_SPIN_LIMIT 128
+// Default number of sched_yield calls before a waiter parks on the futex
+#define WAIT_DEFAULT_YIELD_LIMIT 16
+
+// Phases of a wait. AwaitCondition returns the phase in which the condition succeeded.
+typedef enum {
+    WAIT_PHASE_SPIN,
+    WAIT_PHASE_YIELD,
+    WAIT_PHASE_PARK,
+    WAIT_PHASES
+} WaitPhase;
+
+// Length of the phases of a wait. A limit of 0 skips the phase, so {0, 0} parks right away like sem_wait.
+typedef struct {
+    // Number of times the condition is tried in the spin phase
+    int spinLimit;
+    // Number of times the condition is tried in the yield phase
+    int yieldLimit;
+} WaitPolicy;
+
+typedef struct {
+    // Futex word. Changed by every signal which finds a registered waiter.
+    _Alignas(64) atomic_uint sequence;
+    // Number of threads which are registered to park
+    atomic_int waiters;
+    // Set if the waiters and signallers may be in different processes
+    int processShared;
+} WaitPoint;
+
+void InitWaitPoint(WaitPoint* point, int processShared);
+WaitPhase AwaitCondition(WaitPoint* point, const WaitPolicy* policy, int (*condition)(void*), void* context);
+void SignalWaitPoint(WaitPoint* point, int count);
+void CpuRelax(void);
+
+#endif
@@ -0,0 +1,209 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * Contention benchmark of the Queue module. N producers and N consumers share a single queue, for N = 2, 4, 8, 16 and
+ * 32 (up to --max-threads), once with the locked backend (semaphores) and once with the mpmc backend (lock-free ring).
+ * Producers enqueue with EnqueueStrings and consumers dequeue with DequeueStrings, --batch records at a time. With
+ * --batch 1 every record is a separate operation, which is the worst case for both backends.
+ *
+ * Every record carries its message number as sequence. The producer stores the send time of the message and the
+ * consumer replaces it by its latency, so percentiles are exact. Once every producer is done a single end of stream
+ * record is passed from consumer to consumer, like the end of input between the workers of a stage.
+ *
+ * ns/op is the wall time divided by the number of messages and mops is millions of messages per second.
+ * Threads are not pinned. With more threads than cpus the numbers include the cost of preemption, which the lock-free
+ * ring pays when a thread is preempted between claiming a slot and publishing it.
+ *
+ * Usage- ContentionBench [--messages N] [--capacity N] [--batch N] [--max-threads N]
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <getopt.h>
+#include <stdatomic.h>
+#include "../Queue.h"
+#include "../Error.h"
+
+// Largest number of threads per side
+#define MAX_THREADS 32
+// Largest batch moved in one queue operation
+#define MAX_BATCH 256
+
+// State of one run
+typedef struct {
+    Queue* queue;
+    long messages;
+    int batch;
+    int producers;
+    // Send time of every message. The consumer stores the latency in its place.
+    unsigned long long* times;
+    // Consumers which have not received the end of stream yet
+    atomic_int activeConsumers;
+} Run;
+
+// State of a producer thread
+typedef struct {
+    Run* run;
+    int producerIndex;
+} Producer;
+
+// Static utility functions
+static void runContention(QueueType type, int threads, int capacity, long messages, int batch);
+static void* runProducer(void* ptr);
+static void* runConsumer(void* ptr);
+static int compareSamples(const void* left, const void* right);
+static unsigned long long now(void);
+
+// Record passed from consumer to consumer once every producer is done
+static const Record endOfStream = {NULL, 0, RECORD_END_OF_STREAM, 0, NULL};
+
+int main(int argc, char** argv){
+    long messages = 2000000;
+    int capacity = 1024, batch = 1, maxThreads = MAX_THREADS;
+
+    static struct option longOptions[] = {
+        {"messages", required_argument, NULL, 'm'},
+        {"capacity", required_argument, NULL, 'c'},
+        {"batch", required_argument, NULL, 'b'},
+        {"max-threads", required_argument, NULL, 't'},
+        {NULL, 0, NULL, 0}
+    };
+    int option;
+    while((option = getopt_long(argc, argv, "", longOptions, NULL)) != -1){
+        switch(option){
+            case 'm': messages = atol(optarg); break;
+            case 'c': capacity = atoi(optarg); break;
+            case 'b': batch = atoi(optarg); break;
+            case 't': maxThreads = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [--messages N] [--capacity N] [--batch N] [--max-threads N]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if(messages <= 0) messages = 2000000;
+    if(capacity <= 0) capacity = 1024;
+    if(batch <= 0) batch = 1;
+    if(batch > MAX_BATCH) batch = MAX_BATCH;
+    if(maxThreads <= 0 || maxThreads > MAX_THREADS) maxThreads = MAX_THREADS;
+
+    printf("test,backend,producers,consumers,capacity,batch,ns_per_op,mops,p50_ns,p99_ns,p99.9_ns\n");
+    QueueType types[] = {QUEUE_LOCKED, QUEUE_MPMC};
+    for(int typeIndex = 0; typeIndex < 2; typeIndex++){
+        for(int threads = 2; threads <= maxThreads; threads = threads * 2){
+            runContention(types[typeIndex], threads, capacity, messages, batch);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @function runContention
+ * @argument type - Backend of the queue
+ * @argument threads - Number of producers and of consumers
+ * @argument capacity - Capacity of the queue
+ * @argument messages - Total number of messages. Split evenly between the producers.
+ * @argument batch - Number of records moved per queue operation
+ * @description Run the producers and consumers on a single queue and print a CSV row
+ * */
+static void runContention(QueueType type, int threads, int capacity, long messages, int batch){
+    messages = messages - messages % threads;
+    Run run;
+    run.queue = CreateStringQueueOfType(capacity, "Contention", type);
+    run.messages = messages;
+    run.batch = batch;
+    run.producers = threads;
+    atomic_init(&run.activeConsumers, threads);
+    run.times = malloc(sizeof(unsigned long long) * (size_t) messages);
+    if(run.times == NULL) PrintMallocErrorAndExit("ContentionBench", "Run", "Times");
+
+    Producer producers[MAX_THREADS];
+    pthread_t producerThreads[MAX_THREADS], consumerThreads[MAX_THREADS];
+    unsigned long long start = now();
+    for(int index = 0; index < threads; index++){
+        producers[index].run = &run;
+        producers[index].producerIndex = index;
+        pthread_create(&producerThreads[index], NULL, runProducer, &producers[index]);
+        pthread_create(&consumerThreads[index], NULL, runConsumer, &run);
+    }
+    for(int index = 0; index < threads; index++) pthread_join(producerThreads[index], NULL);
+    EnqueueString(run.queue, endOfStream);
+    for(int index = 0; index < threads; index++) pthread_join(consumerThreads[index], NULL);
+    double seconds = (now() - start) / 1e9;
+
+    qsort(run.times, (size_t) messages, sizeof(unsigned long long), compareSamples);
+    printf("contention,%s,%d,%d,%d,%d,%.1f,%.2f,%llu,%llu,%llu\n", type == QUEUE_MPMC ? "mpmc" : "locked",
+           threads, threads, capacity, batch, seconds * 1e9 / messages, messages / seconds / 1e6,
+           run.times[(long) (messages * 0.50)], run.times[(long) (messages * 0.99)],
+           run.times[(long) (messages * 0.999)]);
+    fflush(stdout);
+    free(run.times);
+}
+
+/**
+ * @function runProducer
+ * @argument ptr - Producer struct
+ * @description Enqueue the messages producerIndex, producerIndex + producers, ... in batches and record their send time
+ * */
+static void* runProducer(void* ptr){
+    Producer* producer = (Producer*) ptr;
+    Run* run = producer->run;
+    Record batch[MAX_BATCH];
+    int count = 0;
+    for(long message = producer->producerIndex; message < run->messages; message = message + run->producers){
+        run->times[message] = now();
+        Record record = {NULL, 0, 0, (unsigned long) message, NULL};
+        batch[count++] = record;
+        if(count == run->batch){
+            EnqueueStrings(run->queue, batch, count);
+            count = 0;
+        }
+    }
+    EnqueueStrings(run->queue, batch, count);
+    return NULL;
+}
+
+/**
+ * @function runConsumer
+ * @argument ptr - Run struct
+ * @description
+ * Dequeue messages in batches and replace their send time by their latency until the end of stream is received.
+ * It is passed on to the next consumer unless this is the last one.
+ * */
+static void* runConsumer(void* ptr){
+    Run* run = (Run*) ptr;
+    Record batch[MAX_BATCH];
+    while(1){
+        int count = DequeueStrings(run->queue, batch, run->batch);
+        unsigned long long received = now();
+        for(int index = 0; index < count; index++){
+            if(batch[index].flags & RECORD_END_OF_STREAM){
+                if(atomic_fetch_sub(&run->activeConsumers, 1) > 1) EnqueueString(run->queue, endOfStream);
+                return NULL;
+            }
+            run->times[batch[index].sequence] = received - run->times[batch[index].sequence];
+        }
+    }
+}
+
+/**
+ * @function compareSamples
+ * @description Order two samples for qsort
+ * */
+static int compareSamples(const void* left, const void* right){
+    unsigned long long a = *(const unsigned long long*) left, b = *(const unsigned long long*) right;
+    return (a > b) - (a < b);
+}
+
+/**
+ * @function now
+ * @description Current time of CLOCK_MONOTONIC in nanoseconds
+ * */
+static unsigned long long now(void){
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (unsigned long long) time.tv_sec * 1000000000ULL + (unsigned long long) time.tv_nsec;
+}
@@ -0,0 +1,168 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * Deterministic generator of synthetic input for prodcom. The same options and seed always produce the same bytes.
+ * Line lengths follow the chosen distribution around the mean. Each character is a space, a lower case letter or some
+ * other printable character (upper case letter, digit or punctuation) with the given probabilities. A fraction of
+ * the lines is made MAX_BUFFER_SIZE to 2 * MAX_BUFFER_SIZE characters long so that prodcom skips them.
+ * The output is written to stdout.
+ *
+ * Usage- GenerateInput [options] > input
+ *   --size MB            Total size of the output (default 64)
+ *   --distribution NAME  Line length distribution- fixed, uniform (0 to 2 * mean) or exponential (default uniform)
+ *   --mean-length N      Mean length of a line (default 80)
+ *   --spaces F           Fraction of characters which are spaces (default 0.15)
+ *   --lowercase F        Fraction of characters which are lower case letters (default 0.6)
+ *   --overlong F         Fraction of lines which are too long for prodcom (default 0)
+ *   --seed N             Seed of the random generator (default 537)
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include "../Threads.h"
+
+// Characters used for the bytes which are neither a space nor a lower case letter
+static const char otherCharacters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789.,;:!?-_=+*/()[]{}<>#@$%&";
+
+// State of the xorshift64* generator
+static unsigned long long randomState;
+
+// Static utility functions
+static unsigned long long nextRandom(void);
+static double nextUniform(void);
+static long nextLength(const char* distribution, long meanLength);
+static double parseFraction(const char* value);
+static void printUsageAndExit(char* programName);
+
+int main(int argc, char** argv){
+    long megaBytes = 64, meanLength = 80;
+    const char* distribution = "uniform";
+    double spaces = 0.15, lowercase = 0.6, overlong = 0.0;
+    unsigned long long seed = 537;
+
+    static struct option longOptions[] = {
+        {"size", required_argument, NULL, 's'},
+        {"distribution", required_argument, NULL, 'd'},
+        {"mean-length", required_argument, NULL, 'm'},
+        {"spaces", required_argument, NULL, 'p'},
+        {"lowercase", required_argument, NULL, 'l'},
+        {"overlong", required_argument, NULL, 'o'},
+        {"seed", required_argument, NULL, 'r'},
+        {NULL, 0, NULL, 0}
+    };
+    int option;
+    while((option = getopt_long(argc, argv, "", longOptions, NULL)) != -1){
+        switch(option){
+            case 's': megaBytes = atol(optarg); break;
+            case 'd': distribution = optarg; break;
+            case 'm': meanLength = atol(optarg); break;
+            case 'p': spaces = parseFraction(optarg); break;
+            case 'l': lowercase = parseFraction(optarg); break;
+            case 'o': overlong = parseFraction(optarg); break;
+            case 'r': seed = strtoull(optarg, NULL, 10); break;
+            default: printUsageAndExit(argv[0]);
+        }
+    }
+    if(megaBytes <= 0 || meanLength < 0 || spaces + lowercase > 1.0) printUsageAndExit(argv[0]);
+    if(strcmp(distribution, "fixed") != 0 && strcmp(distribution, "uniform") != 0 &&
+       strcmp(distribution, "exponential") != 0) printUsageAndExit(argv[0]);
+
+    // xorshift must not start from 0
+    randomState = seed * 2654435761ULL + 1;
+
+    long long remaining = (long long) megaBytes * 1024 * 1024;
+    char* line = malloc(2 * MAX_BUFFER_SIZE + 1);
+    if(line == NULL) return EXIT_FAILURE;
+    int otherCount = (int) strlen(otherCharacters);
+
+    while(remaining > 0){
+        long length = nextUniform() < overlong ? MAX_BUFFER_SIZE + (long) (nextRandom() % MAX_BUFFER_SIZE)
+                                               : nextLength(distribution, meanLength);
+        if(length + 1 > remaining) length = (long) remaining - 1;
+
+        for(long index = 0; index < length; index++){
+            double pick = nextUniform();
+            if(pick < spaces){
+                line[index] = ' ';
+            } else if(pick < spaces + lowercase){
+                line[index] = (char) ('a' + nextRandom() % 26);
+            } else {
+                line[index] = otherCharacters[nextRandom() % (unsigned long long) otherCount];
+            }
+        }
+        line[length] = '\n';
+        if(fwrite(line, 1, (size_t) length + 1, stdout) != (size_t) length + 1) return EXIT_FAILURE;
+        remaining = remaining - (length + 1);
+    }
+
+    free(line);
+    return fflush(stdout) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @function nextRandom
+ * @description Return the next value of the xorshift64* generator
+ * */
+static unsigned long long nextRandom(void){
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return randomState * 2685821657736338717ULL;
+}
+
+/**
+ * @function nextUniform
+ * @description Return a value uniformly distributed in [0, 1)
+ * */
+static double nextUniform(void){
+    return (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @function nextLength
+ * @argument distribution - fixed, uniform or exponential
+ * @argument meanLength - Mean length of a line
+ * @description Return the length of the next line. It is always shorter than MAX_BUFFER_SIZE.
+ * */
+static long nextLength(const char* distribution, long meanLength){
+    long length;
+    if(strcmp(distribution, "fixed") == 0){
+        length = meanLength;
+    } else if(strcmp(distribution, "uniform") == 0){
+        length = (long) (nextUniform() * (2 * meanLength + 1));
+    } else {
+        length = (long) (-log(1.0 - nextUniform()) * meanLength);
+    }
+    return length < MAX_BUFFER_SIZE ? length : MAX_BUFFER_SIZE - 1;
+}
+
+/**
+ * @function parseFraction
+ * @argument value - Value of the option
+ * @description Convert the value to a number in [0, 1]. Exits with failure code if it is not one.
+ * */
+static double parseFraction(const char* value){
+    char* end;
+    double fraction = strtod(value, &end);
+    if(*value == '\0' || *end != '\0' || fraction < 0.0 || fraction > 1.0){
+        fprintf(stderr, "'%s' is not a fraction between 0 and 1\n", value);
+        exit(EXIT_FAILURE);
+    }
+    return fraction;
+}
+
+/**
+ * @function printUsageAndExit
+ * @argument programName - Name with which the program was started
+ * @description Print the usage on stderr and exit with failure code
+ * */
+static void printUsageAndExit(char* programName){
+    fprintf(stderr, "Usage: %s [--size MB] [--distribution fixed|uniform|exponential] [--mean-length N]\n", programName);
+    fprintf(stderr, "       [--spaces F] [--lowercase F] [--overlong F] [--seed N] > input\n");
+    exit(EXIT_FAILURE);
+}
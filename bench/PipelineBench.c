@@ -0,0 +1,136 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * End-to-end benchmark of prodcom. Runs prodcom once with the given input file on stdin and the given options and
+ * prints one CSV row with the throughput and resource usage of the run.
+ * The output of prodcom is read through a pipe and discarded. The number of lines is taken from the
+ * "Writer processed N strings!" line at its end. Wall time is measured with CLOCK_MONOTONIC and the peak RSS and cpu
+ * time are taken from wait4. Cpu utilization is the cpu time divided by the wall time, so it exceeds 100% when more
+ * than one core is busy.
+ *
+ * Usage- PipelineBench --header
+ *        PipelineBench <prodcom> <input file> <input label> [prodcom options...]
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+// Number of bytes kept from the end of the output of prodcom
+#define TAIL_SIZE 256
+
+// Static utility functions
+static double now(void);
+
+int main(int argc, char** argv){
+    if(argc == 2 && strcmp(argv[1], "--header") == 0){
+        printf("input,options,lines,seconds,lines_per_s,mb_per_s,peak_rss_kb,cpu_percent\n");
+        return EXIT_SUCCESS;
+    }
+    if(argc < 4){
+        fprintf(stderr, "Usage: %s <prodcom> <input file> <input label> [prodcom options...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    struct stat status;
+    int input = open(argv[2], O_RDONLY);
+    if(input < 0 || fstat(input, &status) != 0){
+        perror(argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    int output[2];
+    if(pipe(output) != 0){
+        perror("pipe");
+        return EXIT_FAILURE;
+    }
+
+    // prodcom is started as: prodcom [options...] < input > pipe 2> /dev/null
+    char** arguments = malloc(sizeof(char*) * (size_t) (argc - 2));
+    arguments[0] = argv[1];
+    for(int index = 4; index < argc; index++) arguments[index - 3] = argv[index];
+    arguments[argc - 3] = NULL;
+
+    double start = now();
+    pid_t pid = fork();
+    if(pid < 0){
+        perror("fork");
+        return EXIT_FAILURE;
+    }
+    if(pid == 0){
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(input, STDIN_FILENO);
+        dup2(output[1], STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+        close(output[0]);
+        execv(argv[1], arguments);
+        _exit(127);
+    }
+    close(output[1]);
+    close(input);
+
+    // Drain the output and keep its last bytes
+    static char block[256 * 1024];
+    char tail[TAIL_SIZE + 1];
+    size_t tailLength = 0;
+    ssize_t bytesRead;
+    while((bytesRead = read(output[0], block, sizeof(block))) > 0){
+        if((size_t) bytesRead >= TAIL_SIZE){
+            memcpy(tail, block + bytesRead - TAIL_SIZE, TAIL_SIZE);
+            tailLength = TAIL_SIZE;
+        } else {
+            size_t keep = tailLength + (size_t) bytesRead > TAIL_SIZE ? TAIL_SIZE - (size_t) bytesRead : tailLength;
+            memmove(tail, tail + tailLength - keep, keep);
+            memcpy(tail + keep, block, (size_t) bytesRead);
+            tailLength = keep + (size_t) bytesRead;
+        }
+    }
+    close(output[0]);
+
+    int exitStatus;
+    struct rusage usage;
+    if(wait4(pid, &exitStatus, 0, &usage) < 0){
+        perror("wait4");
+        return EXIT_FAILURE;
+    }
+    double seconds = now() - start;
+    if(!WIFEXITED(exitStatus) || WEXITSTATUS(exitStatus) != 0){
+        fprintf(stderr, "%s failed on %s\n", argv[1], argv[3]);
+        return EXIT_FAILURE;
+    }
+
+    tail[tailLength] = '\0';
+    char* summary = strstr(tail, "Writer processed ");
+    long lines = summary != NULL ? atol(summary + strlen("Writer processed ")) : -1;
+
+    double cpuSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+                        usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    char options[1024] = "";
+    for(int index = 4; index < argc; index++){
+        if(index > 4) strncat(options, " ", sizeof(options) - strlen(options) - 1);
+        strncat(options, argv[index], sizeof(options) - strlen(options) - 1);
+    }
+
+    printf("%s,\"%s\",%ld,%.3f,%.0f,%.1f,%ld,%.0f\n", argv[3], options, lines, seconds, lines / seconds,
+           status.st_size / (1024.0 * 1024.0) / seconds, usage.ru_maxrss, 100.0 * cpuSeconds / seconds);
+    free(arguments);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @function now
+ * @description Current time of CLOCK_MONOTONIC in seconds
+ * */
+static double now(void){
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
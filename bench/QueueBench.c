@@ -0,0 +1,396 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * Micro benchmark of the Queue module on its own, without the Reader/Munch/Writer pipeline.
+ * Every test is run for every backend (locked i.e. semaphores, spsc i.e. the lock-free ring and mpmc i.e. the
+ * multi-producer ring with a single thread per side) and for every capacity. See ContentionBench for several threads.
+ * Records are moved one at a time with EnqueueString/DequeueString. Each record carries its message number as sequence.
+ *
+ * throughput - One producer saturates a single queue and one consumer drains it.
+ * pingpong   - Two threads bounce a single string over a pair of queues. Measures the round trip.
+ * chainN     - A source, N - 1 forwarding threads and a sink connected by N queues, like the stages of the pipeline.
+ *
+ * ns/op is the wall time divided by the number of strings (by the number of one way hops for pingpong).
+ * Percentiles are exact, computed from every sample- the time from enqueue in the source to dequeue in the sink for
+ * throughput and chains, the round trip time for pingpong.
+ *
+ * Threads are pinned according to the placement-
+ * none   - Not pinned
+ * same   - Every thread on the same cpu
+ * smt    - Threads alternate between two SMT siblings of the same core
+ * socket - Threads alternate between two cpus on different sockets
+ * The topology is read from /sys/devices/system/cpu. A placement which the machine cannot provide is skipped.
+ *
+ * Usage- QueueBench [--messages N] [--placement none|same|smt|socket] [--capacities "1 4 16 ..."]
+ * */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <getopt.h>
+#include <unistd.h>
+#include "../Queue.h"
+#include "../Error.h"
+
+// Capacities used when none are given
+#define DEFAULT_CAPACITIES "1 4 16 64 256 1024 4096"
+// Longest chain of queues
+#define MAX_CHAIN 8
+// Maximum number of capacities
+#define MAX_CAPACITIES 32
+
+// Settings shared by every test
+typedef struct {
+    long messages;
+    const char* placement;
+    // Cpus the threads are pinned to in turn. cpuCount is 0 if the threads are not pinned.
+    int cpus[2];
+    int cpuCount;
+} Settings;
+
+// State of a thread of a chain
+typedef struct {
+    Settings* settings;
+    int threadIndex;
+    Queue* input;
+    Queue* output;
+    // Time at which each string was enqueued by the source. The sink stores the latency in its place.
+    unsigned long long* times;
+} Stage;
+
+// Static utility functions
+static void runChain(Settings* settings, QueueType type, int capacity, int length, const char* name);
+static void runPingPong(Settings* settings, QueueType type, int capacity);
+static void* runSource(void* ptr);
+static void* runForwarder(void* ptr);
+static void* runSink(void* ptr);
+static void* runPingPongPeer(void* ptr);
+static void pinThread(Settings* settings, int threadIndex);
+static int choosePlacement(Settings* settings);
+static int readCpuList(int cpu, const char* file, int* first, int* second);
+static int readPackage(int cpu);
+static void printRow(const char* test, QueueType type, int capacity, Settings* settings, double seconds,
+                     long hops, unsigned long long* samples, long count);
+static int compareSamples(const void* left, const void* right);
+static unsigned long long now(void);
+
+int main(int argc, char** argv){
+    Settings settings = {100000, "same", {0, 0}, 0};
+    const char* capacityList = DEFAULT_CAPACITIES;
+
+    static struct option longOptions[] = {
+        {"messages", required_argument, NULL, 'm'},
+        {"placement", required_argument, NULL, 'p'},
+        {"capacities", required_argument, NULL, 'c'},
+        {NULL, 0, NULL, 0}
+    };
+    int option;
+    while((option = getopt_long(argc, argv, "", longOptions, NULL)) != -1){
+        switch(option){
+            case 'm': settings.messages = atol(optarg); break;
+            case 'p': settings.placement = optarg; break;
+            case 'c': capacityList = optarg; break;
+            default:
+                fprintf(stderr, "Usage: %s [--messages N] [--placement none|same|smt|socket] [--capacities \"1 4 16\"]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if(settings.messages <= 0) settings.messages = 100000;
+    if(!choosePlacement(&settings)) return EXIT_SUCCESS;
+
+    int capacities[MAX_CAPACITIES], capacityCount = 0;
+    char* list = strdup(capacityList);
+    for(char* token = strtok(list, " ,"); token != NULL && capacityCount < MAX_CAPACITIES; token = strtok(NULL, " ,")){
+        if(atoi(token) > 0) capacities[capacityCount++] = atoi(token);
+    }
+    free(list);
+
+    printf("test,backend,capacity,placement,ns_per_op,p50_ns,p99_ns,p99.9_ns\n");
+    QueueType types[] = {QUEUE_LOCKED, QUEUE_SPSC, QUEUE_MPMC};
+    for(int typeIndex = 0; typeIndex < 3; typeIndex++){
+        for(int index = 0; index < capacityCount; index++){
+            runChain(&settings, types[typeIndex], capacities[index], 1, "throughput");
+            runPingPong(&settings, types[typeIndex], capacities[index]);
+            for(int length = 3; length <= MAX_CHAIN; length++){
+                char name[16];
+                snprintf(name, sizeof(name), "chain%d", length);
+                runChain(&settings, types[typeIndex], capacities[index], length, name);
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @function runChain
+ * @argument settings - Settings of the benchmark
+ * @argument type - Backend of the queues
+ * @argument capacity - Capacity of every queue
+ * @argument length - Number of queues. 1 is the plain producer/consumer throughput test.
+ * @argument name - Name of the test in the output
+ * @description Run a source, length - 1 forwarders and a sink connected by length queues and print the result
+ * */
+static void runChain(Settings* settings, QueueType type, int capacity, int length, const char* name){
+    Queue* queues[MAX_CHAIN];
+    for(int index = 0; index < length; index++) queues[index] = CreateStringQueueOfType(capacity, "Bench", type);
+    unsigned long long* times = malloc(sizeof(unsigned long long) * (size_t) settings->messages);
+    if(times == NULL) PrintMallocErrorAndExit("QueueBench", "Chain", "Times");
+
+    Stage stages[MAX_CHAIN + 1];
+    pthread_t threads[MAX_CHAIN + 1];
+    for(int index = 0; index <= length; index++){
+        stages[index].settings = settings;
+        stages[index].threadIndex = index;
+        stages[index].input = index > 0 ? queues[index - 1] : NULL;
+        stages[index].output = index < length ? queues[index] : NULL;
+        stages[index].times = times;
+    }
+
+    unsigned long long start = now();
+    pthread_create(&threads[0], NULL, runSource, &stages[0]);
+    for(int index = 1; index < length; index++) pthread_create(&threads[index], NULL, runForwarder, &stages[index]);
+    pthread_create(&threads[length], NULL, runSink, &stages[length]);
+    for(int index = 0; index <= length; index++) pthread_join(threads[index], NULL);
+    double seconds = (now() - start) / 1e9;
+
+    printRow(name, type, capacity, settings, seconds, settings->messages, times, settings->messages);
+    free(times);
+}
+
+/**
+ * @function runPingPong
+ * @argument settings - Settings of the benchmark
+ * @argument type - Backend of the queues
+ * @argument capacity - Capacity of both queues
+ * @description Bounce a string between two threads over two queues and print the round trip times
+ * */
+static void runPingPong(Settings* settings, QueueType type, int capacity){
+    Queue* ping = CreateStringQueueOfType(capacity, "Ping", type);
+    Queue* pong = CreateStringQueueOfType(capacity, "Pong", type);
+    unsigned long long* times = malloc(sizeof(unsigned long long) * (size_t) settings->messages);
+    if(times == NULL) PrintMallocErrorAndExit("QueueBench", "PingPong", "Times");
+
+    Stage peer = {settings, 1, ping, pong, NULL};
+    pthread_t thread;
+    pthread_create(&thread, NULL, runPingPongPeer, &peer);
+    pinThread(settings, 0);
+
+    unsigned long long start = now();
+    for(long index = 0; index < settings->messages; index++){
+        unsigned long long sent = now();
+        Record record = {NULL, 0, 0, (unsigned long) index, NULL};
+        EnqueueString(ping, record);
+        DequeueString(pong);
+        times[index] = now() - sent;
+    }
+    double seconds = (now() - start) / 1e9;
+    pthread_join(thread, NULL);
+
+    // Every round trip is two one way hops
+    printRow("pingpong", type, capacity, settings, seconds, 2 * settings->messages, times, settings->messages);
+    free(times);
+}
+
+/**
+ * @function runSource
+ * @argument ptr - Stage struct
+ * @description Enqueue the sequence numbers 0 to messages - 1 and record when each one was sent
+ * */
+static void* runSource(void* ptr){
+    Stage* stage = (Stage*) ptr;
+    pinThread(stage->settings, stage->threadIndex);
+    for(long index = 0; index < stage->settings->messages; index++){
+        stage->times[index] = now();
+        Record record = {NULL, 0, 0, (unsigned long) index, NULL};
+        EnqueueString(stage->output, record);
+    }
+    return NULL;
+}
+
+/**
+ * @function runForwarder
+ * @argument ptr - Stage struct
+ * @description Move every string from the input queue to the output queue
+ * */
+static void* runForwarder(void* ptr){
+    Stage* stage = (Stage*) ptr;
+    pinThread(stage->settings, stage->threadIndex);
+    for(long index = 0; index < stage->settings->messages; index++){
+        EnqueueString(stage->output, DequeueString(stage->input));
+    }
+    return NULL;
+}
+
+/**
+ * @function runSink
+ * @argument ptr - Stage struct
+ * @description Dequeue every string and replace its send time by its latency
+ * */
+static void* runSink(void* ptr){
+    Stage* stage = (Stage*) ptr;
+    pinThread(stage->settings, stage->threadIndex);
+    for(long index = 0; index < stage->settings->messages; index++){
+        long sequence = (long) DequeueString(stage->input).sequence;
+        stage->times[sequence] = now() - stage->times[sequence];
+    }
+    return NULL;
+}
+
+/**
+ * @function runPingPongPeer
+ * @argument ptr - Stage struct. input is the ping queue and output is the pong queue.
+ * @description Return every string received on the ping queue on the pong queue
+ * */
+static void* runPingPongPeer(void* ptr){
+    Stage* stage = (Stage*) ptr;
+    pinThread(stage->settings, stage->threadIndex);
+    for(long index = 0; index < stage->settings->messages; index++){
+        EnqueueString(stage->output, DequeueString(stage->input));
+    }
+    return NULL;
+}
+
+/**
+ * @function pinThread
+ * @argument settings - Settings of the benchmark
+ * @argument threadIndex - Index of the thread in its test
+ * @description Pin the calling thread to the cpu chosen for its index. Does nothing if threads are not pinned.
+ * */
+static void pinThread(Settings* settings, int threadIndex){
+    if(settings->cpuCount == 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(settings->cpus[threadIndex % settings->cpuCount], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/**
+ * @function choosePlacement
+ * @argument settings - Settings of the benchmark. cpus and cpuCount are set.
+ * @description
+ * Pick the cpus for the placement starting from the first cpu the process may run on.
+ * Returns 0 and prints why on stderr if the machine does not have the required topology.
+ * */
+static int choosePlacement(Settings* settings){
+    cpu_set_t allowed;
+    int base = 0;
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) == 0){
+        while(base < CPU_SETSIZE && !CPU_ISSET(base, &allowed)) base++;
+    }
+
+    if(strcmp(settings->placement, "none") == 0){
+        settings->cpuCount = 0;
+        return 1;
+    }
+    if(strcmp(settings->placement, "same") == 0){
+        settings->cpus[0] = base;
+        settings->cpuCount = 1;
+        return 1;
+    }
+    if(strcmp(settings->placement, "smt") == 0){
+        int first, second;
+        if(readCpuList(base, "thread_siblings_list", &first, &second) < 2){
+            fprintf(stderr, "Skipping placement smt- cpu %d has no SMT sibling\n", base);
+            return 0;
+        }
+        settings->cpus[0] = first;
+        settings->cpus[1] = second;
+        settings->cpuCount = 2;
+        return 1;
+    }
+    if(strcmp(settings->placement, "socket") == 0){
+        int package = readPackage(base);
+        long configured = sysconf(_SC_NPROCESSORS_CONF);
+        for(int cpu = 0; cpu < configured; cpu++){
+            if(CPU_ISSET(cpu, &allowed) && readPackage(cpu) >= 0 && readPackage(cpu) != package){
+                settings->cpus[0] = base;
+                settings->cpus[1] = cpu;
+                settings->cpuCount = 2;
+                return 1;
+            }
+        }
+        fprintf(stderr, "Skipping placement socket- only one socket is available\n");
+        return 0;
+    }
+    fprintf(stderr, "Unknown placement %s\n", settings->placement);
+    return 0;
+}
+
+/**
+ * @function readCpuList
+ * @argument cpu - Cpu whose topology is read
+ * @argument file - Name of the list in /sys/devices/system/cpu/cpuN/topology. Example- thread_siblings_list
+ * @argument first - Set to the first cpu of the list
+ * @argument second - Set to the second cpu of the list
+ * @description Read a cpu list such as "0,4" or "0-1" and return the number of cpus read (at most 2)
+ * */
+static int readCpuList(int cpu, const char* file, int* first, int* second){
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, file);
+    FILE* list = fopen(path, "r");
+    if(list == NULL) return 0;
+    char separator;
+    int read = fscanf(list, "%d%c%d", first, &separator, second);
+    fclose(list);
+    if(read == 3 && (separator == ',' || separator == '-')){
+        // For a range, the second cpu is the one right after the first
+        if(separator == '-') *second = *first + 1;
+        return 2;
+    }
+    return read >= 1 ? 1 : 0;
+}
+
+/**
+ * @function readPackage
+ * @argument cpu - Cpu whose topology is read
+ * @description Return the physical package (socket) of the cpu or -1 if it is unknown
+ * */
+static int readPackage(int cpu){
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+    FILE* file = fopen(path, "r");
+    if(file == NULL) return -1;
+    int package = -1;
+    if(fscanf(file, "%d", &package) != 1) package = -1;
+    fclose(file);
+    return package;
+}
+
+/**
+ * @function printRow
+ * @description Print a CSV row with ns/op and the percentiles of the samples. The samples are sorted in place.
+ * */
+static void printRow(const char* test, QueueType type, int capacity, Settings* settings, double seconds,
+                     long hops, unsigned long long* samples, long count){
+    qsort(samples, (size_t) count, sizeof(unsigned long long), compareSamples);
+    const char* backend = type == QUEUE_SPSC ? "spsc" : type == QUEUE_MPMC ? "mpmc" : "locked";
+    printf("%s,%s,%d,%s,%.1f,%llu,%llu,%llu\n", test, backend, capacity,
+           settings->placement, seconds * 1e9 / hops,
+           samples[(long) (count * 0.50)], samples[(long) (count * 0.99)], samples[(long) (count * 0.999)]);
+    fflush(stdout);
+}
+
+/**
+ * @function compareSamples
+ * @description Order two samples for qsort
+ * */
+static int compareSamples(const void* left, const void* right){
+    unsigned long long a = *(const unsigned long long*) left, b = *(const unsigned long long*) right;
+    return (a > b) - (a < b);
+}
+
+/**
+ * @function now
+ * @description Current time of CLOCK_MONOTONIC in nanoseconds
+ * */
+static unsigned long long now(void){
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (unsigned long long) time.tv_sec * 1000000000ULL + (unsigned long long) time.tv_nsec;
+}
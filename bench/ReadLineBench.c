@@ -0,0 +1,179 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * Benchmark comparing the original fgetc based readLine with the block based LineReader module.
+ * The LineReader is run four times- copying every line (ReadLine), returning lines in place (ReadLineView),
+ * returning lines in place from a mapping of the file and returning lines in place from blocks read with io_uring.
+ * A temporary input file is generated and then every reader splits it into lines. Each reader is timed using
+ * CLOCK_MONOTONIC and the throughput is reported in GB/s. Both readers use MAX_BUFFER_SIZE as their max line length.
+ *
+ * Usage- ReadLineBench [size in MB, default 256]
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../LineReader.h"
+#include "../Threads.h"
+
+// Static utility functions
+static char* generateInput(long totalBytes);
+static long legacyRead(char* path, long* lines);
+static long blockRead(char* path, long* lines, int mapInput, int view, int async);
+static double now(void);
+
+int main(int argc, char** argv){
+    long megaBytes = argc > 1 ? atol(argv[1]) : 256;
+    if(megaBytes <= 0) megaBytes = 256;
+
+    char* path = generateInput(megaBytes * 1024 * 1024);
+    long legacyLines = 0, blockLines = 0;
+
+    // Run the legacy reader first so that both runs read the file from the page cache
+    double start = now();
+    long legacyBytes = legacyRead(path, &legacyLines);
+    double legacyTime = now() - start;
+
+    printf("reader,lines,seconds,GB/s\n");
+    printf("fgetc,%ld,%.3f,%.3f\n", legacyLines, legacyTime, (megaBytes / 1024.0) / legacyTime);
+
+    // Name, mapInput, view and async flag of each LineReader run
+    const char* names[] = {"block", "view", "mmap", "uring"};
+    int mapInputs[] = {0, 0, 1, 0};
+    int views[] = {0, 1, 1, 1};
+    int asyncs[] = {0, 0, 0, 1};
+    for(int run = 0; run < 4; run++){
+        blockLines = 0;
+        start = now();
+        long blockBytes = blockRead(path, &blockLines, mapInputs[run], views[run], asyncs[run]);
+        double blockTime = now() - start;
+
+        if(legacyLines != blockLines || legacyBytes != blockBytes){
+            fprintf(stderr, "Readers disagree! fgetc: %ld lines %ld bytes, %s: %ld lines %ld bytes\n",
+                    legacyLines, legacyBytes, names[run], blockLines, blockBytes);
+            unlink(path);
+            return EXIT_FAILURE;
+        }
+        printf("%s,%ld,%.3f,%.3f\n", names[run], blockLines, blockTime, (megaBytes / 1024.0) / blockTime);
+    }
+
+    unlink(path);
+    free(path);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @function generateInput
+ * @argument totalBytes - Size of the file to be generated
+ * @description Write a temporary file with lines of random length (a few of them longer than MAX_BUFFER_SIZE)
+ * */
+static char* generateInput(long totalBytes){
+    char* path = strdup("/tmp/readline-bench-XXXXXX");
+    int fd = mkstemp(path);
+    if(fd < 0){
+        perror("mkstemp");
+        exit(EXIT_FAILURE);
+    }
+    FILE* file = fdopen(fd, "w");
+    srand(537);
+
+    long written = 0;
+    while(written < totalBytes){
+        // One in thousand lines is long enough to be skipped
+        int length = rand() % 1000 == 0 ? MAX_BUFFER_SIZE + rand() % 100 : rand() % 160;
+        for(int index = 0; index < length; index++){
+            fputc(index % 7 == 0 ? ' ' : 'a' + rand() % 26, file);
+        }
+        fputc('\n', file);
+        written = written + length + 1;
+    }
+    fclose(file);
+    return path;
+}
+
+/**
+ * @function legacyRead
+ * @argument path - Input file
+ * @argument lines - Set to the number of lines returned
+ * @description Split the input exactly the way the original readLine did i.e. one fgetc per character
+ * */
+static long legacyRead(char* path, long* lines){
+    FILE* file = fopen(path, "r");
+    char* buffer = malloc(MAX_BUFFER_SIZE);
+    long bytes = 0;
+    int len = 0, ch;
+    while((ch = fgetc(file)) != EOF){
+        if(ch == '\n'){
+            if(len < MAX_BUFFER_SIZE){
+                *lines = *lines + 1;
+                bytes = bytes + len;
+            }
+            len = 0;
+        } else if(len < MAX_BUFFER_SIZE){
+            buffer[len++] = (char) ch;
+        } else {
+            len = MAX_BUFFER_SIZE;
+        }
+    }
+    free(buffer);
+    fclose(file);
+    return bytes;
+}
+
+/**
+ * @function blockRead
+ * @argument path - Input file
+ * @argument lines - Set to the number of lines returned
+ * @argument mapInput - Map the file instead of reading it in blocks
+ * @argument view - Use ReadLineView instead of ReadLine
+ * @argument async - Read the blocks with io_uring. Falls back to read(2) if it is not available.
+ * @description Split the input using the LineReader module
+ * */
+static long blockRead(char* path, long* lines, int mapInput, int view, int async){
+    int fd = open(path, O_RDONLY);
+    LineReader* lineReader = async ? CreateAsyncLineReader(fd, MAX_BUFFER_SIZE) : NULL;
+    if(lineReader == NULL) lineReader = CreateLineReader(fd, MAX_BUFFER_SIZE, mapInput);
+    char* buffer = malloc(MAX_BUFFER_SIZE);
+    char* line;
+    int response[2];
+    long bytes = 0;
+
+    // The skipped line warnings are not part of the measurement
+    int savedStderr = dup(STDERR_FILENO);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDERR_FILENO);
+    while(1){
+        if(view){
+            ReadLineView(lineReader, buffer, &line, response);
+        } else {
+            ReadLine(lineReader, buffer, response);
+        }
+        if(response[0] == LINE_OK || response[0] == LINE_EOF_WITH_DATA){
+            *lines = *lines + 1;
+            bytes = bytes + response[1];
+        }
+        if(response[0] != LINE_OK && response[0] != LINE_OVERFLOW) break;
+    }
+    dup2(savedStderr, STDERR_FILENO);
+    close(devNull);
+    close(savedStderr);
+
+    free(buffer);
+    close(fd);
+    return bytes;
+}
+
+/**
+ * @function now
+ * @description Current time of CLOCK_MONOTONIC in seconds
+ * */
+static double now(void){
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
@@ -0,0 +1,151 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * Benchmark for the implementations of the munch transforms in the Transform module.
+ * Every implementation supported by the cpu is first checked against the byte loops of the original Munch1 and Munch2
+ * (ch == ' ', and islower/toupper in the C locale) on all byte values, all lengths up to 300 and all alignments within
+ * a 64 byte line. Each transform is checked on its own, so a change one transform makes which the other would undo is
+ * caught as well. It is then timed on a large buffer and the throughput is reported in GB/s. The program fails if any
+ * implementation disagrees with the original loops.
+ *
+ * Usage- TransformBench [size in MB, default 64]
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "../Transform.h"
+
+// Static utility functions
+static int verify(const char* name);
+static int verifyTransform(const char* name, const char* transformName, void (*transform)(char*, size_t),
+                           void (*reference)(char*, size_t));
+static void replaceSpaceReference(char* str, size_t len);
+static void convertLowerReference(char* str, size_t len);
+static double measure(void (*transform)(char*, size_t), char* buffer, char* source, size_t size);
+static double now(void);
+
+int main(int argc, char** argv){
+    long megaBytes = argc > 1 ? atol(argv[1]) : 64;
+    if(megaBytes <= 0) megaBytes = 64;
+    size_t size = (size_t) megaBytes * 1024 * 1024;
+
+    // Input resembling log lines- mostly lower case letters with some spaces and punctuation
+    char* source = malloc(size);
+    char* buffer = malloc(size);
+    srand(537);
+    for(size_t index = 0; index < size; index++){
+        int pick = rand() % 10;
+        source[index] = pick == 0 ? ' ' : (pick == 1 ? (char) (rand() % 256) : (char) ('a' + rand() % 26));
+    }
+
+    const char* names[] = {"scalar", "sse2", "avx2", "avx512"};
+    printf("kernel,space GB/s,upper GB/s\n");
+    for(int index = 0; index < 4; index++){
+        if(!UseTransformKernels(names[index])) continue;
+        if(!verify(names[index])) return EXIT_FAILURE;
+        double space = measure(ReplaceSpaceWithAsterisk, buffer, source, size);
+        double upper = measure(ConvertLowerToUpperCase, buffer, source, size);
+        printf("%s,%.2f,%.2f\n", names[index], size / space / 1e9, size / upper / 1e9);
+    }
+
+    free(source);
+    free(buffer);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @function verify
+ * @argument name - Name of the selected implementation
+ * @description Compare both transforms of the selected implementation with the original loops. Returns 1 if they agree.
+ * */
+static int verify(const char* name){
+    return verifyTransform(name, "ReplaceSpaceWithAsterisk", ReplaceSpaceWithAsterisk, replaceSpaceReference) &&
+           verifyTransform(name, "ConvertLowerToUpperCase", ConvertLowerToUpperCase, convertLowerReference);
+}
+
+/**
+ * @function verifyTransform
+ * @argument name - Name of the selected implementation
+ * @argument transformName - Name of the transform. Used for the message.
+ * @argument transform - Transform of the selected implementation
+ * @argument reference - Original loop of the transform
+ * @description
+ * Run the transform and its reference on every offset and length of a buffer which holds all 256 byte values.
+ * Returns 1 if they agree, including on the bytes outside the transformed range.
+ * */
+static int verifyTransform(const char* name, const char* transformName, void (*transform)(char*, size_t),
+                           void (*reference)(char*, size_t)){
+    char input[512], expected[512], actual[512];
+    // 7 is odd, so every 256 consecutive indices hold each byte value once
+    for(int index = 0; index < 512; index++) input[index] = (char) (index * 7 + index / 256);
+
+    for(int offset = 0; offset < 64; offset++){
+        for(size_t len = 0; len <= 300; len++){
+            // Fill the whole buffer so that writes outside [offset, offset + len) are detected as well
+            memcpy(expected, input, sizeof(input));
+            memcpy(actual, input, sizeof(input));
+            reference(expected + offset, len);
+            transform(actual + offset, len);
+            if(memcmp(expected, actual, sizeof(input)) != 0){
+                fprintf(stderr, "%s %s disagrees with the original loop at offset %d and length %zu\n", name,
+                        transformName, offset, len);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ * @function replaceSpaceReference
+ * @description Loop of the original Munch1- replace every space with '*'
+ * */
+static void replaceSpaceReference(char* str, size_t len){
+    for(size_t index = 0; index < len; index++){
+        if(str[index] == ' ') str[index] = '*';
+    }
+}
+
+/**
+ * @function convertLowerReference
+ * @description
+ * Loop of the original Munch2- islower/toupper. The program never calls setlocale, so it runs in the C locale.
+ * The byte is passed as unsigned char, as islower is undefined for the negative values of a plain char.
+ * */
+static void convertLowerReference(char* str, size_t len){
+    for(size_t index = 0; index < len; index++){
+        unsigned char ch = (unsigned char) str[index];
+        if(islower(ch)) str[index] = (char) toupper(ch);
+    }
+}
+
+/**
+ * @function measure
+ * @description Time the transform over the whole buffer. The buffer is refreshed from source before each run.
+ * */
+static double measure(void (*transform)(char*, size_t), char* buffer, char* source, size_t size){
+    double best = 1e9;
+    for(int run = 0; run < 5; run++){
+        memcpy(buffer, source, size);
+        double start = now();
+        transform(buffer, size);
+        double elapsed = now() - start;
+        if(elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+/**
+ * @function now
+ * @description Current time of CLOCK_MONOTONIC in seconds
+ * */
+static double now(void){
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
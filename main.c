@@ -6,87 +6,453 @@
  *
  * @functions
  * main - main method
+ * runPipeline - Create the queues of the pipeline, run its threads and print the stats.
+ * runThreads - Run every thread of the pipeline in this process.
+ * runProcesses - Run the Reader, every stage and the Writer in a process of its own.
+ * runRoleProcess - Body of one of these processes.
+ * waitForProcesses - Wait for the processes and kill the others if one of them fails.
+ * startReader, startStage, startWriter - Create the threads of the Reader, of a stage and of the Writer.
+ * printEndpointStats - Print the stats of the Writer, the Receiver or the Sender created in this process.
+ * roleName - Name of the Reader, of a stage or of the Writer, or of the Receiver or Sender taking their place.
+ * queueName - Name of the queue between two stages.
+ * queueTypeFor - Pick the queue backend from the number of producer and consumer threads.
+ * joinThreads - Check the return values of pthread_create and wait for a range of threads to finish.
  * findErrorIndex - Given an array containing return codes, returns the first non-zero code which would signify error.
  *
  * */
 
 #include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
 #include "Queue.h"
 #include "Threads.h"
+#include "Transform.h"
+#include "Stage.h"
+#include "Options.h"
+#include "Placement.h"
+#include "SharedSegment.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include "Error.h"
 
-// The maximum size of each queue
-#define MAX_QUEUE_SIZE 10
+// Everything the threads of the pipeline are created from
+typedef struct {
+    Options* options;
+    // Stages run between the Reader and the Writer
+    int stageCount;
+    Stage** stages;
+    // queues[stage] is the input queue of the stage and queues[stageCount] the input queue of the Writer
+    Queue** queues;
+    // Restores the input order when a stage has several workers. NULL otherwise.
+    ReorderBuffer* reorderBuffer;
+    Placement* placement;
+    // Segment in which the queues live when the pipeline runs as several processes. NULL otherwise.
+    SharedSegment* segment;
+    // Number of threads- Reader, the workers of every stage and Writer
+    int threadCount;
+    // Ends of the pipeline created in this process, NULL otherwise. Their stats are printed once they are done.
+    Writer* writer;
+    Receiver* receiver;
+    Sender* sender;
+    // Exports the stats of the queues and the processed count of each stage while running. NULL without --metrics.
+    Metrics* metrics;
+} Pipeline;
 
 // static function to find the index of error code in an array.
-static int findErrorIndex(int* retVals);
+static int findErrorIndex(int* retVals, int count);
+// static functions which run the pipeline
+static void runPipeline(Options* options);
+static void runThreads(Pipeline* pipeline);
+static void runProcesses(Pipeline* pipeline);
+static void runRoleProcess(Pipeline* pipeline, int role);
+static void waitForProcesses(Pipeline* pipeline, pid_t* processes, int count);
+static void startReader(Pipeline* pipeline, pthread_t* threads, int* thread_rets);
+static int startStage(Pipeline* pipeline, int stage, int index, pthread_t* threads, int* thread_rets);
+static void startWriter(Pipeline* pipeline, pthread_t* threads, int* thread_rets);
+static void printEndpointStats(Pipeline* pipeline);
+static char* roleName(Pipeline* pipeline, int role);
+static char* queueName(char* producer, char* consumer);
+static QueueType queueTypeFor(int producers, int consumers, QueueType sharedQueueType);
+static void joinThreads(pthread_t* threads, int* thread_rets, int first, int last);
 
 /**
  * @function main
- * @arguments None
+ * @arguments argc, argv - Command line options. See Options module.
  * @description
- * This method creates 3 queues and then calls functions from Thread module to create Reader, Munch1, Munch2 and Writer structs.
- * Subsequently, it creates 4 threads corresponding to each function and waits for them to finish using join.
- * Before exiting, it prints the stats for each queue.
+ * This method parses the options and then runs the pipeline. By default it is Reader => Munch1 => Munch2 => Writer,
+ * in the fused mode Reader => FusedMunch => Writer and otherwise the stages given by --stages. With --listen the
+ * Reader is replaced by a Receiver and with --connect the Writer by a Sender.
  * In case of any error, an appropriate message is printed on stderr and then the program exits.
  * */
-int main(){
-    pthread_t reader_thread, munch1_thread, munch2_thread, writer_thread;
+int main(int argc, char** argv){
+    Options options = ParseOptions(argc, argv);
 
-    // Create a queue to act as an intermediary between 4 functionalities i.e. Reader, Munch1, Munch2 and Writer.
-    Queue* reader_munch1_queue = CreateStringQueue(MAX_QUEUE_SIZE, "Reader-Munch1");
-    Queue* munch1_munch2_queue = CreateStringQueue(MAX_QUEUE_SIZE, "Munch1-Munch2");
-    Queue* munch2_writer_queue = CreateStringQueue(MAX_QUEUE_SIZE, "Munch2-Writer");
+    // Pick the SIMD implementation of the munch transforms before any thread uses them
+    SelectTransformKernels();
 
-    // Call the methods from Thread module to create the appropriate structs for each function.
-    // The queue created above are passed to each struct.
-    Reader* reader = CreateReader(reader_munch1_queue);
-    Munch1* munch1 = CreateMunch1(reader_munch1_queue, munch1_munch2_queue);
-    Munch2* munch2 = CreateMunch2(munch1_munch2_queue, munch2_writer_queue);
-    Writer* writer = CreateWriter(munch2_writer_queue);
+    runPipeline(&options);
 
-    // Create the threads using the functional structs created above. We store the return value in an array.
-    int thread_rets[4];
-    thread_rets[0] = pthread_create(&reader_thread, NULL, StartReader, (void*) reader);
-    thread_rets[1] = pthread_create(&munch1_thread, NULL, StartMunch1, (void*) munch1);
-    thread_rets[2] = pthread_create(&munch2_thread, NULL, StartMunch2, (void*) munch2);
-    thread_rets[3] = pthread_create(&writer_thread, NULL, StartWriter, (void*) writer);
+    // exit with a success response
+    exit(EXIT_SUCCESS);
+}
 
-    // From the return value array, find the index of error, if any.
-    int errorIndex = findErrorIndex(thread_rets);
-    if(errorIndex != -1){
-        // In case of an error, print the corresponding message and exit.
-        PrintErrorAndExit(errorIndex+1, thread_rets[errorIndex]);
+/**
+ * @function runPipeline
+ * @arguments options - Parsed command line options
+ * @description
+ * This method loads the stages of options->stages and creates a queue between every two adjacent threads of the
+ * pipeline. The first stage runs options->munch1Workers threads and every later stage options->munch2Workers,
+ * unless the spec gives its number of workers.
+ * The threads then run in this process, or with --processes the Reader, every stage and the Writer run in a process
+ * of their own and the queues are created in a shared memory segment. Once they have finished, the stats of each
+ * queue are printed. With --metrics the same stats are exported periodically while the pipeline runs, and with
+ * --trace the sampled lines are written to the trace file.
+ * */
+static void runPipeline(Options* options){
+    Pipeline pipeline;
+    pipeline.options = options;
+    pipeline.stageCount = CountStages(options->stages);
+    pipeline.stages = malloc(sizeof(Stage*) * (pipeline.stageCount + 1));
+    if(pipeline.stages == NULL) PrintMallocErrorAndExit("main", "Pipeline", "Stages");
+    // Threads are numbered in pipeline order- Reader, the workers of every stage and Writer
+    int reorder = 0;
+    pipeline.threadCount = 2;
+    for(int stage = 0; stage < pipeline.stageCount; stage++){
+        pipeline.stages[stage] = LoadStage(options->stages, stage, stage == 0 ? options->munch1Workers : options->munch2Workers);
+        pipeline.threadCount = pipeline.threadCount + pipeline.stages[stage]->workers;
+        // Workers of a pool can finish lines out of order. In that case the Writer restores the input order.
+        if(pipeline.stages[stage]->workers > 1) reorder = 1;
     }
+    pipeline.placement = CreatePlacement(options->placement, pipeline.threadCount);
+    // The processes are forked after the segment is mapped, so it is at the same address in all of them
+    pipeline.segment = NULL;
+    if(options->processes) pipeline.segment = CreateSharedSegment((size_t) options->sharedMemoryMB << 20, "Pipeline");
+    // With --processes the rings of the trace are in the segment as well, so this process can write all of them
+    if(options->traceFile != NULL) StartTrace(options->traceFile, (unsigned long) options->traceSample, pipeline.segment);
 
-    // Wait for the threads to finish execution
-    pthread_join(reader_thread, NULL);
-    pthread_join(munch1_thread, NULL);
-    pthread_join(munch2_thread, NULL);
-    pthread_join(writer_thread, NULL);
+    // Create a queue to act as an intermediary between every two functionalities. Example- Reader-Munch1
+    // A queue with exactly one producer and one consumer thread uses the single-producer ring, any other the backend
+    // chosen with --shared-queue.
+    pipeline.queues = malloc(sizeof(Queue*) * (pipeline.stageCount + 1));
+    if(pipeline.queues == NULL) PrintMallocErrorAndExit("main", "Pipeline", "Queues");
+    // Thread index of the first consumer of each queue
+    int consumer = 1;
+    for(int queue = 0; queue <= pipeline.stageCount; queue++){
+        Stage** stages = pipeline.stages;
+        int producers = queue == 0 ? 1 : stages[queue - 1]->workers;
+        int consumers = queue == pipeline.stageCount ? 1 : stages[queue]->workers;
+        pipeline.queues[queue] = CreateSharedStringQueue(options->queueSize, options->queueMin, options->queueMax,
+                                                         queueName(roleName(&pipeline, queue), roleName(&pipeline, queue + 1)),
+                                                         queueTypeFor(producers, consumers, options->sharedQueueType),
+                                                         pipeline.segment);
+        // Each queue lives on the NUMA node of (the first of) its consumers
+        PlaceQueueOnNode(pipeline.queues[queue], GetPlacementNode(pipeline.placement, consumer));
+        SetQueueWaitPolicy(pipeline.queues[queue], options->waitSpin, options->waitYield);
+        consumer = consumer + consumers;
+    }
+
+    // Every stage and the Writer count the records they processed. The counters are read by the metrics thread.
+    pipeline.metrics = NULL;
+    if(options->metricsTarget != NULL){
+        char** names = malloc(sizeof(char*) * (pipeline.stageCount + 1));
+        if(names == NULL) PrintMallocErrorAndExit("main", "Pipeline", "Metrics");
+        for(int role = 1; role <= pipeline.stageCount + 1; role++) names[role - 1] = roleName(&pipeline, role);
+        pipeline.metrics = CreateMetrics(options->metricsTarget, options->metricsIntervalMs, pipeline.stageCount + 1,
+                                         pipeline.queues, pipeline.stageCount + 1, names, pipeline.segment);
+    }
+
+    pipeline.reorderBuffer = NULL;
+    if(reorder) pipeline.reorderBuffer = CreateReorderBuffer((unsigned long) options->reorderWindow, pipeline.segment);
+
+    pipeline.writer = NULL;
+    pipeline.receiver = NULL;
+    pipeline.sender = NULL;
+    if(options->processes){
+        runProcesses(&pipeline);
+    } else {
+        runThreads(&pipeline);
+    }
+    if(pipeline.metrics != NULL) StopMetrics(pipeline.metrics);
+    WriteTrace();
 
     // Once the execution is completed by the threads, we print the stats of each queue.
-    PrintQueueStats(reader_munch1_queue);
-    PrintQueueStats(munch1_munch2_queue);
-    PrintQueueStats(munch2_writer_queue);
+    for(int queue = 0; queue <= pipeline.stageCount; queue++){
+        PrintQueueStats(pipeline.queues[queue]);
+    }
+    // With --processes the Writer, the Receiver and the Sender print their stats in their own process
+    printEndpointStats(&pipeline);
+}
 
-    // exit with a success response
+/**
+ * @function runThreads
+ * @arguments pipeline - Stages and queues of the pipeline
+ * @description
+ * Create the Reader, a StageWorker for every worker of every stage and the Writer, run each of them in a thread of
+ * this process and wait for all of them to finish.
+ * */
+static void runThreads(Pipeline* pipeline){
+    // Create the threads using the functional structs. We store the return value in an array.
+    pthread_t* threads = malloc(sizeof(pthread_t) * pipeline->threadCount);
+    int* thread_rets = malloc(sizeof(int) * pipeline->threadCount);
+    if(threads == NULL || thread_rets == NULL) PrintMallocErrorAndExit("main", "Pipeline", "Threads");
+
+    if(pipeline->metrics != NULL) StartMetrics(pipeline->metrics);
+    startReader(pipeline, threads, thread_rets);
+    int index = 1;
+    for(int stage = 0; stage < pipeline->stageCount; stage++){
+        index = startStage(pipeline, stage, index, threads, thread_rets);
+    }
+    startWriter(pipeline, threads, thread_rets);
+
+    // Wait for the threads to finish execution
+    joinThreads(threads, thread_rets, 0, pipeline->threadCount);
+    free(threads);
+    free(thread_rets);
+}
+
+/**
+ * @function runProcesses
+ * @arguments pipeline - Stages and queues of the pipeline. The queues are in the shared segment.
+ * @description
+ * Fork a process for the Reader, for every stage and for the Writer (its roles) and wait for all of them to finish.
+ * Each process creates the threads of its role. A stage can thereby crash or grow without touching the memory of
+ * the others, while lines are still passed on through the shared segment without being copied.
+ * */
+static void runProcesses(Pipeline* pipeline){
+    int count = pipeline->stageCount + 2;
+    pid_t* processes = malloc(sizeof(pid_t) * count);
+    if(processes == NULL) PrintMallocErrorAndExit("main", "Pipeline", "Processes");
+
+    for(int role = 0; role < count; role++){
+        // Nothing buffered in this process may be written again by a child
+        fflush(NULL);
+        processes[role] = fork();
+        if(processes[role] < 0) PrintSystemCallErrorAndExit("main", roleName(pipeline, role), "fork", errno);
+        if(processes[role] == 0) runRoleProcess(pipeline, role);
+    }
+    // The queues and the counters are in the segment, so the metrics thread of this process sees every role
+    if(pipeline->metrics != NULL) StartMetrics(pipeline->metrics);
+    waitForProcesses(pipeline, processes, count);
+    free(processes);
+}
+
+/**
+ * @function runRoleProcess
+ * @arguments pipeline - Stages and queues of the pipeline
+ * @arguments role - 0 for the Reader, 1 to stageCount for the stages and stageCount + 1 for the Writer
+ * @description
+ * Body of a forked process. Start the threads of the role, wait for them and exit. The Writer, the Receiver and the
+ * Sender print their stats.
+ * The process is killed if the parent dies, so that it does not wait on a queue forever.
+ * */
+static void runRoleProcess(Pipeline* pipeline, int role){
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    pthread_t* threads = malloc(sizeof(pthread_t) * pipeline->threadCount);
+    int* thread_rets = malloc(sizeof(int) * pipeline->threadCount);
+    if(threads == NULL || thread_rets == NULL) PrintMallocErrorAndExit("main", roleName(pipeline, role), "Threads");
+
+    if(role == 0){
+        startReader(pipeline, threads, thread_rets);
+        joinThreads(threads, thread_rets, 0, 1);
+    } else if(role <= pipeline->stageCount){
+        // Thread index of the first worker of the stage
+        int first = 1;
+        for(int stage = 0; stage < role - 1; stage++) first = first + pipeline->stages[stage]->workers;
+        int last = startStage(pipeline, role - 1, first, threads, thread_rets);
+        joinThreads(threads, thread_rets, first, last);
+    } else {
+        startWriter(pipeline, threads, thread_rets);
+        joinThreads(threads, thread_rets, pipeline->threadCount - 1, pipeline->threadCount);
+    }
+    printEndpointStats(pipeline);
     exit(EXIT_SUCCESS);
 }
 
+/**
+ * @function waitForProcesses
+ * @arguments pipeline - Stages and queues of the pipeline
+ * @arguments processes - Process of every role
+ * @arguments count - Number of roles
+ * @description
+ * Wait until every process has exited. If one of them fails, the others would wait on its queue forever, so they
+ * are killed and the failure is printed before exiting.
+ * */
+static void waitForProcesses(Pipeline* pipeline, pid_t* processes, int count){
+    int remaining = count;
+    while(remaining > 0){
+        int status;
+        pid_t process = waitpid(-1, &status, 0);
+        if(process < 0){
+            if(errno == EINTR) continue;
+            PrintSystemCallErrorAndExit("main", "Pipeline", "waitpid", errno);
+        }
+        int role = 0;
+        while(role < count && processes[role] != process) role++;
+        if(role == count) continue;
+        processes[role] = 0;
+        remaining = remaining - 1;
+        if(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) continue;
+
+        for(int other = 0; other < count; other++){
+            if(processes[other] > 0) kill(processes[other], SIGKILL);
+        }
+        PrintProcessErrorAndExit("main", roleName(pipeline, role), status);
+    }
+}
+
+/**
+ * @function startReader
+ * @arguments pipeline - Stages and queues of the pipeline
+ * @arguments threads, thread_rets - Thread and return value of pthread_create of every thread of the pipeline
+ * @description Create the Reader, or the Receiver with --listen, and start it as thread 0
+ * */
+static void startReader(Pipeline* pipeline, pthread_t* threads, int* thread_rets){
+    Options* options = pipeline->options;
+    if(options->listenAddress != NULL){
+        // The Sender may run up to the largest size of a local queue ahead of the first stage
+        pipeline->receiver = CreateReceiver(pipeline->queues[0], pipeline->reorderBuffer, options->listenAddress,
+                                            options->queueMax, pipeline->segment);
+        thread_rets[0] = CreatePlacedThread(pipeline->placement, 0, RECEIVER, &threads[0], StartReceiver, (void*) pipeline->receiver);
+        return;
+    }
+    Reader* reader = CreateReader(pipeline->queues[0], pipeline->reorderBuffer, options->mapInput, options->ioUring,
+                                  options->streamLongLines, pipeline->segment);
+    // Line buffers are first read by the first stage
+    SetBufferPoolNode(reader->bufferPool, GetPlacementNode(pipeline->placement, 1));
+    thread_rets[0] = CreatePlacedThread(pipeline->placement, 0, READER, &threads[0], StartReader, (void*) reader);
+}
+
+/**
+ * @function startStage
+ * @arguments pipeline - Stages and queues of the pipeline
+ * @arguments stage - Index of the stage
+ * @arguments index - Thread index of the first worker of the stage
+ * @arguments threads, thread_rets - Thread and return value of pthread_create of every thread of the pipeline
+ * @description Create a StageWorker for every worker of the stage and start them. Returns the index after the last one.
+ * */
+static int startStage(Pipeline* pipeline, int stage, int index, pthread_t* threads, int* thread_rets){
+    Stage* current = pipeline->stages[stage];
+    WorkerGroup* group = CreateWorkerGroup(current->workers, GetMetricsCounter(pipeline->metrics, stage));
+    for(int worker = 0; worker < current->workers; worker++, index++){
+        StageWorker* stageWorker = CreateStageWorker(pipeline->queues[stage], pipeline->queues[stage + 1], group, current);
+        thread_rets[index] = CreatePlacedThread(pipeline->placement, index, current->name, &threads[index], StartStageWorker, (void*) stageWorker);
+    }
+    return index;
+}
+
+/**
+ * @function startWriter
+ * @arguments pipeline - Stages and queues of the pipeline
+ * @arguments threads, thread_rets - Thread and return value of pthread_create of every thread of the pipeline
+ * @description Create the Writer, or the Sender with --connect, and start it as the last thread
+ * */
+static void startWriter(Pipeline* pipeline, pthread_t* threads, int* thread_rets){
+    int index = pipeline->threadCount - 1;
+    Queue* inputQueue = pipeline->queues[pipeline->stageCount];
+    MetricsCounter* processed = GetMetricsCounter(pipeline->metrics, pipeline->stageCount);
+    if(pipeline->options->connectAddress != NULL){
+        pipeline->sender = CreateSender(inputQueue, pipeline->reorderBuffer, pipeline->options->connectAddress, processed);
+        thread_rets[index] = CreatePlacedThread(pipeline->placement, index, SENDER, &threads[index], StartSender, (void*) pipeline->sender);
+        return;
+    }
+    pipeline->writer = CreateWriter(inputQueue, pipeline->reorderBuffer, pipeline->options->ioUring, processed);
+    thread_rets[index] = CreatePlacedThread(pipeline->placement, index, WRITER, &threads[index], StartWriter, (void*) pipeline->writer);
+}
+
+/**
+ * @function printEndpointStats
+ * @arguments pipeline - Stages and queues of the pipeline
+ * @description Print the stats of the Writer, the Receiver and the Sender if they were created in this process
+ * */
+static void printEndpointStats(Pipeline* pipeline){
+    if(pipeline->receiver != NULL) PrintReceiverStats(pipeline->receiver);
+    if(pipeline->sender != NULL) PrintSenderStats(pipeline->sender);
+    if(pipeline->writer != NULL) PrintWriterStats(pipeline->writer);
+}
+
+/**
+ * @function roleName
+ * @arguments pipeline - Stages and queues of the pipeline
+ * @arguments role - 0 for the Reader, 1 to stageCount for the stages and stageCount + 1 for the Writer
+ * @description Return the name of the role. Example- 'Munch1' or 'Sender'
+ * */
+static char* roleName(Pipeline* pipeline, int role){
+    if(role == 0) return pipeline->options->listenAddress != NULL ? RECEIVER : READER;
+    if(role <= pipeline->stageCount) return pipeline->stages[role - 1]->name;
+    return pipeline->options->connectAddress != NULL ? SENDER : WRITER;
+}
+
+/**
+ * @function queueName
+ * @arguments producer - Name of the functionality which enqueues in the queue. Example- 'Reader'
+ * @arguments consumer - Name of the functionality which dequeues from the queue. Example- 'Munch1'
+ * @description Return the name of the queue between the two functionalities. Example- 'Reader-Munch1'
+ * */
+static char* queueName(char* producer, char* consumer){
+    size_t length = strlen(producer) + strlen(consumer) + 2;
+    char* name = malloc(length);
+    if(name == NULL) {
+        PrintMallocErrorAndExit("main", producer, "QueueName");
+        return NULL;
+    }
+    snprintf(name, length, "%s-%s", producer, consumer);
+    return name;
+}
+
+/**
+ * @function queueTypeFor
+ * @arguments producers - Number of threads which enqueue in the queue
+ * @arguments consumers - Number of threads which dequeue from the queue
+ * @arguments sharedQueueType - Backend used when there are several producers or consumers
+ * @description
+ * The single-producer ring only supports a single producer and a single consumer. Otherwise the multi-producer ring or
+ * the semaphore based queue is used, as chosen by the options.
+ * */
+static QueueType queueTypeFor(int producers, int consumers, QueueType sharedQueueType){
+    if(producers == 1 && consumers == 1) return QUEUE_SPSC;
+    return sharedQueueType;
+}
+
+/**
+ * @function joinThreads
+ * @arguments threads - Threads created by the pipeline
+ * @arguments thread_rets - Return values of pthread_create for each thread
+ * @arguments first - Index of the first thread to wait for
+ * @arguments last - Index after the last thread to wait for
+ * @description
+ * If any of the threads could not be created then print the error and exit. Otherwise wait for them to finish.
+ * */
+static void joinThreads(pthread_t* threads, int* thread_rets, int first, int last){
+    // From the return value array, find the index of error, if any.
+    int errorIndex = findErrorIndex(thread_rets + first, last - first);
+    if(errorIndex != -1){
+        // In case of an error, print the corresponding message and exit.
+        PrintErrorAndExit(first + errorIndex + 1, thread_rets[first + errorIndex]);
+    }
+
+    for(int index = first; index < last; index++){
+        pthread_join(threads[index], NULL);
+    }
+}
+
 /**
  * @function findErrorIndex
  * @arguments retVals - Pointer to an integer array
+ * @arguments count - Number of values in the array
  * @description
  * This function takes an array pointer as an input and then return the index of first non-zero value in the array.
  * The first non-zero value would correspond to the error.
  * */
-static int findErrorIndex(int* retVals){
+static int findErrorIndex(int* retVals, int count){
     int errorIndex = -1;
     // Iterate through the array and check if the corresponding value is non-zero
-    for(int index = 0; index < 4; index++){
+    for(int index = 0; index < count; index++){
         if(retVals[index]){
             // If a non-zero value is found, break the loop and return the value.
             errorIndex = index;
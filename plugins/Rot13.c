@@ -0,0 +1,38 @@
+/**
+ * @author Harsh Rawat, harsh-rawat, hrawat2
+ * @author Sidharth Gurbani, gurbani, gurbani
+ *
+ * @description
+ * Example stage plugin which applies rot13 to the letters of every line. See StagePlugin.h.
+ * Build- make plugins
+ * Run- ./prodcom --stages munch1,munch2,./plugins/rot13.so < input
+ * */
+
+#include "StagePlugin.h"
+
+const int StagePluginAbiVersion = STAGE_PLUGIN_ABI_VERSION;
+
+/**
+ * @function rotate
+ * @argument character - Character of a line
+ * @description Return the character rotated by 13 places if it is a letter, otherwise the character itself
+ * */
+static char rotate(char character){
+    if(character >= 'a' && character <= 'z') return (char) ('a' + (character - 'a' + 13) % 26);
+    if(character >= 'A' && character <= 'Z') return (char) ('A' + (character - 'A' + 13) % 26);
+    return character;
+}
+
+/**
+ * @function TransformRecords
+ * @argument records - Batch of lines
+ * @argument count - Number of lines in the batch
+ * @description Apply rot13 to every line of the batch in place
+ * */
+void TransformRecords(StageRecord* records, size_t count){
+    for(size_t record = 0; record < count; record++){
+        for(size_t index = 0; index < records[record].length; index++){
+            records[record].data[index] = rotate(records[record].data[index]);
+        }
+    }
+}
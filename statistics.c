@@ -5,154 +5,406 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include "statistics.h"
 #include "Error.h"
 
+// Shard used by the current thread. Assigned on the first update from this thread.
+static _Thread_local int threadShard = -1;
+// Shard handed out to the next thread of this process which records a sample
+static atomic_int localNextShard = 0;
+// Counter the shards are handed out from. The first stats created in a shared segment move it into the segment, so
+// the threads of all the processes forked afterwards take different shards instead of each starting at shard 0.
+static atomic_int* nextShard = &localNextShard;
+
+// Static utility functions
+static StatsShard* findShard(Stats* stats);
+static int findBucket(unsigned long long nanos);
+static unsigned long long bucketUpperBound(int bucket);
+static unsigned long long findPercentile(unsigned long* histogram, unsigned long total, double percentile);
+static void mergeHistogram(Stats* stats, int enqueue, unsigned long* histogram, unsigned long* total);
+static void printPercentiles(char* operation, unsigned long* histogram, unsigned long total);
+static void printBackpressure(StatsSnapshot* snapshot, unsigned long enqueueOps, unsigned long dequeueOps);
+static void printCapacity(StatsSnapshot* snapshot);
+
 /**
  * @function CreateStatistics
  * @argument statsIdentity - Name associated with this stats struct
+ * @argument capacity - Initial capacity of the queue whose stats are maintained
+ * @argument segment - Shared memory segment in which the struct is allocated. NULL allocates it from the heap.
  * @description This method returns a new struct initialized with initial values of all the counters.
- * The access to this module is synchronized.
+ * The counters can be updated from any thread without locking, and from any process if the struct is in a segment.
  * */
-Stats* CreateStatistics(char* statsIdentity){
-    // Allocate the memory for the stats struct. In case of any error, print an error message and return.
-    Stats* stats = malloc(sizeof(Stats));
+Stats* CreateStatistics(char* statsIdentity, int capacity, SharedSegment* segment){
+    // Allocate the memory for the stats struct. The shards are cache line aligned so that threads do not share a line.
+    Stats* stats = AllocateAligned(segment, 64, sizeof(Stats));
     if(stats == NULL){
         PrintMallocErrorAndExit(STATS_MODULE, statsIdentity, "CreateStatistics");
         return NULL;
     }
 
+    // Stats are created before the processes are forked, so every process inherits the shared counter
+    if(segment != NULL && nextShard == &localNextShard){
+        atomic_int* sharedNextShard = AllocateAligned(segment, 64, sizeof(atomic_int));
+        if(sharedNextShard == NULL) PrintMallocErrorAndExit(STATS_MODULE, statsIdentity, "NextShard");
+        atomic_init(sharedNextShard, atomic_load_explicit(&localNextShard, memory_order_relaxed));
+        nextShard = sharedNextShard;
+    }
+
     // Set the name and initialize other counters with an initial value of 0.
     stats->statsIdentity = statsIdentity;
-    stats->dequeueCount = 0;
-    stats->enqueueCount = 0;
-    stats->dequeueTime = 0.0;
-    stats->enqueueTime = 0.0;
-
-    // Initialize the lock semaphore which is used to synchronize access to this module.
-    int retVal = sem_init(&stats->lock, 0, 1);
-
-    if(retVal != 0)
-        PrintSemInitErrorAndExit(STATS_MODULE, statsIdentity, "Lock");
+    atomic_init(&stats->capacity, capacity);
+    atomic_init(&stats->peakCapacity, capacity);
+    atomic_init(&stats->grownCount, 0);
+    atomic_init(&stats->shrunkCount, 0);
+    for(int shard = 0; shard < STATS_SHARDS; shard++){
+        StatsShard* counters = &stats->shards[shard];
+        atomic_init(&counters->enqueueCount, 0);
+        atomic_init(&counters->dequeueCount, 0);
+        atomic_init(&counters->enqueueTime, 0);
+        atomic_init(&counters->dequeueTime, 0);
+        for(int bucket = 0; bucket < STATS_BUCKETS; bucket++){
+            atomic_init(&counters->enqueueLatency[bucket], 0);
+            atomic_init(&counters->dequeueLatency[bucket], 0);
+        }
+        atomic_init(&counters->blockedOnFullTime, 0);
+        atomic_init(&counters->blockedOnFullCount, 0);
+        atomic_init(&counters->blockedOnEmptyTime, 0);
+        atomic_init(&counters->blockedOnEmptyCount, 0);
+        for(int bucket = 0; bucket < STATS_OCCUPANCY_BUCKETS; bucket++){
+            atomic_init(&counters->occupancy[bucket], 0);
+        }
+        for(int phase = 0; phase < STATS_WAIT_PHASES; phase++){
+            atomic_init(&counters->waitPhases[phase], 0);
+        }
+    }
 
     // return created stats struct
     return stats;
 }
 
+/**
+ * @function GetMonotonicTime
+ * @description Return the current time of CLOCK_MONOTONIC in nanoseconds
+ * */
+unsigned long long GetMonotonicTime(void){
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (unsigned long long) time.tv_sec * 1000000000ULL + (unsigned long long) time.tv_nsec;
+}
+
 /**
  * @function UpdateEnqueueCount
  * @argument stats - stats struct used to maintain state for this module
  * @argument count - The count with which the counter needs to be incremented
- * @description Update the enqueue counter with the given count value
+ * @description Update the enqueue counter of the shard of this thread with the given count value
  * */
 void UpdateEnqueueCount(Stats* stats, int count){
-    int retVal;
-    // Lock the method using semaphore
-    retVal = sem_wait(&stats->lock);
-    // In case of error, print the error message and exit
-    if(retVal != 0) PrintSemWaitErrorAndExit(STATS_MODULE, stats->statsIdentity, "UpdateEnqueueCount");
-
-    // Update the enqueue count
-    stats->enqueueCount = stats->enqueueCount + count;
-
-    // Release the method lock
-    retVal = sem_post(&stats->lock);
-    // In case of error, print the error message and exit
-    if(retVal != 0) PrintSemPostErrorAndExit(STATS_MODULE,  stats->statsIdentity, "UpdateEnqueueCount");
+    atomic_fetch_add_explicit(&findShard(stats)->enqueueCount, (unsigned long) count, memory_order_relaxed);
 }
 
 /**
  * @function UpdateDequeueCount
  * @argument stats - stats struct used to maintain state for this module
  * @argument count - The count with which the counter needs to be incremented
- * @description Update the dequeue counter with the given count value
+ * @description Update the dequeue counter of the shard of this thread with the given count value
  * */
 void UpdateDequeueCount(Stats* stats, int count){
-    int retVal;
-    // Lock the method using semaphore
-    retVal = sem_wait(&stats->lock);
-    // In case of error, print the error message and exit
-    if(retVal != 0) PrintSemWaitErrorAndExit(STATS_MODULE,  stats->statsIdentity, "UpdateDequeueCount");
+    atomic_fetch_add_explicit(&findShard(stats)->dequeueCount, (unsigned long) count, memory_order_relaxed);
+}
 
-    // Update the dequeue count
-    stats->dequeueCount = stats->dequeueCount + count;
+/**
+ * @function UpdateEnqueueTime
+ * @argument stats - stats struct used to maintain state for this module
+ * @argument startTime - Start time returned by GetMonotonicTime
+ * @argument endTime - End time returned by GetMonotonicTime
+ * @description Update the enqueue time counter and add the elapsed time to the enqueue latency histogram
+ * */
+void UpdateEnqueueTime(Stats* stats, unsigned long long startTime, unsigned long long endTime){
+    StatsShard* shard = findShard(stats);
+    unsigned long long elapsed = endTime - startTime;
+    atomic_fetch_add_explicit(&shard->enqueueTime, elapsed, memory_order_relaxed);
+    atomic_fetch_add_explicit(&shard->enqueueLatency[findBucket(elapsed)], 1, memory_order_relaxed);
+}
 
-    // Release the lock on this method
-    retVal = sem_post(&stats->lock);
-    // In case of error, print the error message and exit
-    if(retVal != 0) PrintSemPostErrorAndExit(STATS_MODULE,  stats->statsIdentity, "UpdateDequeueCount");
+/**
+ * @function UpdateDequeueTime
+ * @argument stats - stats struct used to maintain state for this module
+ * @argument startTime - Start time returned by GetMonotonicTime
+ * @argument endTime - End time returned by GetMonotonicTime
+ * @description Update the dequeue time counter and add the elapsed time to the dequeue latency histogram
+ * */
+void UpdateDequeueTime(Stats* stats, unsigned long long startTime, unsigned long long endTime){
+    StatsShard* shard = findShard(stats);
+    unsigned long long elapsed = endTime - startTime;
+    atomic_fetch_add_explicit(&shard->dequeueTime, elapsed, memory_order_relaxed);
+    atomic_fetch_add_explicit(&shard->dequeueLatency[findBucket(elapsed)], 1, memory_order_relaxed);
 }
 
 /**
- * @function UpdateEnqueueTime
+ * @function UpdateBlockedOnFull
  * @argument stats - stats struct used to maintain state for this module
- * @argument startTime - Start time
- * @argument endTime - End time
- * @description Update the enqueue counter with the time elapsed
+ * @argument startTime - Time returned by GetMonotonicTime before the producer started to wait
+ * @argument endTime - Time returned by GetMonotonicTime once the producer got a free slot
+ * @description Add the time a producer spent waiting on a full queue
  * */
-void UpdateEnqueueTime(Stats* stats, clock_t startTime, clock_t endTime){
-    int retVal;
-    // Lock the method using semaphore
-    retVal = sem_wait(&stats->lock);
-    // In case of error, print the error message and exit
-    if(retVal != 0) PrintSemWaitErrorAndExit(STATS_MODULE,  stats->statsIdentity, "UpdateEnqueueTime");
+void UpdateBlockedOnFull(Stats* stats, unsigned long long startTime, unsigned long long endTime){
+    StatsShard* shard = findShard(stats);
+    atomic_fetch_add_explicit(&shard->blockedOnFullTime, endTime - startTime, memory_order_relaxed);
+    atomic_fetch_add_explicit(&shard->blockedOnFullCount, 1, memory_order_relaxed);
+}
 
-    // Calculate the time elapsed between start and end. Update the counter with the same.
-    double time_spent = (double)(endTime - startTime)/CLOCKS_PER_SEC;
-    stats->enqueueTime = stats->enqueueTime + time_spent;
+/**
+ * @function UpdateBlockedOnEmpty
+ * @argument stats - stats struct used to maintain state for this module
+ * @argument startTime - Time returned by GetMonotonicTime before the consumer started to wait
+ * @argument endTime - Time returned by GetMonotonicTime once the consumer got an entry
+ * @description Add the time a consumer spent waiting on an empty queue
+ * */
+void UpdateBlockedOnEmpty(Stats* stats, unsigned long long startTime, unsigned long long endTime){
+    StatsShard* shard = findShard(stats);
+    atomic_fetch_add_explicit(&shard->blockedOnEmptyTime, endTime - startTime, memory_order_relaxed);
+    atomic_fetch_add_explicit(&shard->blockedOnEmptyCount, 1, memory_order_relaxed);
+}
 
-    // Release the method lock
-    retVal = sem_post(&stats->lock);
-    // In case of error, print the error message and exit
-    if(retVal != 0) PrintSemPostErrorAndExit(STATS_MODULE,  stats->statsIdentity, "UpdateEnqueueTime");
+/**
+ * @function UpdateOccupancy
+ * @argument stats - stats struct used to maintain state for this module
+ * @argument occupancy - Number of entries in the queue
+ * @description Add the sample to the occupancy histogram. The bucket is the occupancy in tens of percent of capacity.
+ * */
+void UpdateOccupancy(Stats* stats, int occupancy){
+    int capacity = atomic_load_explicit(&stats->capacity, memory_order_relaxed);
+    int bucket = capacity > 0 ? occupancy * (STATS_OCCUPANCY_BUCKETS - 1) / capacity : 0;
+    if(bucket < 0) bucket = 0;
+    if(bucket >= STATS_OCCUPANCY_BUCKETS) bucket = STATS_OCCUPANCY_BUCKETS - 1;
+    atomic_fetch_add_explicit(&findShard(stats)->occupancy[bucket], 1, memory_order_relaxed);
 }
 
 /**
- * @function UpdateDequeueTime
+ * @function UpdateCapacity
  * @argument stats - stats struct used to maintain state for this module
- * @argument startTime - Start time
- * @argument endTime - End time
- * @description Update the dequeue counter with the time elapsed
+ * @argument capacity - New capacity of the queue
+ * @description Record the new capacity and count the change as a grow or a shrink
  * */
-void UpdateDequeueTime(Stats* stats, clock_t startTime, clock_t endTime){
-    int retVal;
-    // Lock the method using semaphore
-    retVal = sem_wait(&stats->lock);
-    // In case of error, print the error message and exit
-    if(retVal != 0) PrintSemWaitErrorAndExit(STATS_MODULE,  stats->statsIdentity, "UpdateDequeueTime");
+void UpdateCapacity(Stats* stats, int capacity){
+    int previous = atomic_exchange_explicit(&stats->capacity, capacity, memory_order_relaxed);
+    if(capacity > previous){
+        atomic_fetch_add_explicit(&stats->grownCount, 1, memory_order_relaxed);
+    } else if(capacity < previous){
+        atomic_fetch_add_explicit(&stats->shrunkCount, 1, memory_order_relaxed);
+    }
+    int peak = atomic_load_explicit(&stats->peakCapacity, memory_order_relaxed);
+    while(capacity > peak &&
+          !atomic_compare_exchange_weak_explicit(&stats->peakCapacity, &peak, capacity, memory_order_relaxed, memory_order_relaxed));
+}
 
-    // Calculate the time elapsed between start and end. Update the counter with the same.
-    double time_spent = (double)(endTime - startTime)/CLOCKS_PER_SEC;
-    stats->dequeueTime = stats->dequeueTime + time_spent;
+/**
+ * @function UpdateWaitPhase
+ * @argument stats - stats struct used to maintain state for this module
+ * @argument phase - Phase which resolved the wait. 0 for spin, 1 for yield and 2 for park.
+ * @description Count the wait under the phase which resolved it
+ * */
+void UpdateWaitPhase(Stats* stats, int phase){
+    if(phase < 0 || phase >= STATS_WAIT_PHASES) return;
+    atomic_fetch_add_explicit(&findShard(stats)->waitPhases[phase], 1, memory_order_relaxed);
+}
 
-    // Release the method lock
-    retVal = sem_post(&stats->lock);
-    // In case of error, print the error message and exit
-    if(retVal != 0) PrintSemPostErrorAndExit(STATS_MODULE,  stats->statsIdentity, "UpdateDequeueTime");
+/**
+ * @function SnapshotStatistics
+ * @argument stats - stats struct used to maintain state for this module
+ * @argument snapshot - Struct which receives the merged counters
+ * @description
+ * Add up the counters of all the shards with relaxed loads. No lock is taken, so this can be called at any time from
+ * any thread (or process sharing the struct) while the queue is in use.
+ * */
+void SnapshotStatistics(Stats* stats, StatsSnapshot* snapshot){
+    memset(snapshot, 0, sizeof(StatsSnapshot));
+    for(int shard = 0; shard < STATS_SHARDS; shard++){
+        StatsShard* counters = &stats->shards[shard];
+        snapshot->enqueueCount = snapshot->enqueueCount + atomic_load_explicit(&counters->enqueueCount, memory_order_relaxed);
+        snapshot->dequeueCount = snapshot->dequeueCount + atomic_load_explicit(&counters->dequeueCount, memory_order_relaxed);
+        snapshot->enqueueTime = snapshot->enqueueTime + atomic_load_explicit(&counters->enqueueTime, memory_order_relaxed);
+        snapshot->dequeueTime = snapshot->dequeueTime + atomic_load_explicit(&counters->dequeueTime, memory_order_relaxed);
+        snapshot->blockedOnFullTime = snapshot->blockedOnFullTime + atomic_load_explicit(&counters->blockedOnFullTime, memory_order_relaxed);
+        snapshot->blockedOnFullCount = snapshot->blockedOnFullCount + atomic_load_explicit(&counters->blockedOnFullCount, memory_order_relaxed);
+        snapshot->blockedOnEmptyTime = snapshot->blockedOnEmptyTime + atomic_load_explicit(&counters->blockedOnEmptyTime, memory_order_relaxed);
+        snapshot->blockedOnEmptyCount = snapshot->blockedOnEmptyCount + atomic_load_explicit(&counters->blockedOnEmptyCount, memory_order_relaxed);
+        for(int bucket = 0; bucket < STATS_OCCUPANCY_BUCKETS; bucket++){
+            snapshot->occupancy[bucket] = snapshot->occupancy[bucket] + atomic_load_explicit(&counters->occupancy[bucket], memory_order_relaxed);
+        }
+        for(int phase = 0; phase < STATS_WAIT_PHASES; phase++){
+            snapshot->waitPhases[phase] = snapshot->waitPhases[phase] + atomic_load_explicit(&counters->waitPhases[phase], memory_order_relaxed);
+        }
+    }
+    snapshot->capacity = atomic_load_explicit(&stats->capacity, memory_order_relaxed);
+    snapshot->peakCapacity = atomic_load_explicit(&stats->peakCapacity, memory_order_relaxed);
+    snapshot->grownCount = atomic_load_explicit(&stats->grownCount, memory_order_relaxed);
+    snapshot->shrunkCount = atomic_load_explicit(&stats->shrunkCount, memory_order_relaxed);
 }
 
 /**
  * @function PrintStatistics
  * @argument stats - stats struct used to maintain state for this module
- * @description This method is used to print the stats maintained by this module
+ * @description
+ * This method is used to print the stats maintained by this module. The shards are merged first.
+ * It should be called once the threads have stopped updating the stats, otherwise the values may be slightly stale.
  * */
 void PrintStatistics(Stats* stats){
-    int retVal;
-    // Lock the method using semaphore
-    retVal = sem_wait(&stats->lock);
-    // In case of error, print the error message and exit
-    if(retVal != 0) PrintSemWaitErrorAndExit(STATS_MODULE,  stats->statsIdentity, "PrintStatistics");
+    StatsSnapshot snapshot;
+    SnapshotStatistics(stats, &snapshot);
 
     // Print the stats maintained by this module
     fprintf(stderr, "Statistics of %s -\n",stats->statsIdentity);
-    fprintf(stderr,"Enqueue count is %d\n", stats->enqueueCount);
-    fprintf(stderr,"Dequeue count is %d\n", stats->dequeueCount);
-    fprintf(stderr,"Enqueue time is %lf\n", stats->enqueueTime);
-    fprintf(stderr,"Dequeue time is %lf\n\n", stats->dequeueTime);
-
-    // Release the method lock
-    retVal = sem_post(&stats->lock);
-    // In case of error, print the error message and exit
-    if(retVal != 0) PrintSemPostErrorAndExit(STATS_MODULE,  stats->statsIdentity, "PrintStatistics");
+    fprintf(stderr,"Enqueue count is %lu\n", snapshot.enqueueCount);
+    fprintf(stderr,"Dequeue count is %lu\n", snapshot.dequeueCount);
+    fprintf(stderr,"Enqueue time is %lf\n", snapshot.enqueueTime / 1e9);
+    fprintf(stderr,"Dequeue time is %lf\n", snapshot.dequeueTime / 1e9);
+
+    unsigned long histogram[STATS_BUCKETS], enqueueOps, dequeueOps;
+    mergeHistogram(stats, 1, histogram, &enqueueOps);
+    printPercentiles("Enqueue", histogram, enqueueOps);
+    mergeHistogram(stats, 0, histogram, &dequeueOps);
+    printPercentiles("Dequeue", histogram, dequeueOps);
+    printBackpressure(&snapshot, enqueueOps, dequeueOps);
+    printCapacity(&snapshot);
+    fprintf(stderr, "\n");
+}
+
+/**
+ * @function findShard
+ * @argument stats - stats struct used to maintain state for this module
+ * @description Return the shard of the calling thread. The first call of a thread assigns the next shard in turn.
+ * */
+static StatsShard* findShard(Stats* stats){
+    if(threadShard < 0){
+        threadShard = atomic_fetch_add_explicit(nextShard, 1, memory_order_relaxed) % STATS_SHARDS;
+    }
+    return &stats->shards[threadShard];
+}
+
+/**
+ * @function findBucket
+ * @argument nanos - Latency in nanoseconds
+ * @description
+ * Return the histogram bucket of the latency. Values below STATS_SUB_BUCKETS have a bucket each. Above that, every
+ * power of two is split in STATS_SUB_BUCKETS buckets using the bits which follow the most significant bit.
+ * */
+static int findBucket(unsigned long long nanos){
+    if(nanos < STATS_SUB_BUCKETS) return (int) nanos;
+    int msb = 63 - __builtin_clzll(nanos);
+    int sub = (int) ((nanos >> (msb - 2)) & (STATS_SUB_BUCKETS - 1));
+    return (msb - 1) * STATS_SUB_BUCKETS + sub;
+}
+
+/**
+ * @function bucketUpperBound
+ * @argument bucket - Index of a histogram bucket
+ * @description Return the largest latency in nanoseconds which falls in the bucket
+ * */
+static unsigned long long bucketUpperBound(int bucket){
+    if(bucket < STATS_SUB_BUCKETS) return (unsigned long long) bucket;
+    int msb = bucket / STATS_SUB_BUCKETS + 1;
+    unsigned long long sub = (unsigned long long) (bucket % STATS_SUB_BUCKETS);
+    unsigned long long lower = (STATS_SUB_BUCKETS + sub) << (msb - 2);
+    return lower + ((1ULL << (msb - 2)) - 1);
+}
+
+/**
+ * @function findPercentile
+ * @argument histogram - Merged latency histogram
+ * @argument total - Number of samples in the histogram
+ * @argument percentile - Requested percentile. Example- 99.9
+ * @description Return the upper bound of the bucket which holds the requested percentile
+ * */
+static unsigned long long findPercentile(unsigned long* histogram, unsigned long total, double percentile){
+    // Rank of the sample at the percentile, counting from 1
+    unsigned long rank = (unsigned long) (total * percentile / 100.0);
+    if(rank < total * percentile / 100.0) rank = rank + 1;
+    if(rank == 0) rank = 1;
+
+    unsigned long seen = 0;
+    for(int bucket = 0; bucket < STATS_BUCKETS; bucket++){
+        seen = seen + histogram[bucket];
+        if(seen >= rank) return bucketUpperBound(bucket);
+    }
+    return bucketUpperBound(STATS_BUCKETS - 1);
+}
+
+/**
+ * @function mergeHistogram
+ * @argument stats - stats struct used to maintain state for this module
+ * @argument enqueue - Merge the enqueue histograms if set, otherwise the dequeue histograms
+ * @argument histogram - Array of STATS_BUCKETS counts in which the merged histogram is stored
+ * @argument total - Set to the number of samples in the merged histogram
+ * @description Add up the latency histograms of all the shards
+ * */
+static void mergeHistogram(Stats* stats, int enqueue, unsigned long* histogram, unsigned long* total){
+    *total = 0;
+    for(int bucket = 0; bucket < STATS_BUCKETS; bucket++){
+        histogram[bucket] = 0;
+        for(int shard = 0; shard < STATS_SHARDS; shard++){
+            atomic_ulong* latency = enqueue ? stats->shards[shard].enqueueLatency : stats->shards[shard].dequeueLatency;
+            histogram[bucket] = histogram[bucket] + atomic_load_explicit(&latency[bucket], memory_order_relaxed);
+        }
+        *total = *total + histogram[bucket];
+    }
+}
+
+/**
+ * @function printPercentiles
+ * @argument operation - Name of the operation. Example- Enqueue
+ * @argument histogram - Merged latency histogram
+ * @argument total - Number of samples in the histogram
+ * @description Print p50, p99 and p99.9 of the histogram in microseconds. Nothing is printed without samples.
+ * */
+static void printPercentiles(char* operation, unsigned long* histogram, unsigned long total){
+    if(total == 0) return;
+    fprintf(stderr, "%s wait p50/p99/p99.9 is %.3lf/%.3lf/%.3lf us\n", operation,
+            findPercentile(histogram, total, 50.0) / 1e3,
+            findPercentile(histogram, total, 99.0) / 1e3,
+            findPercentile(histogram, total, 99.9) / 1e3);
+}
+
+/**
+ * @function printBackpressure
+ * @argument snapshot - Merged counters of the stats
+ * @argument enqueueOps - Number of enqueue operations
+ * @argument dequeueOps - Number of dequeue operations
+ * @description
+ * Print the time producers were blocked on a full queue, the time consumers were blocked on an empty queue, how many
+ * waits each phase resolved and the share of the occupancy samples in each bucket. Buckets without samples are left out.
+ * */
+static void printBackpressure(StatsSnapshot* snapshot, unsigned long enqueueOps, unsigned long dequeueOps){
+    fprintf(stderr, "Blocked on full time is %lf (%lu of %lu enqueues)\n", snapshot->blockedOnFullTime / 1e9,
+            snapshot->blockedOnFullCount, enqueueOps);
+    fprintf(stderr, "Blocked on empty time is %lf (%lu of %lu dequeues)\n", snapshot->blockedOnEmptyTime / 1e9,
+            snapshot->blockedOnEmptyCount, dequeueOps);
+    fprintf(stderr, "Waits resolved by spin/yield/park is %lu/%lu/%lu\n", snapshot->waitPhases[0],
+            snapshot->waitPhases[1], snapshot->waitPhases[2]);
+
+    unsigned long samples = 0;
+    for(int bucket = 0; bucket < STATS_OCCUPANCY_BUCKETS; bucket++) samples = samples + snapshot->occupancy[bucket];
+    if(samples == 0) return;
+    fprintf(stderr, "Occupancy is");
+    for(int bucket = 0; bucket < STATS_OCCUPANCY_BUCKETS; bucket++){
+        if(snapshot->occupancy[bucket] == 0) continue;
+        fprintf(stderr, " %d%%:%.1lf%%", bucket * (100 / (STATS_OCCUPANCY_BUCKETS - 1)), 100.0 * snapshot->occupancy[bucket] / samples);
+    }
+    fprintf(stderr, "\n");
+}
+
+/**
+ * @function printCapacity
+ * @argument snapshot - Merged counters of the stats
+ * @description Print the final capacity. If it ever changed then the peak and the number of changes are printed too.
+ * */
+static void printCapacity(StatsSnapshot* snapshot){
+    if(snapshot->grownCount == 0 && snapshot->shrunkCount == 0){
+        fprintf(stderr, "Capacity is %d\n", snapshot->capacity);
+        return;
+    }
+    fprintf(stderr, "Capacity is %d (peak %d, grown %lu times, shrunk %lu times)\n", snapshot->capacity,
+            snapshot->peakCapacity, snapshot->grownCount, snapshot->shrunkCount);
 }
@@ -6,44 +6,130 @@
  * This module is used to maintain the stats associated with any queue.
  * A separate module is beneficial as new functionality can be added as required without any impact to other modules.
  *
+ * The counters are split in shards, one cache line aligned shard per thread, and updated with relaxed atomics, so
+ * recording a sample never takes a lock and never bounces a cache line between threads. A thread picks its shard the
+ * first time it records a sample. With more threads than shards, some threads share a shard, which is still correct.
+ * With --processes the shards are handed out from a counter in the shared segment, so the threads of different
+ * processes take different shards as well.
+ * The shards are merged when the stats are printed, or by SnapshotStatistics while the queue is in use. A snapshot only
+ * loads the counters, so it never slows down the threads which update them. Counters are loaded one at a time, hence a
+ * snapshot taken while the queue is in use may be a few operations apart between two counters.
+ *
+ * Times are measured using CLOCK_MONOTONIC, i.e. wall time, in nanoseconds. Besides the total time, each operation
+ * records its latency in a log-linear histogram (4 buckets per power of two) from which p50, p99 and p99.9 are reported.
+ * A percentile is reported as the upper bound of its bucket, so it is at most 25% above the real value.
+ *
+ * To show where the pipeline is backed up, the time producers spent blocked on a full queue and consumers spent blocked
+ * on an empty queue is recorded separately, along with a histogram of the queue occupancy sampled at every operation.
+ * Every wait is also counted under the phase (spin, yield or park) which resolved it.
+ * The occupancy is bucketed against the capacity at the time of the sample, since an adaptive queue changes its capacity
+ * while it runs. The number of times the capacity grew and shrank is reported next to the final and peak capacity.
+ *
  * @functions
  * CreateStatistics - Create a stats struct which will be used to perform the functionality provided in this module
+ * GetMonotonicTime - Current time of CLOCK_MONOTONIC in nanoseconds
  * UpdateEnqueueCount - Update the counter for enqueue ops
  * UpdateDequeueCount - Update the counter for dequeue ops
- * UpdateEnqueueTime - Update the time counter for enqueue op
- * UpdateDequeueTime - Update the time counter for dequeue op
+ * UpdateEnqueueTime - Update the time counter and latency histogram for enqueue op
+ * UpdateDequeueTime - Update the time counter and latency histogram for dequeue op
+ * UpdateBlockedOnFull - Update the time a producer was blocked because the queue was full
+ * UpdateBlockedOnEmpty - Update the time a consumer was blocked because the queue was empty
+ * UpdateOccupancy - Add a sample of the number of entries in the queue to the occupancy histogram
+ * UpdateCapacity - Record that the capacity of the queue was changed
+ * UpdateWaitPhase - Count a wait of a producer or consumer by the phase (spin, yield or park) which resolved it
+ * SnapshotStatistics - Merge the shards into a StatsSnapshot without stopping the threads which update them
  * PrintStatistics - Print the stats maintained in this module
  * */
 
 #ifndef ASSIGNMENT2_STATISTICS_H
 #define ASSIGNMENT2_STATISTICS_H
 
-#include <semaphore.h>
+#include <stdatomic.h>
+#include "SharedSegment.h"
 
 #define STATS_MODULE "Statistics"
+// Number of counter shards per stats struct
+#define STATS_SHARDS 16
+// Number of sub-buckets per power of two in the latency histograms
+#define STATS_SUB_BUCKETS 4
+// Number of buckets in a latency histogram. Covers every 64 bit nanosecond value.
+#define STATS_BUCKETS (64 * STATS_SUB_BUCKETS)
+// Number of buckets in the occupancy histogram. Bucket i holds the samples with i * 10% to (i + 1) * 10% occupancy.
+#define STATS_OCCUPANCY_BUCKETS 11
+// Number of phases of a wait- spin, yield and park
+#define STATS_WAIT_PHASES 3
 
+// Counters updated by the threads which use the same shard
 typedef struct {
-    // Name associated with this struct
-    char* statsIdentity;
-
     // Enqueue count
-    int enqueueCount;
+    _Alignas(64) atomic_ulong enqueueCount;
     // Dequeue count
-    int dequeueCount;
-    // Enqueue time
-    double enqueueTime;
-    // Dequeue time
-    double dequeueTime;
-
-    // Semaphore to synchronize access to this module
-    sem_t lock;
+    atomic_ulong dequeueCount;
+    // Enqueue time in nanoseconds
+    atomic_ullong enqueueTime;
+    // Dequeue time in nanoseconds
+    atomic_ullong dequeueTime;
+    // Number of enqueue operations per latency bucket
+    atomic_ulong enqueueLatency[STATS_BUCKETS];
+    // Number of dequeue operations per latency bucket
+    atomic_ulong dequeueLatency[STATS_BUCKETS];
+    // Time in nanoseconds and number of times producers were blocked on a full queue
+    atomic_ullong blockedOnFullTime;
+    atomic_ulong blockedOnFullCount;
+    // Time in nanoseconds and number of times consumers were blocked on an empty queue
+    atomic_ullong blockedOnEmptyTime;
+    atomic_ulong blockedOnEmptyCount;
+    // Number of occupancy samples per bucket
+    atomic_ulong occupancy[STATS_OCCUPANCY_BUCKETS];
+    // Number of waits resolved while spinning, while yielding and after parking
+    atomic_ulong waitPhases[STATS_WAIT_PHASES];
+} StatsShard;
+
+typedef struct {
+    // Name associated with this struct
+    char* statsIdentity;
+    // Current capacity of the queue. Used to bucket the occupancy samples.
+    atomic_int capacity;
+    // Largest capacity the queue had so far
+    atomic_int peakCapacity;
+    // Number of times the capacity was increased and decreased
+    atomic_ulong grownCount;
+    atomic_ulong shrunkCount;
+    // Counters of each shard. Merged by PrintStatistics.
+    StatsShard shards[STATS_SHARDS];
 } Stats;
 
-Stats* CreateStatistics(char* statsIdentity);
+// Counters of all the shards merged at one point in time. Filled by SnapshotStatistics.
+typedef struct {
+    unsigned long enqueueCount;
+    unsigned long dequeueCount;
+    // Times in nanoseconds
+    unsigned long long enqueueTime;
+    unsigned long long dequeueTime;
+    unsigned long long blockedOnFullTime;
+    unsigned long blockedOnFullCount;
+    unsigned long long blockedOnEmptyTime;
+    unsigned long blockedOnEmptyCount;
+    unsigned long occupancy[STATS_OCCUPANCY_BUCKETS];
+    unsigned long waitPhases[STATS_WAIT_PHASES];
+    int capacity;
+    int peakCapacity;
+    unsigned long grownCount;
+    unsigned long shrunkCount;
+} StatsSnapshot;
+
+Stats* CreateStatistics(char* statsIdentity, int capacity, SharedSegment* segment);
+unsigned long long GetMonotonicTime(void);
 void UpdateEnqueueCount(Stats* stats, int count);
 void UpdateDequeueCount(Stats* stats, int count);
-void UpdateEnqueueTime(Stats* stats, clock_t startTime, clock_t endTime);
-void UpdateDequeueTime(Stats* stats, clock_t startTime, clock_t endTime);
+void UpdateEnqueueTime(Stats* stats, unsigned long long startTime, unsigned long long endTime);
+void UpdateDequeueTime(Stats* stats, unsigned long long startTime, unsigned long long endTime);
+void UpdateBlockedOnFull(Stats* stats, unsigned long long startTime, unsigned long long endTime);
+void UpdateBlockedOnEmpty(Stats* stats, unsigned long long startTime, unsigned long long endTime);
+void UpdateOccupancy(Stats* stats, int occupancy);
+void UpdateCapacity(Stats* stats, int capacity);
+void UpdateWaitPhase(Stats* stats, int phase);
+void SnapshotStatistics(Stats* stats, StatsSnapshot* snapshot);
 void PrintStatistics(Stats* stats);
 
 #endif